@@ -0,0 +1,74 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Change.hpp"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * @brief Guards access to @c keyNames.
+ */
+static std::mutex keyNamesMutex;
+/**
+ * @brief Interned key names, nodes of the set are never moved in memory.
+ */
+static std::unordered_set<std::string> keyNames;
+/**
+ * @brief Per-thread cache of @c keyNames, which makes lookups of known keys
+ *        lock-free and thus doesn't serialize parallel parsing.
+ */
+static thread_local std::unordered_map<std::string, Change::KeyId> knownKeys;
+
+Change::KeyId
+Change::internKey(const std::string &name)
+{
+    const auto it = knownKeys.find(name);
+    if (it != knownKeys.end()) {
+        return it->second;
+    }
+
+    KeyId key;
+    {
+        std::lock_guard<std::mutex> lock(keyNamesMutex);
+        key = &*keyNames.insert(name).first;
+    }
+    knownKeys.emplace(name, key);
+    return key;
+}
+
+Change::KeyId
+Change::findKey(const std::string &name)
+{
+    const auto known = knownKeys.find(name);
+    if (known != knownKeys.end()) {
+        return known->second;
+    }
+
+    KeyId key;
+    {
+        std::lock_guard<std::mutex> lock(keyNamesMutex);
+        const auto it = keyNames.find(name);
+        if (it == keyNames.end()) {
+            return nullptr;
+        }
+        key = &*it;
+    }
+    knownKeys.emplace(name, key);
+    return key;
+}
@@ -24,9 +24,36 @@
 
 /**
  * @brief Represents single change of Item's description.
+ *
+ * Names of keys are interned, so each distinct name is stored only once and
+ * keys can be compared by their ids.
  */
 class Change
 {
+public:
+    /**
+     * @brief Id of an interned key name, unique for each name.
+     */
+    using KeyId = const std::string *;
+
+public:
+    /**
+     * @brief Retrieves id of the key name registering it if needed.
+     *
+     * @param name Name of the key.
+     *
+     * @returns The id.
+     */
+    static KeyId internKey(const std::string &name);
+    /**
+     * @brief Retrieves id of the key name without registering it.
+     *
+     * @param name Name of the key.
+     *
+     * @returns The id or @c nullptr if no change ever used such key.
+     */
+    static KeyId findKey(const std::string &name);
+
 public:
     /**
      * @brief Constructs a change.
@@ -35,8 +62,19 @@ public:
      * @param key What was changed.
      * @param value What's new value.
      */
-    Change(std::time_t timestamp, std::string key, std::string value)
-        : timestamp(timestamp), key(std::move(key)), value(std::move(value))
+    Change(std::time_t timestamp, const std::string &key, std::string value)
+        : timestamp(timestamp), key(internKey(key)), value(std::move(value))
+    {
+    }
+    /**
+     * @brief Constructs a change for an already interned key.
+     *
+     * @param timestamp When the change took place.
+     * @param key Id of what was changed.
+     * @param value What's new value.
+     */
+    Change(std::time_t timestamp, KeyId key, std::string value)
+        : timestamp(timestamp), key(key), value(std::move(value))
     {
     }
 
@@ -52,13 +90,19 @@ public:
      *
      * @returns The name.
      */
-    std::string getKey() const { return key; }
+    const std::string & getKey() const { return *key; }
+    /**
+     * @brief Retrieves id of the name of the field described by this change.
+     *
+     * @returns The id.
+     */
+    KeyId getKeyId() const { return key; }
     /**
      * @brief Retrieves value of the field described by this change.
      *
      * @returns The value.
      */
-    std::string getValue() const { return value; }
+    const std::string & getValue() const { return value; }
 
 private:
     /**
@@ -68,7 +112,7 @@ private:
     /**
      * @brief Name of the field.
      */
-    std::string key;
+    KeyId key;
     /**
      * @brief Value of the field.
      */
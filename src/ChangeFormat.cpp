@@ -0,0 +1,140 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ChangeFormat.hpp"
+
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <cstddef>
+
+#include <ios>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils/contains.hpp"
+#include "file_format.hpp"
+
+namespace io = boost::iostreams;
+
+static std::string decompress(const char data[], std::size_t size);
+
+std::vector<std::string>
+ChangeFormat::list()
+{
+    return { "text", "binary" };
+}
+
+bool
+ChangeFormat::isCompressed(const char data[], std::size_t size)
+{
+    // Magic number of gzip.
+    return size >= 2U && data[0] == '\x1f' && data[1] == '\x8b';
+}
+
+ChangeFormat::ChangeFormat(const std::string &name, std::string keysPath)
+    : keys(std::move(keysPath))
+{
+    setName(name);
+}
+
+void
+ChangeFormat::setName(const std::string &name)
+{
+    if (!contains(list(), name)) {
+        throw std::runtime_error("Unknown storage format: " + name);
+    }
+    binary = (name == "binary");
+}
+
+bool
+ChangeFormat::isBinary() const
+{
+    return binary;
+}
+
+void
+ChangeFormat::read(const char data[], std::size_t size,
+                   std::vector<Change> &changes) const
+{
+    std::string plain;
+    if (isCompressed(data, size)) {
+        plain = decompress(data, size);
+        data = plain.data();
+        size = plain.size();
+    }
+
+    if (isBinaryChanges(data, size)) {
+        parseBinaryChanges(data, size, keys, changes);
+    } else {
+        parseChanges(data, size, changes);
+    }
+}
+
+std::ostream &
+ChangeFormat::write(std::ostream &s, const std::vector<Change> &changes,
+                    std::size_t from, bool binary)
+{
+    if (binary) {
+        return writeBinaryChanges(s, changes, from, keys);
+    }
+    return writeChanges(s, changes, from);
+}
+
+std::ostream &
+ChangeFormat::writeCompressed(std::ostream &s,
+                              const std::vector<Change> &changes, bool binary)
+{
+    {
+        io::filtering_ostream gz;
+        gz.push(io::gzip_compressor());
+        gz.push(s);
+        write(gz, changes, 0U, binary);
+        // Leaving the scope finishes the gzip stream.
+    }
+    return s;
+}
+
+/**
+ * @brief Unpacks gzip-compressed data.
+ *
+ * @param data Beginning of the data.
+ * @param size Size of the data.
+ *
+ * @returns Decompressed data.
+ *
+ * @throws std::runtime_error On broken data.
+ */
+static std::string
+decompress(const char data[], std::size_t size)
+{
+    std::string plain;
+    try {
+        io::filtering_istream gz;
+        gz.push(io::gzip_decompressor());
+        gz.push(io::array_source(data, size));
+        io::copy(gz, io::back_inserter(plain));
+    } catch (const std::ios_base::failure &) {
+        throw std::runtime_error("Broken compressed change set");
+    }
+    return plain;
+}
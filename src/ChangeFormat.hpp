@@ -0,0 +1,138 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DIT__CHANGEFORMAT_HPP__
+#define DIT__CHANGEFORMAT_HPP__
+
+#include <cstddef>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "KeyTable.hpp"
+
+class Change;
+
+/**
+ * @brief Stored form of change sets of items.
+ *
+ * Reading recognizes both text and binary forms, while writing produces the
+ * one that is configured.
+ */
+class ChangeFormat
+{
+public:
+    /**
+     * @brief Lists names of all available formats.
+     *
+     * @returns The names.
+     */
+    static std::vector<std::string> list();
+    /**
+     * @brief Checks whether data in memory is a compressed change set.
+     *
+     * @param data Beginning of the data.
+     * @param size Size of the data.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    static bool isCompressed(const char data[], std::size_t size);
+
+public:
+    /**
+     * @brief Constructs the format.
+     *
+     * @param name Name of the format to use for writing.
+     * @param keysPath Path to key table for binary form.
+     *
+     * @throws std::runtime_error On unknown format name or broken key table.
+     */
+    ChangeFormat(const std::string &name, std::string keysPath);
+
+public:
+    /**
+     * @brief Changes format used for writing.
+     *
+     * @param name Name of the format.
+     *
+     * @throws std::runtime_error On unknown format name.
+     */
+    void setName(const std::string &name);
+    /**
+     * @brief Checks whether binary form is used for writing.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    bool isBinary() const;
+    /**
+     * @brief Converts data in memory into set of changes.
+     *
+     * Compressed data is decompressed first.  Can be called concurrently with
+     * itself.
+     *
+     * @param data Beginning of the data.
+     * @param size Size of the data.
+     * @param changes Storage for parsed data.
+     *
+     * @throws std::runtime_error On broken representation.
+     */
+    void read(const char data[], std::size_t size,
+              std::vector<Change> &changes) const;
+    /**
+     * @brief Writes tail of @p changes in the stream @p s.
+     *
+     * @param s Output stream for the data.
+     * @param changes Changes to write.
+     * @param from Index of the first change to write.
+     * @param binary Whether to use binary form, which must match form of
+     *               preceding changes if @p from isn't zero.
+     *
+     * @returns @p s.
+     *
+     * @throws std::runtime_error On failure to update key table.
+     */
+    std::ostream & write(std::ostream &s, const std::vector<Change> &changes,
+                         std::size_t from, bool binary);
+    /**
+     * @brief Writes all of @p changes in the stream @p s compressed.
+     *
+     * Such data can't be appended to.
+     *
+     * @param s Output stream for the data.
+     * @param changes Changes to write.
+     * @param binary Whether to use binary form inside.
+     *
+     * @returns @p s.
+     *
+     * @throws std::runtime_error On failure to update key table.
+     */
+    std::ostream & writeCompressed(std::ostream &s,
+                                   const std::vector<Change> &changes,
+                                   bool binary);
+
+private:
+    /**
+     * @brief Whether binary form is used for writing.
+     */
+    bool binary;
+    /**
+     * @brief Numbers of keys for binary form.
+     */
+    KeyTable keys;
+};
+
+#endif // DIT__CHANGEFORMAT_HPP__
@@ -0,0 +1,160 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "CompletionCache.hpp"
+
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <boost/filesystem.hpp>
+
+#include "file_format.hpp"
+
+namespace fs = boost::filesystem;
+
+CompletionCache::CompletionCache(std::string path) : path(std::move(path))
+{
+}
+
+bool
+CompletionCache::exists()
+{
+    if (!fs::is_regular_file(path)) {
+        return false;
+    }
+
+    ensureLoaded();
+    return !broken;
+}
+
+const std::set<std::string> &
+CompletionCache::getIds()
+{
+    ensureLoaded();
+    return ids;
+}
+
+std::set<std::string>
+CompletionCache::getKeys()
+{
+    ensureLoaded();
+
+    std::set<std::string> keys;
+    for (const auto &e : counts) {
+        keys.insert(e.first);
+    }
+    return keys;
+}
+
+std::set<std::string>
+CompletionCache::getValues(const std::string &key)
+{
+    ensureLoaded();
+
+    std::set<std::string> values;
+    const auto it = counts.find(key);
+    if (it != counts.end()) {
+        for (const auto &e : it->second) {
+            values.insert(e.first);
+        }
+    }
+    return values;
+}
+
+void
+CompletionCache::add(const std::string &id, const values_t &values)
+{
+    ensureLoaded();
+
+    ids.insert(id);
+    for (const auto &e : values) {
+        ++counts[e.first][e.second];
+    }
+    changed = true;
+}
+
+void
+CompletionCache::remove(const values_t &values)
+{
+    ensureLoaded();
+
+    for (const auto &e : values) {
+        const auto key = counts.find(e.first);
+        if (key == counts.end()) {
+            continue;
+        }
+
+        const auto value = key->second.find(e.second);
+        if (value != key->second.end() && --value->second <= 0) {
+            key->second.erase(value);
+            if (key->second.empty()) {
+                counts.erase(key);
+            }
+        }
+    }
+    changed = true;
+}
+
+void
+CompletionCache::save()
+{
+    if (!changed) {
+        return;
+    }
+
+    const std::string tmpPath = path + ".tmp";
+
+    std::ofstream file(tmpPath);
+    writeCompletions(file, ids, counts);
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write " + tmpPath);
+    }
+
+    fs::rename(tmpPath, path);
+    changed = false;
+}
+
+void
+CompletionCache::clear()
+{
+    fs::remove(path);
+    ids.clear();
+    counts.clear();
+    broken = false;
+}
+
+void
+CompletionCache::load()
+{
+    std::ifstream file(path);
+    if (!file) {
+        return;
+    }
+
+    try {
+        readCompletions(file, ids, counts);
+    } catch (const std::runtime_error &) {
+        // The cache gets rebuilt on next write.
+        ids.clear();
+        counts.clear();
+        broken = true;
+    }
+}
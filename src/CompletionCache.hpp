@@ -0,0 +1,137 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef DIT__COMPLETIONCACHE_HPP__
+#define DIT__COMPLETIONCACHE_HPP__
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "StorageBacked.hpp"
+
+/**
+ * @brief Persistent copy of ids, keys and values that are used for completion.
+ *
+ * Allows completing command-line without listing and reading items.  Number
+ * of items that have each value is tracked, so the cache can be updated with
+ * changes of individual items.
+ */
+class CompletionCache : private StorageBacked<CompletionCache>
+{
+    friend class StorageBacked<CompletionCache>;
+
+public:
+    /**
+     * @brief Type of values of an item (key -> value).
+     */
+    using values_t = std::map<std::string, std::string>;
+
+public:
+    /**
+     * @brief Creates cache backed by the specified file.
+     *
+     * @param path Path to the file.
+     */
+    explicit CompletionCache(std::string path);
+
+public:
+    /**
+     * @brief Checks whether cache was built and can be read.
+     *
+     * Broken cache (e.g., of an older format) is treated as missing.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    bool exists();
+    /**
+     * @brief Retrieves ids of all items.
+     *
+     * @returns The ids.
+     */
+    const std::set<std::string> & getIds();
+    /**
+     * @brief Retrieves names of keys that have values.
+     *
+     * @returns The names.
+     */
+    std::set<std::string> getKeys();
+    /**
+     * @brief Retrieves all values of a key.
+     *
+     * @param key Name of the key.
+     *
+     * @returns The values.
+     */
+    std::set<std::string> getValues(const std::string &key);
+    /**
+     * @brief Accounts for values of an item.
+     *
+     * @param id Id of the item.
+     * @param values Current values of the item.
+     */
+    void add(const std::string &id, const values_t &values);
+    /**
+     * @brief Stops accounting for former values of an item.
+     *
+     * @param values Values that the item had.
+     */
+    void remove(const values_t &values);
+    /**
+     * @brief Writes updated cache out.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     * @throws std::runtime_error On write failure.
+     */
+    virtual void save() override;
+    /**
+     * @brief Removes the cache.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     */
+    void clear();
+
+private:
+    /**
+     * @brief Actually reads the file.
+     */
+    void load();
+
+private:
+    /**
+     * @brief Path to the file.
+     */
+    const std::string path;
+    /**
+     * @brief Ids of all items.
+     */
+    std::set<std::string> ids;
+    /**
+     * @brief Number of items that have each value (key -> value -> count).
+     */
+    std::map<std::string, std::map<std::string, int>> counts;
+    /**
+     * @brief Whether contents differs from the file.
+     */
+    bool changed = false;
+    /**
+     * @brief Whether the file couldn't be read.
+     */
+    bool broken = false;
+};
+
+#endif // DIT__COMPLETIONCACHE_HPP__
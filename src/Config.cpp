@@ -110,9 +110,23 @@ Config::set(const std::string &key, const std::string &val)
 void
 Config::save()
 {
-    if (isModified()) {
+    if (!isModified()) {
+        return;
+    }
+
+    // Replacing symbolic link would turn it into a regular file, so replace
+    // its target or write through it if there is none yet.
+    if (fs::is_symlink(path) && !fs::exists(path)) {
         write_info(path, props);
+        return;
     }
+
+    // Replace the file to never leave it half-written.
+    const std::string target = fs::exists(path) ? fs::canonical(path).string()
+                                                : path;
+    const std::string tmpPath = target + ".tmp";
+    write_info(tmpPath, props);
+    fs::rename(tmpPath, target);
 }
 
 bool
@@ -0,0 +1,699 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Daemon.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/file_descriptor.hpp>
+#include <boost/iostreams/stream_buffer.hpp>
+#include <boost/optional.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <boost/scope_exit.hpp>
+
+#include "utils/memory.hpp"
+#include "Config.hpp"
+#include "Dit.hpp"
+#include "Project.hpp"
+#include "Storage.hpp"
+#include "decoration.hpp"
+
+namespace fs = boost::filesystem;
+namespace io = boost::iostreams;
+
+extern char **environ;
+
+static void onTerminate(int signum);
+static int connectTo(const std::string &path);
+static bool readAll(int fd, char buf[], std::size_t n);
+static bool writeAll(int fd, const char buf[], std::size_t n);
+
+/**
+ * @brief Number of standard streams passed along with a request.
+ */
+const int nStreams = 3;
+
+/**
+ * @brief Events of directories that invalidate projects.
+ */
+const std::uint32_t watchMask = IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE
+                              | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF
+                              | IN_MOVE_SELF;
+
+/**
+ * @brief Whether server was asked to quit.
+ */
+static volatile std::sig_atomic_t terminationRequested;
+
+std::string
+Daemon::getSocketPath()
+{
+    const char *const runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir == nullptr || *runtimeDir == '\0') {
+        return std::string();
+    }
+    return (fs::path(runtimeDir)/"dit.sock").string();
+}
+
+boost::optional<int>
+Daemon::forward(const std::vector<std::string> &args)
+{
+    const std::string path = getSocketPath();
+    if (path.empty()) {
+        return {};
+    }
+
+    const int fd = connectTo(path);
+    if (fd == -1) {
+        return {};
+    }
+    BOOST_SCOPE_EXIT_ALL(fd) { close(fd); };
+
+    boost::system::error_code ec;
+    const fs::path cwd = fs::current_path(ec);
+    if (ec) {
+        return {};
+    }
+
+    // Request consists of number of arguments, arguments, working directory
+    // and environment, each terminated by a null character.
+    std::string payload = std::to_string(args.size()) + '\0';
+    for (const std::string &arg : args) {
+        payload += arg + '\0';
+    }
+    payload += cwd.string() + '\0';
+    for (char **var = environ; *var != nullptr; ++var) {
+        payload += *var;
+        payload += '\0';
+    }
+
+    std::uint32_t size = payload.size();
+    iovec iov = { &size, sizeof(size) };
+
+    char control[CMSG_SPACE(sizeof(int)*nStreams)] = {};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr *const cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int)*nStreams);
+    const int streams[nStreams] = { STDIN_FILENO, STDOUT_FILENO,
+                                    STDERR_FILENO };
+    std::memcpy(CMSG_DATA(cmsg), streams, sizeof(streams));
+
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) != sizeof(size)) {
+        // Server didn't get the request, so it can be handled locally.
+        return {};
+    }
+
+    std::int32_t exitCode;
+    if (!writeAll(fd, payload.data(), payload.size()) ||
+        !readAll(fd, reinterpret_cast<char *>(&exitCode), sizeof(exitCode))) {
+        std::cerr << "Error: lost connection to the daemon" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return exitCode;
+}
+
+/**
+ * @brief Connects to a Unix socket.
+ *
+ * @param path Path to the socket.
+ *
+ * @returns Connected socket or @c -1 on failure.
+ */
+static int
+connectTo(const std::string &path)
+{
+    sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+Daemon::Daemon() : socketPath(getSocketPath()), listenFd(-1), inotifyFd(-1)
+{
+    if (socketPath.empty()) {
+        throw std::runtime_error("XDG_RUNTIME_DIR is not set");
+    }
+
+    sockaddr_un addr = {};
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + socketPath);
+    }
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, socketPath.c_str());
+
+    const int fd = connectTo(socketPath);
+    if (fd != -1) {
+        close(fd);
+        throw std::runtime_error("Daemon is already running");
+    }
+
+    dit = make_unique<Dit>(std::vector<std::string>{ "dit" });
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd == -1) {
+        throw std::runtime_error("Failed to initialize inotify");
+    }
+
+    // Socket could have been left by a server that has crashed.
+    unlink(socketPath.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd == -1 ||
+        bind(listenFd, reinterpret_cast<sockaddr *>(&addr),
+             sizeof(addr)) != 0) {
+        if (listenFd != -1) {
+            close(listenFd);
+        }
+        close(inotifyFd);
+        throw std::runtime_error("Failed to bind " + socketPath);
+    }
+
+    if (listen(listenFd, SOMAXCONN) != 0) {
+        close(listenFd);
+        close(inotifyFd);
+        unlink(socketPath.c_str());
+        throw std::runtime_error("Failed to listen on " + socketPath);
+    }
+}
+
+Daemon::~Daemon()
+{
+    close(listenFd);
+    close(inotifyFd);
+    unlink(socketPath.c_str());
+}
+
+void
+Daemon::serve()
+{
+    struct sigaction sa = {};
+    sa.sa_handler = &onTerminate;
+    sigemptyset(&sa.sa_mask);
+    // No SA_RESTART, so that poll() gets interrupted.
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    refresh();
+
+    while (!terminationRequested) {
+        // Requests run concurrently, each one is checked for completion and
+        // for its client going away.
+        std::vector<pollfd> fds = { { listenFd, POLLIN, 0 },
+                                    { inotifyFd, POLLIN, 0 } };
+        for (const auto &e : requests) {
+            const Request &request = e.second;
+            fds.push_back({ request.done, POLLIN, 0 });
+            fds.push_back({ request.cancelled ? -1 : request.conn, POLLIN, 0 });
+        }
+
+        if (poll(fds.data(), fds.size(), -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to wait for requests");
+        }
+
+        if (fds[1].revents & POLLIN) {
+            processEvents();
+            refresh();
+        }
+
+        const short gone = POLLIN | POLLHUP | POLLERR;
+        std::size_t i = 2U;
+        for (auto it = requests.begin(); it != requests.end(); i += 2U) {
+            Request &request = it->second;
+            if (fds[i].revents & gone) {
+                finish(it->first, request);
+                it = requests.erase(it);
+                continue;
+            }
+
+            // Client going away (e.g., on Ctrl-C) terminates the request.
+            if (fds[i + 1U].revents & gone) {
+                kill(-it->first, SIGTERM);
+                request.cancelled = true;
+            }
+            ++it;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            const int conn = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (conn != -1 && !handle(conn)) {
+                close(conn);
+            }
+        }
+    }
+
+    for (auto &e : requests) {
+        kill(-e.first, SIGTERM);
+        finish(e.first, e.second);
+    }
+    requests.clear();
+}
+
+/**
+ * @brief Handles SIGINT and SIGTERM.
+ *
+ * @param signum Signal number.
+ */
+static void
+onTerminate(int)
+{
+    terminationRequested = true;
+}
+
+void
+Daemon::refresh()
+{
+    const fs::path projectsDir = dit->getProjectsDir();
+
+    if (watches.empty()) {
+        // Global configuration and list of projects.
+        watch(projectsDir.parent_path().string(), std::string());
+        watch(projectsDir.string(), std::string());
+    }
+
+    boost::system::error_code ec;
+    if (!fs::is_directory(projectsDir, ec)) {
+        return;
+    }
+
+    using dir_it = fs::directory_iterator;
+    for (fs::directory_entry &e :
+         boost::make_iterator_range(dir_it(projectsDir, ec), dir_it())) {
+        const std::string rootDir = e.path().string();
+        if (projects.find(rootDir) == projects.end()) {
+            open(rootDir, nullptr, {});
+        }
+    }
+}
+
+void
+Daemon::open(const std::string &rootDir, Project *former,
+             const std::vector<std::string> &paths)
+{
+    std::unique_ptr<Project> prj;
+    try {
+        prj = dit->makeProject(rootDir);
+        if (!prj->exists()) {
+            return;
+        }
+        prj->getConfig().list();
+        if (former != nullptr) {
+            prj->getStorage().adopt(former->getStorage(), paths);
+        }
+        prj->getStorage().loadAll();
+    } catch (const std::exception &) {
+        // Such project is opened anew by requests.
+        return;
+    }
+
+    watch(rootDir, rootDir);
+    projects.emplace(rootDir, std::move(prj));
+}
+
+void
+Daemon::watch(const std::string &path, const std::string &rootDir)
+{
+    // Subdirectories of the configuration directory are projects, which are
+    // watched separately.
+    const std::uint32_t mask = rootDir.empty()
+                             ? watchMask | IN_ONLYDIR
+                             : watchMask;
+
+    const int wd = inotify_add_watch(inotifyFd, path.c_str(), mask);
+    if (wd == -1) {
+        return;
+    }
+    watches[wd] = { rootDir, path };
+
+    if (rootDir.empty()) {
+        return;
+    }
+
+    boost::system::error_code ec;
+    using dir_it = fs::directory_iterator;
+    for (fs::directory_entry &e :
+         boost::make_iterator_range(dir_it(path, ec), dir_it())) {
+        if (fs::is_directory(e.status())) {
+            watch(e.path().string(), rootDir);
+        }
+    }
+}
+
+void
+Daemon::processEvents()
+{
+    alignas(inotify_event) char buf[64*1024];
+
+    // Changed files by roots of projects.
+    std::map<std::string, std::vector<std::string>> changed;
+
+    while (true) {
+        const ssize_t n = read(inotifyFd, buf, sizeof(buf));
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (const char *p = buf; p < buf + n; ) {
+            const inotify_event *const e =
+                reinterpret_cast<const inotify_event *>(p);
+            p += sizeof(inotify_event) + e->len;
+
+            if (e->mask & IN_Q_OVERFLOW) {
+                dropAll();
+                continue;
+            }
+
+            const auto it = watches.find(e->wd);
+            if (it == watches.end()) {
+                continue;
+            }
+
+            if (e->mask & IN_IGNORED) {
+                watches.erase(it);
+                continue;
+            }
+
+            const Watch &dir = it->second;
+            if (dir.rootDir.empty()) {
+                dropAll();
+                continue;
+            }
+
+            changed[dir.rootDir].push_back(e->len == 0U
+                                           ? dir.path
+                                           : (fs::path(dir.path)/e->name)
+                                             .string());
+        }
+    }
+
+    for (const auto &e : changed) {
+        const auto it = projects.find(e.first);
+        if (it == projects.end()) {
+            // refresh() will try opening it.
+            continue;
+        }
+
+        // Unchanged data of items is taken from the former instance.
+        std::unique_ptr<Project> former = std::move(it->second);
+        projects.erase(it);
+        open(e.first, former.get(), e.second);
+    }
+}
+
+void
+Daemon::dropAll()
+{
+    for (const auto &e : watches) {
+        inotify_rm_watch(inotifyFd, e.first);
+    }
+    watches.clear();
+
+    // Global configuration might have changed, so start from scratch.
+    projects.clear();
+    dit = make_unique<Dit>(std::vector<std::string>{ "dit" });
+}
+
+bool
+Daemon::handle(int conn)
+{
+    std::uint32_t size;
+    iovec iov = { &size, sizeof(size) };
+
+    char control[CMSG_SPACE(sizeof(int)*nStreams)] = {};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    const ssize_t n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+
+    std::vector<int> fds;
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+         cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            const std::size_t count = (cmsg->cmsg_len - CMSG_LEN(0))/sizeof(int);
+            fds.resize(count);
+            std::memcpy(fds.data(), CMSG_DATA(cmsg), count*sizeof(int));
+        }
+    }
+    BOOST_SCOPE_EXIT_ALL(&fds) {
+        for (int fd : fds) {
+            close(fd);
+        }
+    };
+
+    if (n <= 0 || fds.size() != nStreams ||
+        !readAll(conn, reinterpret_cast<char *>(&size) + n,
+                 sizeof(size) - n)) {
+        return false;
+    }
+
+    std::string payload(size, '\0');
+    if (!readAll(conn, &payload[0], payload.size())) {
+        return false;
+    }
+
+    std::vector<std::string> fields;
+    for (std::string::size_type pos = 0U; pos < payload.size(); ) {
+        const std::string::size_type end = payload.find('\0', pos);
+        if (end == std::string::npos) {
+            return false;
+        }
+        fields.push_back(payload.substr(pos, end - pos));
+        pos = end + 1U;
+    }
+
+    // Don't let the request see outdated data.
+    processEvents();
+    refresh();
+
+    // Closing of this pipe signals that request was processed.
+    int donePipe[2];
+    if (pipe2(donePipe, O_CLOEXEC) != 0) {
+        return false;
+    }
+
+    const pid_t pid = fork();
+    if (pid > 0) {
+        setpgid(pid, pid);
+    }
+    if (pid == 0) {
+        close(donePipe[0]);
+        close(listenFd);
+        close(inotifyFd);
+        close(conn);
+        for (const auto &e : requests) {
+            close(e.second.conn);
+            close(e.second.done);
+        }
+        runRequest(fds, std::move(fields));
+    }
+    close(donePipe[1]);
+
+    if (pid == -1) {
+        close(donePipe[0]);
+        return false;
+    }
+
+    requests[pid] = { conn, donePipe[0], false };
+    return true;
+}
+
+void
+Daemon::finish(pid_t pid, const Request &request)
+{
+    // The child has closed its end of the pipe, so it's exiting.
+    int wstatus;
+    while (waitpid(pid, &wstatus, 0) == -1 && errno == EINTR) {
+        // Retry.
+    }
+
+    const std::int32_t exitCode = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus)
+                                                     : EXIT_FAILURE;
+    send(request.conn, &exitCode, sizeof(exitCode), MSG_NOSIGNAL);
+
+    close(request.done);
+    close(request.conn);
+}
+
+void
+Daemon::runRequest(const std::vector<int> &fds,
+                   std::vector<std::string> fields)
+{
+    // Become a group, so that request can be terminated with its pager.
+    setpgid(0, 0);
+
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    std::signal(SIGPIPE, SIG_DFL);
+
+    for (int i = 0; i < nStreams; ++i) {
+        if (dup2(fds[i], i) == -1) {
+            _Exit(EXIT_FAILURE);
+        }
+    }
+
+    // Standard output of the server might be wrapped by a buffer that's never
+    // flushed here, write to the client directly instead.
+    io::stream_buffer<io::file_descriptor_sink> outBuf(STDOUT_FILENO,
+                                                       io::never_close_handle);
+    std::cout.rdbuf(&outBuf);
+    decor::detectTerminal({});
+
+    int exitCode = EXIT_FAILURE;
+    try {
+        const std::size_t nArgs = std::stoul(fields.at(0));
+        if (fields.size() < nArgs + 2U) {
+            throw std::runtime_error("Broken request");
+        }
+
+        const auto argsBegin = fields.cbegin() + 1;
+        const auto argsEnd = argsBegin + nArgs;
+        std::vector<std::string> args(argsBegin, argsEnd);
+
+        if (chdir(argsEnd->c_str()) != 0) {
+            throw std::runtime_error("Failed to change directory to " +
+                                     *argsEnd);
+        }
+
+        clearenv();
+        for (auto it = argsEnd + 1; it != fields.cend(); ++it) {
+            const std::string::size_type eq = it->find('=');
+            if (eq != std::string::npos) {
+                setenv(it->substr(0, eq).c_str(), it->substr(eq + 1).c_str(),
+                       1);
+            }
+        }
+
+        Dit dit(std::move(args));
+        dit.setProjectSource([this](const std::string &rootDir) {
+            std::unique_ptr<Project> prj;
+            const auto it = projects.find(rootDir);
+            if (it != projects.end()) {
+                prj = std::move(it->second);
+            }
+            return prj;
+        });
+        exitCode = dit.run();
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+
+    std::cout.flush();
+    std::exit(exitCode);
+}
+
+/**
+ * @brief Reads exactly @p n bytes.
+ *
+ * @param fd File descriptor to read from.
+ * @param buf Destination.
+ * @param n Number of bytes.
+ *
+ * @returns @c true on success, @c false otherwise.
+ */
+static bool
+readAll(int fd, char buf[], std::size_t n)
+{
+    while (n != 0U) {
+        const ssize_t r = read(fd, buf, n);
+        if (r == -1 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return false;
+        }
+        buf += r;
+        n -= r;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes exactly @p n bytes.
+ *
+ * @param fd File descriptor to write to.
+ * @param buf Source.
+ * @param n Number of bytes.
+ *
+ * @returns @c true on success, @c false otherwise.
+ */
+static bool
+writeAll(int fd, const char buf[], std::size_t n)
+{
+    while (n != 0U) {
+        const ssize_t w = send(fd, buf, n, MSG_NOSIGNAL);
+        if (w == -1 && errno == EINTR) {
+            continue;
+        }
+        if (w <= 0) {
+            return false;
+        }
+        buf += w;
+        n -= w;
+    }
+    return true;
+}
@@ -0,0 +1,187 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DIT__DAEMON_HPP__
+#define DIT__DAEMON_HPP__
+
+#include <sys/types.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+class Dit;
+class Project;
+
+/**
+ * @brief Server that runs invocations of dit on behalf of thin clients.
+ *
+ * Listens on a Unix socket and keeps projects loaded between requests.  Each
+ * request is served by a forked process that inherits loaded projects and
+ * standard streams of the client, so nothing it does affects the server.
+ * Requests are served concurrently, the server only waits for them to finish
+ * in its main loop.
+ * Modifications of project directories are tracked via inotify and cause
+ * affected projects to be reopened, which rereads only items that changed.
+ */
+class Daemon
+{
+    /**
+     * @brief Watched directory.
+     */
+    struct Watch
+    {
+        std::string rootDir; /**< @brief Root of project, empty for config. */
+        std::string path;    /**< @brief Path to the directory. */
+    };
+
+    /**
+     * @brief Request that is being served by a child process.
+     */
+    struct Request
+    {
+        int conn;       /**< @brief Connection to the client. */
+        int done;       /**< @brief Pipe that's closed when child is done. */
+        bool cancelled; /**< @brief Whether request was asked to terminate. */
+    };
+
+public:
+    /**
+     * @brief Retrieves path to the socket of the server.
+     *
+     * @returns The path or empty string if there is no place for it.
+     */
+    static std::string getSocketPath();
+    /**
+     * @brief Runs invocation by the server if it's running.
+     *
+     * Standard streams of the process are passed to the server.
+     *
+     * @param args Application arguments.
+     *
+     * @returns Exit code of the invocation or nothing if there is no server.
+     */
+    static boost::optional<int> forward(const std::vector<std::string> &args);
+
+public:
+    /**
+     * @brief Creates server listening on the socket.
+     *
+     * @throws std::runtime_error If server can't be started.
+     */
+    Daemon();
+    /**
+     * @brief Stops listening and removes the socket.
+     */
+    ~Daemon();
+
+public:
+    /**
+     * @brief Serves requests until SIGINT or SIGTERM is received.
+     *
+     * @throws std::runtime_error On failure to wait for requests.
+     */
+    void serve();
+
+private:
+    /**
+     * @brief Opens projects that aren't loaded.
+     */
+    void refresh();
+    /**
+     * @brief Processes pending inotify events reopening affected projects.
+     */
+    void processEvents();
+    /**
+     * @brief Opens and loads a project.
+     *
+     * @param rootDir Root of the project.
+     * @param former Previously loaded instance of the project or @c nullptr.
+     * @param paths Paths to files changed since @p former was loaded.
+     */
+    void open(const std::string &rootDir, Project *former,
+              const std::vector<std::string> &paths);
+    /**
+     * @brief Subscribes to changes of a directory and its subdirectories.
+     *
+     * @param path Path to the directory.
+     * @param rootDir Root of project the directory belongs to.
+     */
+    void watch(const std::string &path, const std::string &rootDir);
+    /**
+     * @brief Unloads all projects and global configuration.
+     */
+    void dropAll();
+    /**
+     * @brief Starts serving single request.
+     *
+     * @param conn Connection to the client.
+     *
+     * @returns @c true if request was started and owns the connection now,
+     *          @c false otherwise.
+     */
+    bool handle(int conn);
+    /**
+     * @brief Reports exit code of a served request to its client.
+     *
+     * @param pid Process that served the request.
+     * @param request The request, its descriptors are closed.
+     */
+    void finish(pid_t pid, const Request &request);
+    /**
+     * @brief Runs request in a child process, never returns.
+     *
+     * @param fds Standard streams of the client.
+     * @param fields Arguments, working directory and environment.
+     */
+    [[noreturn]] void runRequest(const std::vector<int> &fds,
+                                 std::vector<std::string> fields);
+
+private:
+    /**
+     * @brief Path to the socket.
+     */
+    const std::string socketPath;
+    /**
+     * @brief Listening socket.
+     */
+    int listenFd;
+    /**
+     * @brief Descriptor of inotify instance.
+     */
+    int inotifyFd;
+    /**
+     * @brief Application instance used to open projects.
+     */
+    std::unique_ptr<Dit> dit;
+    /**
+     * @brief Loaded projects (root -> project).
+     */
+    std::map<std::string, std::unique_ptr<Project>> projects;
+    /**
+     * @brief Watched directories (watch descriptor -> directory).
+     */
+    std::map<int, Watch> watches;
+    /**
+     * @brief Requests that are being served (process id -> request).
+     */
+    std::map<pid_t, Request> requests;
+};
+
+#endif // DIT__DAEMON_HPP__
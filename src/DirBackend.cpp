@@ -0,0 +1,226 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "DirBackend.hpp"
+
+#include <sys/stat.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <fstream>
+#include <functional>
+#include <ios>
+#include <ostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <boost/filesystem.hpp>
+
+#include "ChangeFormat.hpp"
+#include "Project.hpp"
+#include "file_format.hpp"
+
+namespace fs = boost::filesystem;
+
+DirBackend::DirBackend(Project &project, ChangeFormat &format)
+    : StorageBackend(format), project(project)
+{
+}
+
+std::vector<std::string>
+DirBackend::listIds()
+{
+    std::vector<std::string> ids;
+    forEachId([&ids](const std::string &id) {
+        ids.push_back(id);
+        return true;
+    });
+    return ids;
+}
+
+void
+DirBackend::forEachId(const std::function<bool(const std::string &id)> &visit)
+{
+    const std::string &dataDir = project.getDataDir();
+
+    // Suppress throwing exceptions if project doesn't have any items.
+    if (project.exists() && !fs::is_directory(dataDir)) {
+        return;
+    }
+
+    // Items are in directories named after the first character of their ids.
+    using dir_it = fs::directory_iterator;
+    for (fs::directory_entry &dir :
+         boost::make_iterator_range(dir_it(dataDir), dir_it())) {
+        const std::string prefix = dir.path().filename().string();
+        for (fs::directory_entry &e :
+             boost::make_iterator_range(dir_it(dir.path()), dir_it())) {
+            if (!visit(prefix + e.path().filename().string())) {
+                return;
+            }
+        }
+    }
+}
+
+void
+DirBackend::read(const std::string &id, std::vector<Change> &changes)
+{
+    const fs::path path = getPath(id);
+
+    boost::system::error_code ec;
+    const std::uintmax_t size = fs::file_size(path, ec);
+    if (ec) {
+        throw std::runtime_error("Failed to read change set of " + id);
+    }
+
+    // Empty files can't be mapped.
+    if (size == 0U) {
+        return;
+    }
+
+    boost::iostreams::mapped_file_source file;
+    try {
+        file.open(path.string());
+    } catch (const std::exception &) {
+        throw std::runtime_error("Failed to read change set of " + id);
+    }
+
+    getFormat().read(file.data(), file.size(), changes);
+}
+
+std::string
+DirBackend::getStamp(const std::string &id)
+{
+    struct stat st;
+    if (stat(getPath(id).c_str(), &st) != 0) {
+        return std::string();
+    }
+
+    return std::to_string(st.st_ino) + ':'
+         + std::to_string(st.st_size) + ':'
+         + std::to_string(st.st_mtim.tv_sec) + '.'
+         + std::to_string(st.st_mtim.tv_nsec);
+}
+
+bool
+DirBackend::isCompressed(const std::string &id)
+{
+    std::ifstream file(getPath(id).string(), std::ios::in | std::ios::binary);
+    char header[4];
+    file.read(header, sizeof(header));
+    return ChangeFormat::isCompressed(header, file.gcount());
+}
+
+void
+DirBackend::write(const std::string &id, const std::vector<Change> &changes,
+                  bool compress)
+{
+    writeItem(id, changes, 0U, std::ios::out | std::ios::trunc,
+              getFormat().isBinary(), compress);
+}
+
+void
+DirBackend::append(const std::string &id, const std::vector<Change> &changes,
+                   std::size_t from)
+{
+    std::ifstream file(getPath(id).string(), std::ios::in | std::ios::binary);
+    char header[4];
+    file.read(header, sizeof(header));
+    if (file.gcount() == 0) {
+        // Nothing to append to.
+        write(id, changes, false);
+        return;
+    }
+
+    if (ChangeFormat::isCompressed(header, file.gcount())) {
+        // Item is no longer cold, so store it as a regular one.
+        write(id, changes, false);
+        return;
+    }
+
+    // Tail must be in the same form as what's already in the file.
+    const bool binary = isBinaryChanges(header, file.gcount());
+    writeItem(id, changes, from, std::ios::out | std::ios::app, binary, false);
+}
+
+void
+DirBackend::writeItem(const std::string &id, const std::vector<Change> &changes,
+                      std::size_t from, std::ios_base::openmode mode,
+                      bool binary, bool compress)
+{
+    const fs::path dataDir = project.getDataDir();
+    const fs::path dirPath = dataDir/id.substr(0, 1);
+
+    if (!fs::exists(dirPath)) {
+        fs::create_directories(dirPath);
+    }
+
+    // Replaced file is written aside to never leave it half-written.
+    const bool replace = (mode & std::ios::trunc);
+    const fs::path filePath = dirPath/id.substr(1);
+    const fs::path outPath = replace
+                           ? fs::path(project.getRootDir())/"item.tmp"
+                           : filePath;
+
+    std::ofstream file(outPath.string(), mode | std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to write change set of " + id);
+    }
+
+    ChangeFormat &format = getFormat();
+    std::ostream &os = compress ? format.writeCompressed(file, changes, binary)
+                                : format.write(file, changes, from, binary);
+    if (!os.flush()) {
+        throw std::runtime_error("Failed to write change set of " + id);
+    }
+    file.close();
+
+    if (replace) {
+        fs::rename(outPath, filePath);
+    }
+}
+
+void
+DirBackend::clear()
+{
+    fs::remove_all(project.getDataDir());
+}
+
+bool
+DirBackend::listChanged(const std::vector<std::string> &paths,
+                        std::set<std::string> &ids)
+{
+    const fs::path dataDir = project.getDataDir();
+    for (const fs::path path : paths) {
+        // Same layout as the one expected by listIds().
+        const fs::path dir = path.parent_path();
+        if (dir.parent_path() == dataDir) {
+            ids.insert(dir.filename().string() + path.filename().string());
+        }
+    }
+    return true;
+}
+
+fs::path
+DirBackend::getPath(const std::string &id) const
+{
+    return fs::path(project.getDataDir())/id.substr(0, 1)/id.substr(1);
+}
@@ -0,0 +1,146 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DIT__DIRBACKEND_HPP__
+#define DIT__DIRBACKEND_HPP__
+
+#include <cstddef>
+
+#include <functional>
+#include <ios>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "StorageBackend.hpp"
+
+namespace boost { namespace filesystem {
+    class path;
+} }
+
+/**
+ * @brief Backend that keeps each item in a separate file.
+ *
+ * Items are stored as `items/<first char of id>/<rest of id>`.
+ */
+class DirBackend : public StorageBackend
+{
+public:
+    /**
+     * @brief Creates backend for the @p project.
+     *
+     * @param project Project whose items are managed.
+     * @param format Form of change sets.
+     */
+    DirBackend(Project &project, ChangeFormat &format);
+
+public:
+    /**
+     * @copydoc StorageBackend::listIds()
+     */
+    virtual std::vector<std::string> listIds() override;
+    /**
+     * @brief Invokes visitor for ids while walking directories of items.
+     *
+     * @param visit Visitor, which returns @c false to stop the iteration.
+     *
+     * @throws boost::filesystem::filesystem_error On broken storage.
+     */
+    virtual void forEachId(
+        const std::function<bool(const std::string &id)> &visit) override;
+    /**
+     * @copydoc StorageBackend::read()
+     */
+    virtual void read(const std::string &id,
+                      std::vector<Change> &changes) override;
+    /**
+     * @brief Composes stamp out of inode, size and modification time of file
+     *        of an item.
+     *
+     * Files are replaced on rewrites and grow on appends, so any write changes
+     * the stamp.
+     *
+     * @param id Id of the item.
+     *
+     * @returns The stamp or empty string if item isn't stored.
+     */
+    virtual std::string getStamp(const std::string &id) override;
+    /**
+     * @copydoc StorageBackend::isCompressed()
+     */
+    virtual bool isCompressed(const std::string &id) override;
+    /**
+     * @copydoc StorageBackend::write()
+     */
+    virtual void write(const std::string &id,
+                       const std::vector<Change> &changes,
+                       bool compress) override;
+    /**
+     * @copydoc StorageBackend::append()
+     */
+    virtual void append(const std::string &id,
+                        const std::vector<Change> &changes,
+                        std::size_t from) override;
+    /**
+     * @copydoc StorageBackend::clear()
+     */
+    virtual void clear() override;
+    /**
+     * @brief Maps changed files of items to their ids.
+     *
+     * @param paths Paths to changed files.
+     * @param[out] ids Ids of changed items.
+     *
+     * @returns @c true.
+     */
+    virtual bool listChanged(const std::vector<std::string> &paths,
+                             std::set<std::string> &ids) override;
+
+private:
+    /**
+     * @brief Writes changes of an item starting with the specified one.
+     *
+     * File is replaced as a whole unless @p mode appends to it.
+     *
+     * @param id Id of the item.
+     * @param changes All changes of the item.
+     * @param from Index of the first change to write.
+     * @param mode Mode of opening the file.
+     * @param binary Whether to write changes in binary form.
+     * @param compress Whether to compress changes, @p from must be zero then.
+     *
+     * @throws std::runtime_error On data write failure.
+     */
+    void writeItem(const std::string &id, const std::vector<Change> &changes,
+                   std::size_t from, std::ios_base::openmode mode,
+                   bool binary, bool compress);
+    /**
+     * @brief Retrieves path to file of an item.
+     *
+     * @param id Id of the item.
+     *
+     * @returns The path.
+     */
+    boost::filesystem::path getPath(const std::string &id) const;
+
+private:
+    /**
+     * @brief Project this backend belongs to.
+     */
+    Project &project;
+};
+
+#endif // DIT__DIRBACKEND_HPP__
@@ -121,14 +121,16 @@ getDefaultConfig()
         defCfg.set("ui.ls.fmt", "_id,title");
         defCfg.set("ui.ls.sort", "title,_id");
         defCfg.set("ui.ls.color", "fg-cyan inv bold !heading");
+        defCfg.set("ui.ls.pipe", "table");
         defCfg.set("ui.show.order", "title");
+    }
 
-        std::string pager = "less -R";
-        if (const char *const pagerEnv = std::getenv("PAGER")) {
-            pager = pagerEnv;
-        }
-        defCfg.set("core.pager", pager);
+    // Environment can differ between invocations served by the same process.
+    std::string pager = "less -R";
+    if (const char *const pagerEnv = std::getenv("PAGER")) {
+        pager = pagerEnv;
     }
+    defCfg.set("core.pager", pager);
 
     return defCfg;
 }
@@ -324,10 +326,18 @@ Dit::openProject(const std::string &name, std::string &error)
         return {};
     }
 
-    auto makeConfig = std::bind(std::mem_fn(&Dit::makeConfig), this,
-                                std::placeholders::_1);
-    auto project = make_unique<Project>((fs::path(projectsDir)/name).string(),
-                                        makeConfig);
+    const std::string rootDir = (fs::path(projectsDir)/name).string();
+
+    std::unique_ptr<Project> project;
+    if (openedProjects) {
+        project = openedProjects(rootDir);
+    }
+    if (project) {
+        applyConfs(project->getConfig());
+    } else {
+        project = makeProject(rootDir);
+    }
+
     if (!project->exists()) {
         error = "Project does not exist: " + name;
         return {};
@@ -336,12 +346,26 @@ Dit::openProject(const std::string &name, std::string &error)
     return project;
 }
 
+std::unique_ptr<Project>
+Dit::makeProject(const std::string &rootDir)
+{
+    auto makeConfig = std::bind(std::mem_fn(&Dit::makeConfig), this,
+                                std::placeholders::_1);
+    return make_unique<Project>(rootDir, makeConfig);
+}
+
 std::pair<Config, std::unique_ptr<Config>>
 Dit::makeConfig(const std::string &path) const
 {
     auto prjCfg = make_unique<Config>(path, globalConfig.get());
     Config cfgProxy(std::string(), prjCfg.get());
+    applyConfs(cfgProxy);
+    return { std::move(cfgProxy), std::move(prjCfg) };
+}
 
+void
+Dit::applyConfs(Config &config) const
+{
     using confType = std::pair<std::string, std::string>;
     for (const confType &conf : invocation.getConfs()) {
         std::string key = conf.first;
@@ -349,12 +373,10 @@ Dit::makeConfig(const std::string &path) const
 
         if (!key.empty() && key.back() == '+') {
             key.pop_back();
-            value = cfgProxy.get(key, std::string()) + value;
+            value = config.get(key, std::string()) + value;
         }
-        cfgProxy.set(key, value);
+        config.set(key, value);
     }
-
-    return { std::move(cfgProxy), std::move(prjCfg) };
 }
 
 Config &
@@ -374,3 +396,9 @@ Dit::getPrj() const
 {
     return invocation.getPrjName();
 }
+
+void
+Dit::setProjectSource(projectSource source)
+{
+    openedProjects = std::move(source);
+}
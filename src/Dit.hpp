@@ -17,6 +17,7 @@
 #ifndef DIT__DIT_HPP__
 #define DIT__DIT_HPP__
 
+#include <functional>
 #include <iosfwd>
 #include <memory>
 #include <string>
@@ -33,6 +34,16 @@ class Project;
  */
 class Dit
 {
+public:
+    /**
+     * @brief Type of function that provides already opened project.
+     *
+     * Receives path to root of the project and returns the project or
+     * @c nullptr to open it anew.
+     */
+    using projectSource =
+        std::function<std::unique_ptr<Project>(const std::string &rootDir)>;
+
 public:
     /**
      * @brief Constructs main application class.
@@ -83,21 +94,22 @@ public:
      * @returns The name or empty string.
      */
     std::string getPrj() const;
-
-private:
     /**
-     * @brief Initializes configuration.
+     * @brief Sets where projects are taken from before opening them.
+     *
+     * Settings from command-line are applied to projects obtained this way.
+     *
+     * @param source The source.
      */
-    void initConfig();
+    void setProjectSource(projectSource source);
     /**
-     * @brief Completes command-line for a sub-command.
+     * @brief Opens a project without checking whether it exists.
      *
-     * Uses current state of @c invocation.  Always the last argument is
-     * completed.
+     * @param rootDir Root directory of the project.
      *
-     * @returns Exit status of the application (to be returned by @c main()).
+     * @returns The project.
      */
-    int completeCmd();
+    std::unique_ptr<Project> makeProject(const std::string &rootDir);
     /**
      * @brief Looks up a project by its name.
      *
@@ -108,6 +120,21 @@ private:
      */
     std::unique_ptr<Project> openProject(const std::string &name,
                                          std::string &error);
+
+private:
+    /**
+     * @brief Initializes configuration.
+     */
+    void initConfig();
+    /**
+     * @brief Completes command-line for a sub-command.
+     *
+     * Uses current state of @c invocation.  Always the last argument is
+     * completed.
+     *
+     * @returns Exit status of the application (to be returned by @c main()).
+     */
+    int completeCmd();
     /**
      * @brief Makes standalone configuration for a project.
      *
@@ -117,6 +144,12 @@ private:
      */
     std::pair<Config, std::unique_ptr<Config>>
     makeConfig(const std::string &path) const;
+    /**
+     * @brief Applies settings from command-line to a configuration.
+     *
+     * @param config The configuration.
+     */
+    void applyConfs(Config &config) const;
 
 private:
     /**
@@ -131,6 +164,10 @@ private:
      * @brief Root directory of all projects.
      */
     std::string projectsDir;
+    /**
+     * @brief Provider of already opened projects.
+     */
+    projectSource openedProjects;
 };
 
 #endif // DIT__DIT_HPP__
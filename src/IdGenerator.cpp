@@ -29,6 +29,7 @@
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include "Config.hpp"
 
@@ -79,6 +80,25 @@ IdGenerator::advanceId()
     markModified();
 }
 
+std::vector<std::string>
+IdGenerator::takeIds(int n)
+{
+    ensureLoaded();
+
+    std::vector<std::string> ids;
+    ids.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        ids.push_back(nextId);
+        std::tie(nextId, count) = advance(nextId, count);
+    }
+    total += n;
+
+    if (n > 0) {
+        markModified();
+    }
+    return ids;
+}
+
 void
 IdGenerator::load()
 {
@@ -196,13 +216,33 @@ IdGenerator::save()
 void
 IdGenerator::dump(Config &config) const
 {
-    config.set("!ids.sequences.alphabet", alphabet);
-    config.set("!ids.next", nextId);
-    config.set("!ids.count", std::to_string(count));
-    config.set("!ids.total", std::to_string(total));
+    for (const std::pair<std::string, std::string> &setting : getState()) {
+        config.set(setting.first, setting.second);
+    }
+}
 
-    config.set("!ids.sequences.count", std::to_string(sequences.size()));
+std::vector<std::pair<std::string, std::string>>
+IdGenerator::getChangedState() const
+{
+    if (!isModified()) {
+        return {};
+    }
+    return getState();
+}
+
+std::vector<std::pair<std::string, std::string>>
+IdGenerator::getState() const
+{
+    std::vector<std::pair<std::string, std::string>> state = {
+        { "!ids.sequences.alphabet", alphabet },
+        { "!ids.next", nextId },
+        { "!ids.count", std::to_string(count) },
+        { "!ids.total", std::to_string(total) },
+        { "!ids.sequences.count", std::to_string(sequences.size()) },
+    };
     for (unsigned int seq = 0U; seq < sequences.size(); ++seq) {
-        config.set("!ids.sequences." + std::to_string(seq), sequences[seq]);
+        state.emplace_back("!ids.sequences." + std::to_string(seq),
+                           sequences[seq]);
     }
+    return state;
 }
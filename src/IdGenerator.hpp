@@ -63,6 +63,16 @@ public:
      * As a result generates next ID.
      */
     void advanceId();
+    /**
+     * @brief Employs several IDs at once.
+     *
+     * Equivalent to a sequence of getId() and advanceId() calls.
+     *
+     * @param n Number of IDs to employ.
+     *
+     * @returns The IDs.
+     */
+    std::vector<std::string> takeIds(int n);
 
     /**
      * @brief Retrieves size of the generated sequence of IDs so far.
@@ -78,6 +88,13 @@ public:
      */
     void forEachId(std::function<void(const std::string &)> visitor);
 
+    /**
+     * @brief Lists settings that save() is going to store.
+     *
+     * @returns Pairs of keys and values, empty if nothing was changed.
+     */
+    std::vector<std::pair<std::string, std::string>> getChangedState() const;
+
     /**
      * @brief Stores changed state into configuration.
      */
@@ -105,6 +122,12 @@ private:
      * @param config Configuration to save data into.
      */
     void dump(Config &config) const;
+    /**
+     * @brief Lists settings that describe current state.
+     *
+     * @returns Pairs of keys and values.
+     */
+    std::vector<std::pair<std::string, std::string>> getState() const;
 
 private:
     /**
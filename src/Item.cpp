@@ -16,14 +16,15 @@
 
 #include "Item.hpp"
 
+#include <cstddef>
+
+#include <algorithm>
 #include <functional>
 #include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
-#include <boost/range/adaptor/reversed.hpp>
-
 #include "utils/Passkey.hpp"
 #include "utils/time.hpp"
 #include "Change.hpp"
@@ -57,7 +58,8 @@ Item::isValidKeyName(const std::string &name, bool forWrite, std::string &error)
 }
 
 Item::Item(Storage &storage, std::string id, bool exists, pk<Storage>)
-    : StorageBacked<Item>(!exists), storage(storage), id(std::move(id))
+    : StorageBacked<Item>(!exists), storage(storage), id(std::move(id)),
+      rewrite(!exists)
 {
     // Count item creation as a modification.
     if (!exists) {
@@ -66,7 +68,8 @@ Item::Item(Storage &storage, std::string id, bool exists, pk<Storage>)
 }
 
 Item::Item(Storage &storage, std::string id, pk<Tests>)
-    : StorageBacked<Item>(true), storage(storage), id(std::move(id))
+    : StorageBacked<Item>(true), storage(storage), id(std::move(id)),
+      rewrite(false)
 {
 }
 
@@ -92,12 +95,14 @@ Item::getValue(const std::string &key)
     if (key == "_id") {
         return getId();
     } else if(key == "_created") {
+        ensureLoaded();
         if (changes.empty()) {
             return std::string();
         }
 
         return timeToString(changes.front().getTimestamp());
     } else if(key == "_changed") {
+        ensureLoaded();
         if (changes.empty()) {
             return std::string();
         }
@@ -105,6 +110,13 @@ Item::getValue(const std::string &key)
         return timeToString(changes.back().getTimestamp());
     }
 
+    if (!isLoaded()) {
+        if (const auto values = storage.getSnapshot(id, {})) {
+            const auto it = values->find(key);
+            return (it != values->end()) ? it->second : std::string();
+        }
+    }
+
     const Change *const change = getLatestChange(key);
     return (change != nullptr) ? change->getValue() : std::string();
 }
@@ -112,14 +124,22 @@ Item::getValue(const std::string &key)
 std::set<std::string>
 Item::listRecordNames()
 {
+    std::set<std::string> names;
+
+    if (!isLoaded()) {
+        if (const auto values = storage.getSnapshot(id, {})) {
+            for (const auto &e : *values) {
+                names.insert(e.first);
+            }
+            return names;
+        }
+    }
+
     ensureLoaded();
 
-    std::set<std::string> names;
-    for (const Change &c : changes) {
-        if (!c.getValue().empty()) {
-            names.insert(c.getKey());
-        } else {
-            names.erase(c.getKey());
+    for (const auto &e : latest) {
+        if (!changes[e.second].getValue().empty()) {
+            names.insert(*e.first);
         }
     }
     return names;
@@ -135,6 +155,9 @@ Item::load()
             throw std::logic_error("Change set for " + id + " is not sorted.");
         }
     }
+
+    nStored = changes.size();
+    indexChanges();
 }
 
 void
@@ -154,16 +177,19 @@ Item::setValue(const std::string &key, const std::string &value)
 
         if (change->getTimestamp() == timestamp) {
             // Update previous change with new value.
+            touch(change);
             *change = Change(timestamp, key, value);
 
             if (Change *const prev = getLatestChange(key, change)) {
                 if (prev->getValue() == value) {
                     // Remove the change that matches old value.
                     changes.erase(changes.begin() + (change - &changes[0]));
+                    indexChanges();
                 }
             } else if (value.empty()) {
                 // Remove the change that matches old value.
                 changes.erase(changes.begin() + (change - &changes[0]));
+                indexChanges();
             }
 
             markModified();
@@ -173,7 +199,15 @@ Item::setValue(const std::string &key, const std::string &value)
         return;
     }
 
-    changes.emplace_back(timestamp, key, value);
+    const Change::KeyId keyId = Change::internKey(key);
+    const auto it = findLatest(keyId);
+    if (it != latest.end() && it->first == keyId) {
+        it->second = changes.size();
+    } else {
+        latest.emplace(it, keyId, changes.size());
+    }
+
+    changes.emplace_back(timestamp, keyId, value);
     markModified();
 }
 
@@ -182,31 +216,76 @@ Item::getLatestChange(const std::string &key)
 {
     ensureLoaded();
 
-    for (Change &c : boost::adaptors::reverse(changes)) {
-        if (c.getKey() == key) {
-            return &c;
-        }
+    const Change::KeyId keyId = Change::findKey(key);
+    if (keyId == nullptr) {
+        return nullptr;
     }
-    return nullptr;
+
+    const auto it = findLatest(keyId);
+    if (it == latest.end() || it->first != keyId) {
+        return nullptr;
+    }
+    return &changes[it->second];
 }
 
 Change *
 Item::getLatestChange(const std::string &key, Change *before)
 {
+    const Change::KeyId keyId = Change::findKey(key);
     for (Change *c = before - 1; c >= &changes[0]; --c) {
-        if (c->getKey() == key) {
+        if (c->getKeyId() == keyId) {
             return c;
         }
     }
     return nullptr;
 }
 
+void
+Item::indexChanges()
+{
+    latest.clear();
+    for (std::size_t i = 0U; i < changes.size(); ++i) {
+        const Change::KeyId keyId = changes[i].getKeyId();
+        const auto it = findLatest(keyId);
+        if (it != latest.end() && it->first == keyId) {
+            it->second = i;
+        } else {
+            latest.emplace(it, keyId, i);
+        }
+    }
+}
+
+std::vector<std::pair<Change::KeyId, std::size_t>>::iterator
+Item::findLatest(Change::KeyId keyId)
+{
+    return std::lower_bound(latest.begin(), latest.end(), keyId,
+                            [](const std::pair<Change::KeyId, std::size_t> &e,
+                               Change::KeyId keyId) {
+                                return std::less<Change::KeyId>()(e.first,
+                                                                  keyId);
+                            });
+}
+
+void
+Item::touch(const Change *change)
+{
+    if (static_cast<std::size_t>(change - &changes[0]) < nStored) {
+        rewrite = true;
+    }
+}
+
 bool
 Item::wasChanged() const
 {
     return isModified();
 }
 
+bool
+Item::wasLoaded(pk<Storage>) const
+{
+    return isLoaded();
+}
+
 const std::vector<Change> &
 Item::getChanges()
 {
@@ -226,6 +305,25 @@ Item::getChanges(pk<Storage>) const
     return changes;
 }
 
+std::size_t
+Item::getStoredCount(pk<Storage>) const
+{
+    return nStored;
+}
+
+bool
+Item::needsRewrite(pk<Storage>) const
+{
+    return rewrite;
+}
+
+void
+Item::markStored(pk<Storage>)
+{
+    nStored = changes.size();
+    rewrite = false;
+}
+
 void
 Item::setTimeSource(std::function<std::time_t()> getTime, pk<Tests>)
 {
@@ -17,17 +17,19 @@
 #ifndef DIT__ITEM_HPP__
 #define DIT__ITEM_HPP__
 
+#include <cstddef>
 #include <ctime>
 
 #include <functional>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "utils/Passkey.hpp"
+#include "Change.hpp"
 #include "StorageBacked.hpp"
 
-class Change;
 class Storage;
 class Tests;
 
@@ -137,6 +139,12 @@ public:
      * @returns @c true if so, @c false otherwise.
      */
     bool wasChanged() const;
+    /**
+     * @brief Checks whether changes of the item are already in memory.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    bool wasLoaded(pk<Storage>) const;
     /**
      * @brief Retrieves read-only set of changes of the item.
      *
@@ -155,6 +163,28 @@ public:
      * @returns Constant list of item changes.
      */
     const std::vector<Change> & getChanges(pk<Storage>) const;
+    /**
+     * @brief Retrieves number of leading changes that are already stored.
+     *
+     * Changes past this number can be appended to the storage unless
+     * needsRewrite() is @c true.
+     *
+     * @returns The number.
+     */
+    std::size_t getStoredCount(pk<Storage>) const;
+    /**
+     * @brief Checks whether whole change set needs to be written.
+     *
+     * This is the case for new items and items, which had some of their stored
+     * changes updated or removed.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    bool needsRewrite(pk<Storage>) const;
+    /**
+     * @brief Marks current change set as the one that is stored.
+     */
+    void markStored(pk<Storage>);
 
     /**
      * @brief Sets timestamp provider.
@@ -187,6 +217,25 @@ private:
      * @returns The latest change or @c nullptr if no change found.
      */
     Change * getLatestChange(const std::string &key, Change *before);
+    /**
+     * @brief Rebuilds @c latest from @c changes.
+     */
+    void indexChanges();
+    /**
+     * @brief Looks up entry of @c latest for the key.
+     *
+     * @param keyId Id of the key to look up.
+     *
+     * @returns Position at which entry for the key is or should be.
+     */
+    std::vector<std::pair<Change::KeyId, std::size_t>>::iterator
+    findLatest(Change::KeyId keyId);
+    /**
+     * @brief Registers modification of a change, which is about to happen.
+     *
+     * @param change Change that is modified or removed.
+     */
+    void touch(const Change *change);
 
 private:
     /**
@@ -201,6 +250,18 @@ private:
      * @brief Change set associated with the item (from oldest to newest).
      */
     std::vector<Change> changes;
+    /**
+     * @brief Index of the latest change of each key sorted by key id.
+     */
+    std::vector<std::pair<Change::KeyId, std::size_t>> latest;
+    /**
+     * @brief Number of leading elements of @c changes that are stored as is.
+     */
+    std::size_t nStored = 0U;
+    /**
+     * @brief Whether stored change set is out of sync with @c changes.
+     */
+    bool rewrite;
 };
 
 #endif // DIT__ITEM_HPP__
@@ -17,17 +17,22 @@
 #include "ItemFilter.hpp"
 
 #include <cassert>
+#include <cctype>
+#include <cstddef>
 
+#include <algorithm>
+#include <functional>
 #include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
-#include <boost/algorithm/string/predicate.hpp>
-
 #include "Item.hpp"
+#include "Storage.hpp"
 #include "parsing.hpp"
 
+static bool icontains(const std::string &str, const std::string &needle);
+
 ItemFilter::ItemFilter(const std::vector<std::string> &exprs)
 {
     for (const std::string &expr : exprs) {
@@ -38,38 +43,141 @@ ItemFilter::ItemFilter(const std::vector<std::string> &exprs)
         }
         conds.emplace_back(std::move(cond));
     }
+
+    compile();
 }
 
 ItemFilter::ItemFilter(Cond cond)
 {
     conds.emplace_back(std::move(cond));
+
+    compile();
 }
 
 ItemFilter::~ItemFilter()
 {
 }
 
+void
+ItemFilter::compile()
+{
+    needles.reserve(conds.size());
+    for (std::size_t i = 0U; i < conds.size(); ++i) {
+        std::string needle = conds[i].value;
+        for (char &c : needle) {
+            c = std::tolower(static_cast<unsigned char>(c));
+        }
+        needles.emplace_back(std::move(needle));
+
+        const std::string &key = conds[i].key;
+        auto it = std::find_if(keys.begin(), keys.end(),
+                               [&key](const decltype(keys)::value_type &e) {
+                                   return e.first == key;
+                               });
+        if (it == keys.end()) {
+            keys.emplace_back(key, std::vector<std::size_t>());
+            it = --keys.end();
+        }
+        it->second.push_back(i);
+    }
+}
+
 bool
 ItemFilter::passes(Item &item) const
 {
-    return passes([&item](const std::string &key) {
-        std::vector<std::string> values;
-        if (key == "_any") {
+    std::vector<std::string> values;
+
+    // Each key is resolved once no matter how many conditions refer to it.
+    for (const auto &e : keys) {
+        values.clear();
+        if (e.first == "_any") {
             for (const std::string &key : item.listRecordNames()) {
                 values.push_back(item.getValue(key));
             }
         } else {
-            values.push_back(item.getValue(key));
+            values.push_back(item.getValue(e.first));
+        }
+
+        for (std::size_t i : e.second) {
+            const auto matches = [this, i](const std::string &val) {
+                return test(i, val);
+            };
+            if (std::none_of(values.cbegin(), values.cend(), matches)) {
+                return false;
+            }
         }
-        return values;
-    });
+    }
+
+    return true;
+}
+
+std::vector<std::reference_wrapper<Item>>
+ItemFilter::select(Storage &storage) const
+{
+    std::vector<std::reference_wrapper<Item>> items;
+    if (!findCandidates(storage, items)) {
+        return storage.loadAll();
+    }
+    return items;
+}
+
+void
+ItemFilter::forEachMatch(Storage &storage,
+                         const std::function<bool(Item &item)> &visit) const
+{
+    const auto visitMatch = [this, &visit](Item &item) {
+        return !passes(item) || visit(item);
+    };
+
+    std::vector<std::reference_wrapper<Item>> items;
+    if (!findCandidates(storage, items)) {
+        storage.forEach(visitMatch);
+        return;
+    }
+
+    for (Item &item : items) {
+        if (!visitMatch(item)) {
+            break;
+        }
+    }
+}
+
+bool
+ItemFilter::findCandidates(
+    Storage &storage, std::vector<std::reference_wrapper<Item>> &items) const
+{
+    // Indexes don't cover pseudo fields (except for _any) and items without
+    // the key.  Only positive substring matches can narrow the set.
+    std::vector<std::pair<std::string, std::string>> values;
+    std::vector<std::string> needles;
+    for (const Cond &cond : conds) {
+        if (cond.key[0] == '_' && cond.key != "_any") {
+            continue;
+        }
+
+        if (cond.op == Op::eq && cond.key != "_any" && !cond.value.empty()) {
+            values.emplace_back(cond.key, cond.value);
+        } else if (cond.op == Op::iccontains) {
+            needles.push_back(cond.value);
+        }
+    }
+
+    return storage.find(values, needles, items);
 }
 
 bool
 ItemFilter::passes(const std::function<accessor_f> &accessor) const
 {
-    std::string error;
-    return passes(accessor, error);
+    for (std::size_t i = 0U; i < conds.size(); ++i) {
+        const auto matches = [this, i](const std::string &val) {
+            return test(i, val);
+        };
+        const std::vector<std::string> values = accessor(conds[i].key);
+        if (std::none_of(values.cbegin(), values.cend(), matches)) {
+            return false;
+        }
+    }
+    return true;
 }
 
 bool
@@ -78,17 +186,6 @@ ItemFilter::passes(const std::function<accessor_f> &accessor,
 {
     error.clear();
 
-    auto test = [](const Cond &cond, const std::string &val) {
-        switch (cond.op) {
-            case Op::eq:           return (val == cond.value);
-            case Op::ne:           return (val != cond.value);
-            case Op::iccontains:   return boost::icontains(val, cond.value);
-            case Op::icnotcontain: return !boost::icontains(val, cond.value);
-        }
-        assert(false && "Unhandled operation type.");
-        return false;
-    };
-
     auto err = [&error](const Cond &cond) {
         if (!error.empty()) {
             error += '\n';
@@ -96,18 +193,55 @@ ItemFilter::passes(const std::function<accessor_f> &accessor,
         error += "\tnot met for " + cond.key + ": " + cond.str;
     };
 
-    for (const Cond &cond : conds) {
+    for (std::size_t i = 0U; i < conds.size(); ++i) {
         bool matched = false;
-        for (const std::string &val : accessor(cond.key)) {
-            if (test(cond, val)) {
+        for (const std::string &val : accessor(conds[i].key)) {
+            if (test(i, val)) {
                 matched = true;
                 break;
             }
         }
         if (!matched) {
-            err(cond);
+            err(conds[i]);
         }
     }
 
     return error.empty();
 }
+
+bool
+ItemFilter::test(std::size_t i, const std::string &val) const
+{
+    const Cond &cond = conds[i];
+    switch (cond.op) {
+        case Op::eq:           return (val == cond.value);
+        case Op::ne:           return (val != cond.value);
+        case Op::iccontains:   return icontains(val, needles[i]);
+        case Op::icnotcontain: return !icontains(val, needles[i]);
+    }
+    assert(false && "Unhandled operation type.");
+    return false;
+}
+
+/**
+ * @brief Checks whether string contains a substring ignoring case.
+ *
+ * @param str String to search in.
+ * @param needle Lower case string to look for.
+ *
+ * @returns @c true if @p needle is found, @c false otherwise.
+ */
+static bool
+icontains(const std::string &str, const std::string &needle)
+{
+    if (needle.empty()) {
+        return true;
+    }
+
+    auto eq = [](char a, char b) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(a)))
+            == b;
+    };
+    return std::search(str.cbegin(), str.cend(), needle.cbegin(),
+                       needle.cend(), eq) != str.cend();
+}
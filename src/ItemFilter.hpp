@@ -17,13 +17,17 @@
 #ifndef DIT__ITEMFILTER_HPP__
 #define DIT__ITEMFILTER_HPP__
 
+#include <cstddef>
+
 #include <functional>
 #include <string>
+#include <utility>
 #include <vector>
 
 struct Cond;
 
 class Item;
+class Storage;
 
 /**
  * @brief Checks items for satisfying set of constraints.
@@ -68,6 +72,28 @@ public:
      * @returns @c true if it passes, and @c false otherwise.
      */
     bool passes(Item &item) const;
+    /**
+     * @brief Lists items of the storage that can pass the filter.
+     *
+     * Uses indexes to exclude items that can't pass equality and substring
+     * conditions, all conditions still need to be checked by passes().
+     *
+     * @param storage Storage with items.
+     *
+     * @returns The items.
+     */
+    std::vector<std::reference_wrapper<Item>> select(Storage &storage) const;
+    /**
+     * @brief Visits items of the storage that pass the filter.
+     *
+     * Uses indexes like select() does.  If they can't help, items are visited
+     * as they are read, see Storage::forEach().
+     *
+     * @param storage Storage with items.
+     * @param visit Visitor, which returns @c false to stop the iteration.
+     */
+    void forEachMatch(Storage &storage,
+                      const std::function<bool(Item &item)> &visit) const;
 
     /**
      * @brief Checks whether item represented by its fields passes the filter.
@@ -92,11 +118,44 @@ public:
     bool passes(const std::function<accessor_f> &accessor,
                 std::string &error) const;
 
+private:
+    /**
+     * @brief Checks single value against a condition.
+     *
+     * @param i Index of the condition.
+     * @param val Value to check.
+     *
+     * @returns @c true if value satisfies the condition, @c false otherwise.
+     */
+    bool test(std::size_t i, const std::string &val) const;
+    /**
+     * @brief Prepares conditions for matching.
+     */
+    void compile();
+    /**
+     * @brief Lists items that can pass the filter using indexes.
+     *
+     * @param storage Storage with items.
+     * @param[out] items The items.
+     *
+     * @returns @c false if indexes can't narrow the list.
+     */
+    bool findCandidates(Storage &storage,
+                        std::vector<std::reference_wrapper<Item>> &items) const;
+
 private:
     /**
      * @brief Set of constraints.
      */
     std::vector<Cond> conds;
+    /**
+     * @brief Lower case versions of values of @c conds.
+     */
+    std::vector<std::string> needles;
+    /**
+     * @brief Distinct keys of @c conds with indexes of their conditions.
+     */
+    std::vector<std::pair<std::string, std::vector<std::size_t>>> keys;
 };
 
 #endif // DIT__ITEMFILTER_HPP__
@@ -16,6 +16,8 @@
 
 #include "ItemTable.hpp"
 
+#include <cstddef>
+
 #include <algorithm>
 #include <functional>
 #include <iomanip>
@@ -27,6 +29,7 @@
 #include <vector>
 
 #include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 
@@ -34,6 +37,7 @@
 #include "Item.hpp"
 #include "ItemFilter.hpp"
 #include "decoration.hpp"
+#include "integration.hpp"
 #include "parsing.hpp"
 
 static std::ostream & operator<<(std::ostream &os,
@@ -162,23 +166,89 @@ private:
     std::vector<std::string> values;
 };
 
+/**
+ * @brief Item of a table along with values that define its position.
+ */
+struct ItemTable::Row
+{
+    /**
+     * @brief Item of the row.
+     */
+    Item *item;
+    /**
+     * @brief Ordinal number of the item, makes sorting stable.
+     */
+    std::size_t index;
+    /**
+     * @brief Values of sorting keys of the item.
+     */
+    std::vector<std::string> keys;
+    /**
+     * @brief Colorization rule of the row or @c nullptr.
+     */
+    const ColorRule *colorRule;
+};
+
+/**
+ * @brief Colorization rule with conditions prepared for matching.
+ */
+struct ItemTable::CompiledRule
+{
+    /**
+     * @brief Original rule.
+     */
+    const ColorRule *rule;
+    /**
+     * @brief Filters for conditions of the rule, one per condition.
+     */
+    std::vector<ItemFilter> filters;
+};
+
 static const std::string gap = "  ";
 
 ItemTable::ItemTable(const std::string &fmt, const std::string &colorSpec,
-                     std::string sort, unsigned int maxWidth)
-    : sort(std::move(sort)), maxWidth(maxWidth)
+                     const std::string &sort, unsigned int maxWidth,
+                     unsigned int limit)
+    : maxWidth(maxWidth), limit(limit), appended(0U), stream(nullptr),
+      separator('\t'), headingRule(nullptr)
 {
+    for (std::string key : split(sort, ',')) {
+        const bool desc = boost::starts_with(key, "-");
+        if (desc) {
+            key.erase(0U, 1U);
+        }
+        descending.push_back(desc);
+        sortKeys.emplace_back(std::move(key));
+    }
+
     for (std::string key : split(fmt, ',')) {
         std::string heading = key;
         boost::algorithm::to_upper(heading);
         boost::algorithm::trim_left_if(heading, boost::is_from_range('_', '_'));
 
+        const auto it = std::find(sortKeys.cbegin(), sortKeys.cend(), key);
+        columnSortKeys.push_back(it == sortKeys.cend()
+                               ? std::string::npos
+                               : it - sortKeys.cbegin());
+
         cols.emplace_back(std::move(key), std::move(heading));
     }
 
     if (!parseColorRules(colorSpec, colorRules)) {
         throw std::runtime_error("Failed to parse colorization specification.");
     }
+
+    for (const ColorRule &rule : colorRules) {
+        CompiledRule compiled { &rule, {} };
+        for (const Cond &cond : rule.conds) {
+            if (cond.key != "!heading") {
+                compiled.filters.emplace_back(cond);
+            } else if (headingRule == nullptr) {
+                headingRule = &rule;
+            }
+        }
+        compiledRules.emplace_back(std::move(compiled));
+    }
 }
 
 ItemTable::~ItemTable()
@@ -188,7 +258,55 @@ ItemTable::~ItemTable()
 void
 ItemTable::append(Item &item)
 {
-    items.emplace_back(item);
+    Row row { &item, appended++, {}, nullptr };
+    row.keys.reserve(sortKeys.size());
+    for (const std::string &key : sortKeys) {
+        row.keys.push_back(item.getValue(key));
+    }
+
+    if (isStreaming()) {
+        if (limit == 0U || row.index < limit) {
+            printDelimited(*stream, row);
+            stream->flush();
+        }
+        return;
+    }
+
+    if (limit == 0U) {
+        rows.push_back(std::move(row));
+        return;
+    }
+
+    auto less = [this](const Row &a, const Row &b) { return isBefore(a, b); };
+
+    // Keep at most limit first rows with the last one at the front.
+    if (rows.size() < limit) {
+        rows.push_back(std::move(row));
+        std::push_heap(rows.begin(), rows.end(), less);
+    } else if (less(row, rows.front())) {
+        std::pop_heap(rows.begin(), rows.end(), less);
+        rows.back() = std::move(row);
+        std::push_heap(rows.begin(), rows.end(), less);
+    }
+}
+
+bool
+ItemTable::isFull() const
+{
+    return limit != 0U && sortKeys.empty() && appended >= limit;
+}
+
+bool
+ItemTable::isStreaming() const
+{
+    return stream != nullptr && sortKeys.empty();
+}
+
+void
+ItemTable::makeDelimited(std::ostream &os, char separator)
+{
+    stream = &os;
+    this->separator = separator;
 }
 
 void
@@ -196,6 +314,16 @@ ItemTable::print(std::ostream &os)
 {
     sortItems();
 
+    if (stream != nullptr) {
+        for (const Row &row : rows) {
+            if (RedirectToPager::isConsumerGone()) {
+                break;
+            }
+            printDelimited(os, row);
+        }
+        return;
+    }
+
     fillColumns();
 
     if (!adjustColumnsWidths()) {
@@ -207,24 +335,48 @@ ItemTable::print(std::ostream &os)
     printTableRows(os);
 }
 
+bool
+ItemTable::isBefore(const Row &a, const Row &b) const
+{
+    for (std::size_t i = 0U, n = sortKeys.size(); i < n; ++i) {
+        const int cmp = a.keys[i].compare(b.keys[i]);
+        if (cmp != 0) {
+            return descending[i] ? cmp > 0 : cmp < 0;
+        }
+    }
+    return a.index < b.index;
+}
+
 void
 ItemTable::sortItems()
 {
-    const std::vector<std::string> keys = split(sort, ',');
-    for (const std::string &key : boost::adaptors::reverse(keys)) {
-        std::stable_sort(items.begin(), items.end(),
-                         [&key](Item &a, Item &b) {
-                             return a.getValue(key) < b.getValue(key);
-                         });
+    auto less = [this](const Row &a, const Row &b) { return isBefore(a, b); };
+
+    if (limit == 0U) {
+        std::sort(rows.begin(), rows.end(), less);
+    } else {
+        std::sort_heap(rows.begin(), rows.end(), less);
     }
 }
 
 void
 ItemTable::fillColumns()
 {
-    for (Item &item : items) {
-        for (Column &col : cols) {
-            col.append(item.getValue(col.getKey()));
+    std::vector<std::string> values(cols.size());
+
+    // Values of sorting keys are reused instead of being looked up again.
+    for (Row &row : rows) {
+        for (std::size_t i = 0U, n = cols.size(); i < n; ++i) {
+            const std::size_t keyIdx = columnSortKeys[i];
+            values[i] = (keyIdx == std::string::npos)
+                      ? row.item->getValue(cols[i].getKey())
+                      : row.keys[keyIdx];
+        }
+
+        row.colorRule = matchColorRule(row, values);
+
+        for (std::size_t i = 0U, n = cols.size(); i < n; ++i) {
+            cols[i].append(std::move(values[i]));
         }
     }
 }
@@ -296,11 +448,32 @@ ItemTable::adjustColumnsWidths()
     return realWidth <= maxWidth;
 }
 
+void
+ItemTable::printDelimited(std::ostream &os, const Row &row)
+{
+    for (std::size_t i = 0U, n = cols.size(); i < n; ++i) {
+        const std::size_t keyIdx = columnSortKeys[i];
+        std::string value = (keyIdx == std::string::npos)
+                          ? row.item->getValue(cols[i].getKey())
+                          : row.keys[keyIdx];
+
+        if (separator == '\0') {
+            os << value << '\0';
+            continue;
+        }
+
+        // Keep values from breaking structure of the output.
+        std::replace(value.begin(), value.end(), separator, ' ');
+        std::replace(value.begin(), value.end(), '\n', ' ');
+        os << value << (i + 1U == n ? '\n' : separator);
+    }
+}
+
 void
 ItemTable::printTableHeader(std::ostream &os)
 {
     for (Column &col : cols) {
-        decorate(os, nullptr)
+        decorate(os, headingRule)
            << std::setw(col.getWidth()) << std::left << col.getHeading()
            << (colorRules.empty() ? decor::none : decor::def);
 
@@ -314,8 +487,12 @@ ItemTable::printTableHeader(std::ostream &os)
 void
 ItemTable::printTableRows(std::ostream &os)
 {
-    for (unsigned int i = 0, n = items.size(); i < n; ++i) {
-        decorate(os, &items[i].get());
+    for (unsigned int i = 0, n = rows.size(); i < n; ++i) {
+        if (RedirectToPager::isConsumerGone()) {
+            break;
+        }
+
+        decorate(os, rows[i].colorRule);
         for (Column &col : cols) {
             os << std::setw(col.getWidth()) << std::left << col[i];
             if (&col != &cols.back()) {
@@ -327,34 +504,47 @@ ItemTable::printTableRows(std::ostream &os)
     }
 }
 
-std::ostream &
-ItemTable::decorate(std::ostream &os, Item *item)
+const ColorRule *
+ItemTable::matchColorRule(const Row &row,
+                          const std::vector<std::string> &values)
 {
-    const ColorRule *match = nullptr;
+    Item &item = *row.item;
+
+    // Values of columns are used instead of looking them up in the item.
+    auto accessor = [&](const std::string &key) -> std::vector<std::string> {
+        if (key == "_any") {
+            std::vector<std::string> all;
+            for (const std::string &name : item.listRecordNames()) {
+                all.push_back(item.getValue(name));
+            }
+            return all;
+        }
 
-    for (const ColorRule &rule : colorRules) {
-        for (const Cond &cond : rule.conds) {
-            if (cond.key == "!heading") {
-                if (item == nullptr) {
-                    match = &rule;
-                    break;
-                }
-            } else if (item != nullptr) {
-                if (ItemFilter(cond).passes(*item)) {
-                    match = &rule;
-                    break;
-                }
+        for (std::size_t i = 0U, n = cols.size(); i < n; ++i) {
+            if (cols[i].getKey() == key) {
+                return { values[i] };
             }
         }
-        if (match != nullptr) {
-            break;
+        return { item.getValue(key) };
+    };
+
+    for (const CompiledRule &compiled : compiledRules) {
+        for (const ItemFilter &filter : compiled.filters) {
+            if (filter.passes(accessor)) {
+                return compiled.rule;
+            }
         }
     }
 
-    if (match != nullptr) {
-        os << match->decors;
-    }
+    return nullptr;
+}
 
+std::ostream &
+ItemTable::decorate(std::ostream &os, const ColorRule *rule)
+{
+    if (rule != nullptr) {
+        os << rule->decors;
+    }
     return os;
 }
 
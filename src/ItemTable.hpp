@@ -17,7 +17,8 @@
 #ifndef DIT__ITEMTABLE_HPP__
 #define DIT__ITEMTABLE_HPP__
 
-#include <functional>
+#include <cstddef>
+
 #include <iosfwd>
 #include <string>
 #include <vector>
@@ -34,6 +35,8 @@ struct ColorRule;
 class ItemTable
 {
     class Column;
+    struct Row;
+    struct CompiledRule;
 
 public:
     /**
@@ -41,13 +44,15 @@ public:
      *
      * @param fmt Format specification: <field>,<field>...
      * @param colorSpec Colorization specification: <dec>... <cond>... ; ...
-     * @param sort Multi-key sorting specification: <field>,<field>...
+     * @param sort Multi-key sorting specification: [-]<field>,[-]<field>...
      * @param maxWidth Maximum allowed table width.
+     * @param limit Maximum number of items to keep (@c 0 means no limit).
      *
      * @throws std::runtime_error On failed parsing of @p colorSpec.
      */
     ItemTable(const std::string &fmt, const std::string &colorSpec,
-              std::string sort, unsigned int maxWidth);
+              const std::string &sort, unsigned int maxWidth,
+              unsigned int limit = 0U);
     /**
      * @brief To emit destructing code in corresponding source file.
      */
@@ -57,9 +62,41 @@ public:
     /**
      * @brief Adds item to the table.
      *
+     * When number of items is limited, only the first items in sorting order
+     * are retained, so the item might be dropped here.
+     *
      * @param item Item to add.
      */
     void append(Item &item);
+    /**
+     * @brief Checks whether appending more items can't change the output.
+     *
+     * This is the case when number of items is limited, no sorting is
+     * requested and the limit is reached.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    bool isFull() const;
+    /**
+     * @brief Checks whether rows are printed as soon as they are appended.
+     *
+     * This is the case for delimited output without sorting.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    bool isStreaming() const;
+    /**
+     * @brief Switches table to printing delimited rows without heading.
+     *
+     * Columns aren't aligned and values aren't truncated in this mode.  If no
+     * sorting is requested, rows are written to @p os by append() and are
+     * flushed right away, otherwise they are written by print().
+     *
+     * @param os Stream for rows that are printed on appending.
+     * @param separator Either @c '\t' for a line per row or @c '\0' to
+     *                  terminate every value with a null character.
+     */
+    void makeDelimited(std::ostream &os, char separator);
     /**
      * @brief Prints table on standard output.
      *
@@ -68,6 +105,15 @@ public:
     void print(std::ostream &os);
 
 private:
+    /**
+     * @brief Checks whether one row precedes another one in sorting order.
+     *
+     * @param a First row.
+     * @param b Second row.
+     *
+     * @returns @c true if @p a goes before @p b.
+     */
+    bool isBefore(const Row &a, const Row &b) const;
     /**
      * @brief Ensures that items are in correct order.
      */
@@ -82,6 +128,13 @@ private:
      * @returns @c true on successful shrinking or @c false on failure.
      */
     bool adjustColumnsWidths();
+    /**
+     * @brief Prints single row in delimited form.
+     *
+     * @param os Output stream.
+     * @param row Row to print.
+     */
+    void printDelimited(std::ostream &os, const Row &row);
     /**
      * @brief Print table heading.
      *
@@ -95,37 +148,84 @@ private:
      */
     void printTableRows(std::ostream &os);
     /**
-     * @brief Applies item/structure-specific decorators to a stream.
+     * @brief Finds colorization rule that matches a row.
+     *
+     * @param row Row to match.
+     * @param values Values of columns of the row.
+     *
+     * @returns The rule or @c nullptr if none matches.
+     */
+    const ColorRule * matchColorRule(const Row &row,
+                                     const std::vector<std::string> &values);
+    /**
+     * @brief Applies decorators of a colorization rule to a stream.
      *
      * @param os Stream to be decorated.
-     * @param item Item for which stream should be decorated or @c nullptr for
-     *             headers.
+     * @param rule Rule to apply or @c nullptr.
      *
      * @returns @p os
      */
-    std::ostream & decorate(std::ostream &os, Item *item);
+    std::ostream & decorate(std::ostream &os, const ColorRule *rule);
 
 private:
     /**
-     * @brief Sorting specification.
+     * @brief Keys to sort by in order of their priority.
+     */
+    std::vector<std::string> sortKeys;
+    /**
+     * @brief Whether corresponding element of @c sortKeys is sorted in
+     *        descending order.
      */
-    const std::string sort;
+    std::vector<bool> descending;
+    /**
+     * @brief Maps columns to indexes of the same keys in @c sortKeys.
+     *
+     * Absent keys are represented by @c std::string::npos.
+     */
+    std::vector<std::size_t> columnSortKeys;
     /**
      * @brief Maximum allowed table width.
      */
     const unsigned int maxWidth;
+    /**
+     * @brief Maximum number of items to display (@c 0 means no limit).
+     */
+    const unsigned int limit;
+    /**
+     * @brief Number of items appended so far.
+     */
+    std::size_t appended;
+    /**
+     * @brief Stream for rows printed on appending in delimited mode or
+     *        @c nullptr if table isn't delimited.
+     */
+    std::ostream *stream;
+    /**
+     * @brief Value separator of delimited mode.
+     */
+    char separator;
     /**
      * @brief List of columns of the table (built from the format).
      */
     std::vector<Column> cols;
     /**
-     * @brief List of items to display.
+     * @brief Items to display along with their sorting keys.
+     *
+     * Organized as a max-heap when number of items is limited.
      */
-    std::vector<std::reference_wrapper<Item>> items;
+    std::vector<Row> rows;
     /**
      * @brief Rules for table colorization.
      */
     std::vector<ColorRule> colorRules;
+    /**
+     * @brief Conditions of @c colorRules prepared for matching rows.
+     */
+    std::vector<CompiledRule> compiledRules;
+    /**
+     * @brief Rule for table heading or @c nullptr.
+     */
+    const ColorRule *headingRule;
 };
 
 #endif // DIT__ITEMTABLE_HPP__
@@ -0,0 +1,265 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Journal.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "utils/fs.hpp"
+#include "Change.hpp"
+#include "file_format.hpp"
+
+namespace fs = boost::filesystem;
+
+static void addRecord(std::string &to, const std::string &kind,
+                      const std::string &name, const std::string &body);
+static std::string getBootId();
+
+Journal::Journal(std::string path) : path(std::move(path))
+{
+}
+
+void
+Journal::addItem(const std::string &id, const std::vector<Change> &changes,
+                 std::size_t from)
+{
+    std::ostringstream oss;
+    if (from == 0U) {
+        writeChanges(oss, changes, 0U);
+        addRecord(pending, "item", id, oss.str());
+        return;
+    }
+
+    // Tail is written on its own to make it start with a timestamp.
+    const std::vector<Change> tail(changes.cbegin() + from, changes.cend());
+    writeChanges(oss, tail, 0U);
+    addRecord(pending, "tail", id + ' ' + std::to_string(from), oss.str());
+}
+
+void
+Journal::addSetting(const std::string &key, const std::string &value)
+{
+    addRecord(pending, "set", key, value);
+}
+
+/**
+ * @brief Serializes a record.
+ *
+ * @param to Destination.
+ * @param kind Kind of the record.
+ * @param name Name of the record.
+ * @param body Contents of the record.
+ */
+static void
+addRecord(std::string &to, const std::string &kind, const std::string &name,
+          const std::string &body)
+{
+    to += kind + ' ' + name + ' ' + std::to_string(body.size()) + '\n';
+    to += body;
+}
+
+void
+Journal::commit()
+{
+    if (pending.empty()) {
+        return;
+    }
+
+    pending += "end\n";
+
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0666);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    // Torn transaction must not precede the next one, so drop it right away.
+    const off_t end = ::lseek(fd, 0, SEEK_END);
+    if (end == -1 || !writeFully(fd, pending) || ::fsync(fd) != 0) {
+        if (end != -1) {
+            (void)::ftruncate(fd, end);
+        }
+        ::close(fd);
+        throw std::runtime_error("Failed to write " + path);
+    }
+
+    ::close(fd);
+    pending.clear();
+}
+
+bool
+Journal::markApplied()
+{
+    const std::string bootId = getBootId();
+    if (bootId.empty()) {
+        return false;
+    }
+
+    const int fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+    if (fd == -1) {
+        return false;
+    }
+
+    const bool written = writeFully(fd, "applied " + bootId + '\n');
+    ::close(fd);
+    return written;
+}
+
+bool
+Journal::isApplied() const
+{
+    const std::string bootId = getBootId();
+    if (bootId.empty()) {
+        return false;
+    }
+
+    const std::string mark = "applied " + bootId + '\n';
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.seekg(0, std::ios::end)) {
+        return false;
+    }
+    const std::streamoff size = file.tellg();
+    if (size < static_cast<std::streamoff>(mark.size()) ||
+        !file.seekg(size - mark.size())) {
+        return false;
+    }
+
+    std::string tail(mark.size(), '\0');
+    return file.read(&tail[0], tail.size()) && tail == mark;
+}
+
+/**
+ * @brief Retrieves identifier of current boot of the system.
+ *
+ * @returns The identifier or empty string if it's not available.
+ */
+static std::string
+getBootId()
+{
+    std::ifstream file("/proc/sys/kernel/random/boot_id");
+    std::string bootId;
+    std::getline(file, bootId);
+    return bootId;
+}
+
+std::uintmax_t
+Journal::getSize() const
+{
+    boost::system::error_code ec;
+    const std::uintmax_t size = fs::file_size(path, ec);
+    return ec ? 0U : size;
+}
+
+bool
+Journal::exists() const
+{
+    return fs::exists(path);
+}
+
+void
+Journal::replay(const itemHandler &onItem, const settingHandler &onSetting)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+
+    struct Record
+    {
+        std::string kind;
+        std::string name;
+        std::size_t from;
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    std::vector<Record> transaction;
+    std::size_t pos = 0U;
+    while (pos < data.size()) {
+        const std::size_t eol = data.find('\n', pos);
+        if (eol == std::string::npos) {
+            break;
+        }
+
+        std::istringstream header(data.substr(pos, eol - pos));
+        pos = eol + 1U;
+
+        Record record;
+        if (!(header >> record.kind)) {
+            throw std::runtime_error("Broken journal: " + path);
+        }
+
+        if (record.kind == "applied") {
+            // Replaying is idempotent, so applied transactions aren't skipped.
+            continue;
+        }
+
+        if (record.kind == "end") {
+            for (const Record &r : transaction) {
+                if (r.kind != "set") {
+                    std::vector<Change> changes;
+                    if (r.size != 0U) {
+                        parseChanges(&data[r.offset], r.size, changes);
+                    }
+                    onItem(r.name, r.from, std::move(changes));
+                } else {
+                    onSetting(r.name, data.substr(r.offset, r.size));
+                }
+            }
+            transaction.clear();
+            continue;
+        }
+
+        record.from = 0U;
+        if ((record.kind != "item" && record.kind != "tail" &&
+             record.kind != "set") ||
+            !(header >> record.name) ||
+            (record.kind == "tail" && !(header >> record.from)) ||
+            !(header >> record.size)) {
+            throw std::runtime_error("Broken journal: " + path);
+        }
+
+        if (record.size > data.size() - pos) {
+            break;
+        }
+
+        record.offset = pos;
+        pos += record.size;
+        transaction.push_back(std::move(record));
+    }
+}
+
+void
+Journal::discard()
+{
+    boost::system::error_code ec;
+    fs::remove(path, ec);
+    if (ec) {
+        throw std::runtime_error("Failed to remove " + path);
+    }
+}
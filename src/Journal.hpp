@@ -0,0 +1,150 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DIT__JOURNAL_HPP__
+#define DIT__JOURNAL_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class Change;
+
+/**
+ * @brief Write-ahead log of project changes.
+ *
+ * Changes of a save are recorded here as a single transaction which is synced
+ * to disk before any of item files or configuration is touched.  This is the
+ * only sync of a save, files are written without waiting for them to reach the
+ * disk.  Once all of them are written, the transaction is marked as applied
+ * within current boot of the system, which survives crashes of the process but
+ * not of the system.  If the mark is missing or belongs to a previous boot,
+ * complete transactions are replayed on the next open of the project.  The
+ * journal is discarded after everything it covers is synced.
+ *
+ * Rewritten items are recorded with complete change sets.  Other items are
+ * recorded with changes that are appended to them along with number of already
+ * stored changes, so replaying can drop partially appended tail.
+ */
+class Journal
+{
+public:
+    /**
+     * @brief Type of handler of items being replayed.
+     */
+    using itemHandler = std::function<void(const std::string &id,
+                                           std::size_t from,
+                                           std::vector<Change> changes)>;
+    /**
+     * @brief Type of handler of settings being replayed.
+     */
+    using settingHandler = std::function<void(const std::string &key,
+                                              const std::string &value)>;
+
+public:
+    /**
+     * @brief Creates journal backed by the specified file.
+     *
+     * @param path Path to the file.
+     */
+    explicit Journal(std::string path);
+
+public:
+    /**
+     * @brief Adds item to the pending transaction.
+     *
+     * @param id Id of the item.
+     * @param changes All changes of the item.
+     * @param from Number of changes that are kept in storage (@c 0 if item
+     *             is rewritten).
+     */
+    void addItem(const std::string &id, const std::vector<Change> &changes,
+                 std::size_t from);
+    /**
+     * @brief Adds value of a setting to the pending transaction.
+     *
+     * @param key Name of the setting.
+     * @param value New value.
+     */
+    void addSetting(const std::string &key, const std::string &value);
+    /**
+     * @brief Durably appends pending transaction to the file.
+     *
+     * Does nothing if the transaction is empty.
+     *
+     * @throws std::runtime_error On write failure.
+     */
+    void commit();
+    /**
+     * @brief Marks all transactions as applied within current boot.
+     *
+     * The mark isn't synced, it's lost along with unsynced data.
+     *
+     * @returns @c false if the mark can't be made, @c true otherwise.
+     */
+    bool markApplied();
+    /**
+     * @brief Checks whether all transactions were applied within current boot.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    bool isApplied() const;
+    /**
+     * @brief Retrieves size of the file.
+     *
+     * @returns The size or @c 0 if the file doesn't exist.
+     */
+    std::uintmax_t getSize() const;
+    /**
+     * @brief Checks whether there are transactions that weren't discarded.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    bool exists() const;
+    /**
+     * @brief Invokes handlers for each record of complete transactions.
+     *
+     * Torn transaction at the end of the file is skipped.  Item handler
+     * receives changes that follow first @c from stored changes.
+     *
+     * @param onItem Handler of items.
+     * @param onSetting Handler of settings.
+     *
+     * @throws std::runtime_error On broken file.
+     */
+    void replay(const itemHandler &onItem, const settingHandler &onSetting);
+    /**
+     * @brief Removes the file.
+     *
+     * @throws std::runtime_error On failure.
+     */
+    void discard();
+
+private:
+    /**
+     * @brief Path to the file.
+     */
+    const std::string path;
+    /**
+     * @brief Serialized records of pending transaction.
+     */
+    std::string pending;
+};
+
+#endif // DIT__JOURNAL_HPP__
@@ -0,0 +1,145 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "KeyTable.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "utils/fs.hpp"
+#include "Change.hpp"
+
+KeyTable::KeyTable(std::string path) : path(std::move(path))
+{
+    const int fd = ::open(this->path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+
+    try {
+        readTail(fd);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+}
+
+Change::KeyId
+KeyTable::getKey(std::uint64_t id) const
+{
+    if (id >= keys.size()) {
+        throw std::runtime_error("Unknown key number: " + std::to_string(id));
+    }
+    return keys[id];
+}
+
+std::uint64_t
+KeyTable::getId(Change::KeyId key)
+{
+    const auto it = ids.find(key);
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0666);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    // Lock is released on closing the file.
+    std::uint64_t id;
+    try {
+        id = addKey(fd, key);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    return id;
+}
+
+std::uint64_t
+KeyTable::addKey(int fd, Change::KeyId key)
+{
+    if (::flock(fd, LOCK_EX) != 0) {
+        throw std::runtime_error("Failed to lock " + path);
+    }
+
+    // Other processes might have added keys since the file was read.
+    readTail(fd);
+    const auto it = ids.find(key);
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    // Torn line must not prefix the new one.
+    if (::ftruncate(fd, size) != 0 || !writeFully(fd, *key + '\n') ||
+        ::fsync(fd) != 0) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+    size += key->size() + 1U;
+
+    const std::uint64_t id = keys.size();
+    ids.emplace(key, id);
+    keys.push_back(key);
+    return id;
+}
+
+void
+KeyTable::readTail(int fd)
+{
+    std::string data;
+    char buf[4096];
+    while (true) {
+        const ssize_t n = ::pread(fd, buf, sizeof(buf), size + data.size());
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1) {
+            throw std::runtime_error("Failed to read " + path);
+        }
+        if (n == 0) {
+            break;
+        }
+        data.append(buf, n);
+    }
+
+    std::size_t pos = 0U;
+    std::size_t eol;
+    while ((eol = data.find('\n', pos)) != std::string::npos) {
+        const std::string line = data.substr(pos, eol - pos);
+        if (line.empty() || line.find('=') != std::string::npos) {
+            throw std::runtime_error("Broken key table line: " + line);
+        }
+
+        const Change::KeyId key = Change::internKey(line);
+        ids.emplace(key, keys.size());
+        keys.push_back(key);
+        pos = eol + 1U;
+    }
+    size += pos;
+}
@@ -0,0 +1,121 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DIT__KEYTABLE_HPP__
+#define DIT__KEYTABLE_HPP__
+
+#include <sys/types.h>
+
+#include <cstdint>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Change.hpp"
+
+/**
+ * @brief Persistent numbering of keys of a project.
+ *
+ * Binary change sets refer to keys by their numbers, which are defined by this
+ * table.  The file lists one key per line and only grows, so numbers never
+ * change.  Keys are added under a lock after rereading the file, so tables of
+ * different processes agree on numbers.
+ */
+class KeyTable
+{
+public:
+    /**
+     * @brief Reads table from the specified file.
+     *
+     * Absent file is treated as an empty table.
+     *
+     * @param path Path to the file.
+     *
+     * @throws std::runtime_error On broken file.
+     */
+    explicit KeyTable(std::string path);
+
+public:
+    /**
+     * @brief Retrieves key by its number.
+     *
+     * Can be called concurrently with itself.
+     *
+     * @param id Number of the key.
+     *
+     * @returns The key.
+     *
+     * @throws std::runtime_error On unknown number.
+     */
+    Change::KeyId getKey(std::uint64_t id) const;
+    /**
+     * @brief Retrieves number of a key adding it to the table if needed.
+     *
+     * New keys are synced to disk immediately, so that data referring to them
+     * can't be stored before them.
+     *
+     * @param key The key.
+     *
+     * @returns Number of the key.
+     *
+     * @throws std::runtime_error On broken file or write failure.
+     */
+    std::uint64_t getId(Change::KeyId key);
+
+private:
+    /**
+     * @brief Adds keys of the file that follow already read ones.
+     *
+     * Incomplete last line is left out.
+     *
+     * @param fd Descriptor of the file.
+     *
+     * @throws std::runtime_error On broken file or read failure.
+     */
+    void readTail(int fd);
+    /**
+     * @brief Appends key to the file after reading keys added by others.
+     *
+     * @param fd Descriptor of the file.
+     * @param key The key.
+     *
+     * @returns Number of the key.
+     *
+     * @throws std::runtime_error On broken file or I/O failure.
+     */
+    std::uint64_t addKey(int fd, Change::KeyId key);
+
+private:
+    /**
+     * @brief Path to the file.
+     */
+    const std::string path;
+    /**
+     * @brief Keys by their numbers.
+     */
+    std::vector<Change::KeyId> keys;
+    /**
+     * @brief Numbers of keys.
+     */
+    std::unordered_map<Change::KeyId, std::uint64_t> ids;
+    /**
+     * @brief Size of the part of the file that was read.
+     */
+    off_t size = 0;
+};
+
+#endif // DIT__KEYTABLE_HPP__
@@ -0,0 +1,558 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PackedBackend.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "utils/fs.hpp"
+#include "utils/getLines.hpp"
+#include "ChangeFormat.hpp"
+#include "Project.hpp"
+#include "file_format.hpp"
+
+namespace fs = boost::filesystem;
+
+static std::uint64_t getRecordSize(const std::string &id, std::uint64_t size,
+                                   bool append);
+static std::string formatIndexLine(const std::string &id,
+                                   std::uint64_t offset, std::uint64_t size,
+                                   bool append);
+static bool parseSize(const std::string &str, std::uint64_t &size,
+                      bool &append);
+
+PackedBackend::PackedBackend(Project &project, ChangeFormat &format)
+    : StorageBackend(format), project(project),
+      packPath((fs::path(project.getRootDir())/"items.pack").string()),
+      indexPath((fs::path(project.getRootDir())/"items.idx").string())
+{
+}
+
+PackedBackend::~PackedBackend()
+{
+}
+
+std::vector<std::string>
+PackedBackend::listIds()
+{
+    loadIndex();
+
+    std::vector<std::string> ids;
+    ids.reserve(index.size());
+    for (const auto &e : index) {
+        ids.push_back(e.first);
+    }
+    return ids;
+}
+
+void
+PackedBackend::prefetch()
+{
+    loadIndex();
+
+    // Make sure that recently written records are visible.
+    if (pack.is_open()) {
+        pack.flush();
+    }
+
+    std::ifstream file(packPath, std::ios::in | std::ios::binary);
+    if (!file) {
+        return;
+    }
+
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> spans;
+    for (const auto &e : index) {
+        for (const Record &record : e.second) {
+            spans.emplace_back(record.offset, record.offset + record.size);
+        }
+    }
+    std::sort(spans.begin(), spans.end());
+
+    // Reading headers and short runs of superseded records is cheaper than
+    // seeking over them.
+    const std::uint64_t maxGap = 4096U;
+
+    data.assign(packEnd, '\0');
+    std::size_t i = 0U;
+    while (i < spans.size()) {
+        const std::uint64_t from = spans[i].first;
+        std::uint64_t to = spans[i].second;
+        while (++i < spans.size() && spans[i].first <= to + maxGap) {
+            to = std::max(to, spans[i].second);
+        }
+
+        if (!file.seekg(from) || !file.read(&data[from], to - from)) {
+            data.clear();
+            throw std::runtime_error("Failed to read " + packPath);
+        }
+    }
+}
+
+void
+PackedBackend::read(const std::string &id, std::vector<Change> &changes)
+{
+    loadIndex();
+
+    const auto it = index.find(id);
+    if (it == index.end()) {
+        throw std::runtime_error("Failed to read change set of " + id);
+    }
+
+    // Parse prefetched data in place when possible.
+    const std::vector<Record> &records = it->second;
+    if (records.size() == 1U &&
+        records[0].offset + records[0].size <= data.size()) {
+        getFormat().read(&data[records[0].offset], records[0].size, changes);
+        return;
+    }
+
+    std::string body;
+    for (const Record &record : records) {
+        body += readRecord(id, record);
+    }
+
+    getFormat().read(body.data(), body.size(), changes);
+}
+
+std::string
+PackedBackend::readRecord(const std::string &id, const Record &record)
+{
+    if (record.offset + record.size <= data.size()) {
+        return data.substr(record.offset, record.size);
+    }
+
+    // Make sure that recently written records are visible.
+    if (pack.is_open()) {
+        pack.flush();
+    }
+
+    std::ifstream file(packPath, std::ios::in | std::ios::binary);
+    std::string buf(record.size, '\0');
+    if (!file.seekg(record.offset) || !file.read(&buf[0], buf.size())) {
+        throw std::runtime_error("Failed to read change set of " + id);
+    }
+    return buf;
+}
+
+std::string
+PackedBackend::getStamp(const std::string &id)
+{
+    loadIndex();
+
+    const auto it = index.find(id);
+    if (it == index.end()) {
+        return std::string();
+    }
+
+    std::string stamp;
+    for (const Record &record : it->second) {
+        if (!stamp.empty()) {
+            stamp += ',';
+        }
+        stamp += std::to_string(record.offset) + '+'
+               + std::to_string(record.size);
+    }
+    return stamp;
+}
+
+bool
+PackedBackend::isCompressed(const std::string &id)
+{
+    loadIndex();
+
+    const auto it = index.find(id);
+    if (it == index.end() || it->second.front().size == 0U) {
+        return false;
+    }
+
+    Record head = it->second.front();
+    head.size = std::min<std::uint64_t>(head.size, 4U);
+    const std::string header = readRecord(id, head);
+    return ChangeFormat::isCompressed(header.data(), header.size());
+}
+
+void
+PackedBackend::write(const std::string &id, const std::vector<Change> &changes,
+                     bool compress)
+{
+    ChangeFormat &format = getFormat();
+
+    std::ostringstream oss;
+    if (compress) {
+        format.writeCompressed(oss, changes, format.isBinary());
+    } else {
+        format.write(oss, changes, 0U, format.isBinary());
+    }
+    writeRecord(id, oss.str(), false);
+}
+
+void
+PackedBackend::append(const std::string &id, const std::vector<Change> &changes,
+                      std::size_t from)
+{
+    loadIndex();
+
+    const auto it = index.find(id);
+    if (it == index.end() || it->second.front().size == 0U) {
+        // Nothing to append to.
+        write(id, changes, false);
+        return;
+    }
+
+    // Tail must be in the same form as preceding records.
+    Record head = it->second.front();
+    head.size = std::min<std::uint64_t>(head.size, 4U);
+    const std::string header = readRecord(id, head);
+    if (ChangeFormat::isCompressed(header.data(), header.size())) {
+        // Item is no longer cold, so store it as a regular one.
+        write(id, changes, false);
+        return;
+    }
+    const bool binary = isBinaryChanges(header.data(), header.size());
+
+    std::ostringstream oss;
+    getFormat().write(oss, changes, from, binary);
+    writeRecord(id, oss.str(), true);
+}
+
+void
+PackedBackend::writeRecord(const std::string &id, const std::string &body,
+                           bool append)
+{
+    loadIndex();
+
+    if (!pack.is_open()) {
+        // Drop incomplete record that might have been left by a failed write.
+        if (fs::exists(packPath) && fs::file_size(packPath) > packEnd) {
+            fs::resize_file(packPath, packEnd);
+        }
+
+        pack.open(packPath, std::ios::out | std::ios::app | std::ios::binary);
+        if (!pack) {
+            throw std::runtime_error("Failed to open " + packPath);
+        }
+    }
+
+    const std::string size = (append ? "+" : "") + std::to_string(body.size());
+    const std::string header = id + ' ' + size + '\n';
+
+    if (!pack.write(header.data(), header.size()) ||
+        !pack.write(body.data(), body.size())) {
+        throw std::runtime_error("Failed to write change set of " + id);
+    }
+
+    const Record record = { packEnd + header.size(), body.size(), append };
+    packEnd = record.offset + record.size;
+    addRecord(id, record);
+    newRecords.emplace_back(id, record);
+}
+
+void
+PackedBackend::addRecord(const std::string &id, const Record &record)
+{
+    std::vector<Record> &records = index[id];
+    if (!record.append) {
+        for (const Record &r : records) {
+            liveSize -= getRecordSize(id, r.size, r.append);
+        }
+        records.clear();
+    }
+    records.push_back(record);
+    liveSize += getRecordSize(id, record.size, record.append);
+}
+
+void
+PackedBackend::commit()
+{
+    if (pack.is_open() && !pack.flush()) {
+        throw std::runtime_error("Failed to write " + packPath);
+    }
+
+    if (newRecords.empty()) {
+        return;
+    }
+
+    // Data must be durable before index points to it.
+    syncPath(packPath);
+
+    std::ofstream file(indexPath, std::ios::out | std::ios::app);
+    for (const auto &e : newRecords) {
+        file << formatIndexLine(e.first, e.second.offset, e.second.size,
+                                e.second.append);
+    }
+    if (!file.flush()) {
+        throw std::runtime_error("Failed to write " + indexPath);
+    }
+    file.close();
+    syncPath(indexPath);
+
+    newRecords.clear();
+
+    if (packEnd > 2U*liveSize) {
+        repack();
+    }
+}
+
+void
+PackedBackend::repack()
+{
+    loadIndex();
+    if (packEnd == liveSize) {
+        return;
+    }
+
+    prefetch();
+
+    std::string packed;
+    std::map<std::string, std::vector<Record>> repacked;
+    for (const auto &e : index) {
+        std::string body;
+        for (const Record &record : e.second) {
+            body += readRecord(e.first, record);
+        }
+
+        packed += e.first + ' ' + std::to_string(body.size()) + '\n';
+        repacked[e.first].push_back({ packed.size(), body.size(), false });
+        packed += body;
+    }
+
+    const std::string tmpPackPath = packPath + ".tmp";
+    std::ofstream packFile(tmpPackPath, std::ios::out | std::ios::binary);
+    if (!packFile.write(packed.data(), packed.size()) || !packFile.flush()) {
+        throw std::runtime_error("Failed to write " + tmpPackPath);
+    }
+    packFile.close();
+    syncPath(tmpPackPath);
+
+    const std::string tmpIndexPath = indexPath + ".tmp";
+    std::ofstream indexFile(tmpIndexPath, std::ios::out);
+    for (const auto &e : repacked) {
+        const Record &record = e.second.front();
+        indexFile << formatIndexLine(e.first, record.offset, record.size,
+                                     record.append);
+    }
+    if (!indexFile.flush()) {
+        throw std::runtime_error("Failed to write " + tmpIndexPath);
+    }
+    indexFile.close();
+    syncPath(tmpIndexPath);
+
+    if (pack.is_open()) {
+        pack.close();
+    }
+
+    // Data file without index is scanned as a whole, so files never disagree.
+    fs::remove(indexPath);
+    fs::rename(tmpPackPath, packPath);
+    fs::rename(tmpIndexPath, indexPath);
+    syncPath(fs::path(packPath).parent_path().string());
+
+    index = std::move(repacked);
+    newRecords.clear();
+    packEnd = liveSize = packed.size();
+    data = std::move(packed);
+}
+
+void
+PackedBackend::clear()
+{
+    if (pack.is_open()) {
+        pack.close();
+    }
+
+    fs::remove(packPath);
+    fs::remove(indexPath);
+
+    index.clear();
+    newRecords.clear();
+    data.clear();
+    packEnd = 0U;
+    liveSize = 0U;
+}
+
+bool
+PackedBackend::listChanged(const std::vector<std::string> &paths,
+                           std::set<std::string> &ids)
+{
+    const bool touched = std::any_of(paths.cbegin(), paths.cend(),
+                                     [this](const std::string &path) {
+                                         return fs::path(path) == packPath
+                                             || fs::path(path) == indexPath;
+                                     });
+    if (!touched) {
+        return true;
+    }
+    if (!indexLoaded) {
+        return false;
+    }
+
+    PackedBackend current(project, getFormat());
+    current.loadIndex();
+
+    auto sameRecords = [](const std::vector<Record> &a,
+                          const std::vector<Record> &b) {
+        return a.size() == b.size()
+            && std::equal(a.cbegin(), a.cend(), b.cbegin(),
+                          [](const Record &x, const Record &y) {
+                              return x.offset == y.offset
+                                  && x.size == y.size
+                                  && x.append == y.append;
+                          });
+    };
+
+    for (const auto &e : current.index) {
+        const auto it = index.find(e.first);
+        if (it == index.end() || !sameRecords(it->second, e.second)) {
+            ids.insert(e.first);
+        }
+    }
+    for (const auto &e : index) {
+        if (current.index.find(e.first) == current.index.end()) {
+            ids.insert(e.first);
+        }
+    }
+    return true;
+}
+
+void
+PackedBackend::loadIndex()
+{
+    if (indexLoaded) {
+        return;
+    }
+    indexLoaded = true;
+
+    std::ifstream file(indexPath);
+    for (const std::string &line : getLines(file)) {
+        std::istringstream iss(line);
+        std::string id, size;
+        Record record;
+        if (!(iss >> id >> record.offset >> size) ||
+            !parseSize(size, record.size, record.append)) {
+            throw std::runtime_error("Broken index line: " + line);
+        }
+
+        addRecord(id, record);
+        packEnd = std::max(packEnd, record.offset + record.size);
+    }
+
+    // Pick up records that were written, but didn't make it into the index.
+    if (fs::exists(packPath) && fs::file_size(packPath) > packEnd) {
+        scanPack(packEnd);
+    }
+}
+
+void
+PackedBackend::scanPack(std::uint64_t from)
+{
+    std::ifstream file(packPath, std::ios::in | std::ios::binary);
+    const std::uint64_t fileSize = fs::file_size(packPath);
+
+    file.seekg(from);
+    for (const std::string &header : getLines(file)) {
+        std::istringstream iss(header);
+        std::string id, size;
+        Record record;
+        if (!(iss >> id >> size) ||
+            !parseSize(size, record.size, record.append)) {
+            break;
+        }
+
+        record.offset = from + header.size() + 1U;
+        if (record.offset + record.size > fileSize) {
+            break;
+        }
+
+        addRecord(id, record);
+        newRecords.emplace_back(id, record);
+
+        from = packEnd = record.offset + record.size;
+        if (!file.seekg(from)) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Computes size of a record in data file.
+ *
+ * @param id Id of the item.
+ * @param size Size of change set.
+ * @param append Whether record continues previous one.
+ *
+ * @returns The size including header of the record.
+ */
+static std::uint64_t
+getRecordSize(const std::string &id, std::uint64_t size, bool append)
+{
+    return id.size() + 1U + (append ? 1U : 0U) + std::to_string(size).size()
+         + 1U + size;
+}
+
+/**
+ * @brief Formats line of index file.
+ *
+ * @param id Id of the item.
+ * @param offset Offset of change set in data file.
+ * @param size Size of change set.
+ * @param append Whether record continues previous one.
+ *
+ * @returns The line.
+ */
+static std::string
+formatIndexLine(const std::string &id, std::uint64_t offset,
+                std::uint64_t size, bool append)
+{
+    return id + ' ' + std::to_string(offset) + ' ' + (append ? "+" : "")
+         + std::to_string(size) + '\n';
+}
+
+/**
+ * @brief Parses size of a record.
+ *
+ * @param str Size in text form (`[+]<number>`).
+ * @param[out] size Parsed size.
+ * @param[out] append Whether size is prefixed with a plus.
+ *
+ * @returns @c true on success, @c false otherwise.
+ */
+static bool
+parseSize(const std::string &str, std::uint64_t &size, bool &append)
+{
+    append = (!str.empty() && str[0] == '+');
+
+    const std::string digits = str.substr(append ? 1U : 0U);
+    if (digits.empty() ||
+        digits.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+
+    size = std::stoull(digits);
+    return true;
+}
@@ -0,0 +1,235 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DIT__PACKEDBACKEND_HPP__
+#define DIT__PACKEDBACKEND_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "StorageBackend.hpp"
+
+/**
+ * @brief Backend that keeps all items in a single append-only file.
+ *
+ * Data file (`items.pack`) is a sequence of records of the form
+ * `<id> <size>\n<change set of the size>`, where later records of an item
+ * supersede earlier ones.  Records with size prefixed by `+` continue change
+ * set of preceding records of the item instead.  Index file (`items.idx`)
+ * consists of lines of the form `<id> <offset> <size>\n` that point to change
+ * sets in the data file.  Records missing from the index are recovered by
+ * scanning tail of data file.  Both files are rewritten to contain only live
+ * records once superseded ones take more space than live ones.
+ */
+class PackedBackend : public StorageBackend
+{
+    /**
+     * @brief Location of single change set within data file.
+     */
+    struct Record
+    {
+        std::uint64_t offset; /**< @brief Offset of change set in the file. */
+        std::uint64_t size;   /**< @brief Size of change set in bytes. */
+        bool append;          /**< @brief Whether it continues previous one. */
+    };
+
+public:
+    /**
+     * @brief Creates backend for the @p project.
+     *
+     * @param project Project whose items are managed.
+     * @param format Form of change sets.
+     */
+    PackedBackend(Project &project, ChangeFormat &format);
+    /**
+     * @brief Emit destructor code in corresponding source file.
+     */
+    ~PackedBackend();
+
+public:
+    /**
+     * @copydoc StorageBackend::listIds()
+     */
+    virtual std::vector<std::string> listIds() override;
+    /**
+     * @brief Reads all live records of data file at once.
+     */
+    virtual void prefetch() override;
+    /**
+     * @copydoc StorageBackend::read()
+     */
+    virtual void read(const std::string &id,
+                      std::vector<Change> &changes) override;
+    /**
+     * @brief Composes stamp out of locations of records of an item.
+     *
+     * New records are appended past existing ones, so any write changes the
+     * stamp.
+     *
+     * @param id Id of the item.
+     *
+     * @returns The stamp or empty string if item isn't stored.
+     *
+     * @throws std::runtime_error On broken index.
+     */
+    virtual std::string getStamp(const std::string &id) override;
+    /**
+     * @copydoc StorageBackend::isCompressed()
+     *
+     * @throws std::runtime_error On broken index or read failure.
+     */
+    virtual bool isCompressed(const std::string &id) override;
+    /**
+     * @copydoc StorageBackend::write()
+     */
+    virtual void write(const std::string &id,
+                       const std::vector<Change> &changes,
+                       bool compress) override;
+    /**
+     * @copydoc StorageBackend::append()
+     */
+    virtual void append(const std::string &id,
+                        const std::vector<Change> &changes,
+                        std::size_t from) override;
+    /**
+     * @brief Syncs data file and appends new records to the index.
+     *
+     * Repacks storage if it's mostly made of superseded records.
+     *
+     * @throws std::runtime_error On data write failure.
+     */
+    virtual void commit() override;
+    /**
+     * @brief Replaces data and index files with ones of only live records.
+     *
+     * @throws std::runtime_error On read or write failure.
+     */
+    virtual void repack() override;
+    /**
+     * @copydoc StorageBackend::clear()
+     */
+    virtual void clear() override;
+    /**
+     * @brief Compares index files to find changed items.
+     *
+     * @param paths Paths to changed files.
+     * @param[out] ids Ids of changed items.
+     *
+     * @returns @c false if index of this instance wasn't loaded, @c true
+     *          otherwise.
+     *
+     * @throws std::runtime_error On broken index.
+     */
+    virtual bool listChanged(const std::vector<std::string> &paths,
+                             std::set<std::string> &ids) override;
+
+private:
+    /**
+     * @brief Loads index if it wasn't loaded yet.
+     *
+     * @throws std::runtime_error On broken index.
+     */
+    void loadIndex();
+    /**
+     * @brief Indexes records of data file starting at specified offset.
+     *
+     * Scanning stops at first incomplete record.
+     *
+     * @param from Offset of the first record to index.
+     */
+    void scanPack(std::uint64_t from);
+    /**
+     * @brief Adds record to the index.
+     *
+     * @param id Id of the item.
+     * @param record The record.
+     */
+    void addRecord(const std::string &id, const Record &record);
+    /**
+     * @brief Appends record to the data file.
+     *
+     * @param id Id of the item.
+     * @param body Change set in stored form.
+     * @param append Whether this record continues previous ones.
+     *
+     * @throws std::runtime_error On data write failure.
+     */
+    void writeRecord(const std::string &id, const std::string &body,
+                     bool append);
+    /**
+     * @brief Retrieves raw change set.
+     *
+     * @param id Id of the item.
+     * @param record Location of the change set.
+     *
+     * @returns The change set.
+     *
+     * @throws std::runtime_error On read failure.
+     */
+    std::string readRecord(const std::string &id, const Record &record);
+
+private:
+    /**
+     * @brief Project whose items are managed.
+     */
+    Project &project;
+    /**
+     * @brief Path to the data file.
+     */
+    const std::string packPath;
+    /**
+     * @brief Path to the index file.
+     */
+    const std::string indexPath;
+    /**
+     * @brief Records that make up current change set of each item.
+     */
+    std::map<std::string, std::vector<Record>> index;
+    /**
+     * @brief Whether index was loaded.
+     */
+    bool indexLoaded = false;
+    /**
+     * @brief End of valid data in the data file.
+     */
+    std::uint64_t packEnd = 0U;
+    /**
+     * @brief Size of records (with headers) referenced by the index.
+     */
+    std::uint64_t liveSize = 0U;
+    /**
+     * @brief Records that are not in the index file yet.
+     */
+    std::vector<std::pair<std::string, Record>> newRecords;
+    /**
+     * @brief Contents of data file if it was prefetched (only live records
+     *        are filled in).
+     */
+    std::string data;
+    /**
+     * @brief Data file opened for appending (opened on first write).
+     */
+    std::ofstream pack;
+};
+
+#endif // DIT__PACKEDBACKEND_HPP__
@@ -56,6 +56,7 @@ Project::Project(std::string rootDir, mkConfig makeConfig)
       rootDir(std::move(rootDir))
 {
     dataDir = getSubRootPath(this->rootDir, "items");
+    storage.recover({});
 }
 
 Project::Project(std::string rootDir, mkConfig makeConfig, pk<Tests>)
@@ -121,6 +122,12 @@ Project::getConfig(bool proxy)
     return proxy ? configs.first : *configs.second;
 }
 
+const std::string &
+Project::getRootDir() const
+{
+    return rootDir;
+}
+
 const std::string &
 Project::getDataDir() const
 {
@@ -133,4 +140,5 @@ Project::save()
     // Since storage uses config, order here matters.
     storage.save();
     configs.second->save();
+    storage.finishJournal({});
 }
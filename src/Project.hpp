@@ -65,8 +65,12 @@ public:
     /**
      * @brief Creates an instance of particular project.
      *
+     * Finishes saves that were interrupted by replaying the journal.
+     *
      * @param rootDir Root directory of the project.
      * @param makeConfig Function that opens configuration by path.
+     *
+     * @throws std::runtime_error On broken journal or failure to replay it.
      */
     Project(std::string rootDir, mkConfig makeConfig);
     /**
@@ -110,6 +114,12 @@ public:
      * @returns The configuration, which state is never saved.
      */
     Config & getConfig(bool proxy = true);
+    /**
+     * @brief Retrieves path to root directory of the project.
+     *
+     * @returns The path.
+     */
+    const std::string & getRootDir() const;
     /**
      * @brief Retrieves path to directory where items are stored.
      *
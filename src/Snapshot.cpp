@@ -0,0 +1,131 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Snapshot.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <boost/filesystem.hpp>
+
+#include "file_format.hpp"
+
+namespace fs = boost::filesystem;
+
+Snapshot::Snapshot(std::string path) : path(std::move(path))
+{
+}
+
+const Snapshot::values_t *
+Snapshot::get(const std::string &id, const std::string &stamp)
+{
+    ensureLoaded();
+
+    const auto it = stamps.find(id);
+    if (stamp.empty() || it == stamps.end() || it->second != stamp) {
+        return nullptr;
+    }
+    return &entries[id];
+}
+
+void
+Snapshot::update(const std::string &id, std::string stamp, values_t values)
+{
+    if (isLoaded()) {
+        entries[id] = values;
+        stamps[id] = stamp;
+    }
+    pending[id] = { std::move(stamp), std::move(values) };
+    markModified();
+}
+
+void
+Snapshot::load()
+{
+    std::ifstream file(path);
+    if (file) {
+        nRecords = readValues(file, entries, stamps);
+    }
+
+    for (const auto &e : pending) {
+        stamps[e.first] = e.second.first;
+        entries[e.first] = e.second.second;
+    }
+}
+
+void
+Snapshot::save()
+{
+    if (pending.empty()) {
+        return;
+    }
+
+    // Outdated records are dropped when they start to dominate.
+    if (!canAppend() ||
+        (isLoaded() && nRecords + pending.size() > 2U*stamps.size() + 64U)) {
+        ensureLoaded();
+        rewrite();
+        pending.clear();
+        return;
+    }
+
+    std::ofstream file(path, std::ios::out | std::ios::app);
+    for (const auto &e : pending) {
+        writeValues(file, e.first, e.second.first, e.second.second);
+    }
+    if (!file.flush()) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+
+    nRecords += pending.size();
+    pending.clear();
+}
+
+bool
+Snapshot::canAppend() const
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file || !file.seekg(0, std::ios::end) || file.tellg() == 0) {
+        return true;
+    }
+
+    // Each complete record is terminated by an empty line.
+    char tail[2];
+    return file.seekg(-2, std::ios::end)
+        && file.read(tail, sizeof(tail))
+        && tail[0] == '\n' && tail[1] == '\n';
+}
+
+void
+Snapshot::rewrite()
+{
+    const std::string tmpPath = path + ".tmp";
+
+    std::ofstream file(tmpPath);
+    // Records without stamps are never used and are dropped.
+    for (const auto &e : stamps) {
+        writeValues(file, e.first, e.second, entries[e.first]);
+    }
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write " + tmpPath);
+    }
+
+    fs::rename(tmpPath, path);
+    nRecords = stamps.size();
+}
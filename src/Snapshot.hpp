@@ -0,0 +1,126 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DIT__SNAPSHOT_HPP__
+#define DIT__SNAPSHOT_HPP__
+
+#include <cstddef>
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "StorageBacked.hpp"
+
+/**
+ * @brief Persistent copy of current values of items.
+ *
+ * Allows answering questions about current state of items without reading and
+ * replaying their change sets.  Each record carries a stamp of stored data of
+ * the item it was made for (provided by storage backend), records with stamps
+ * that don't match current ones aren't used.  The file is append-only and is
+ * compacted once it accumulates too many outdated records.
+ */
+class Snapshot : private StorageBacked<Snapshot>
+{
+    friend class StorageBacked<Snapshot>;
+
+public:
+    /**
+     * @brief Type of values of a single item (key -> value).
+     */
+    using values_t = std::map<std::string, std::string>;
+
+public:
+    /**
+     * @brief Creates snapshot backed by the specified file.
+     *
+     * @param path Path to the file.
+     */
+    explicit Snapshot(std::string path);
+
+public:
+    /**
+     * @brief Retrieves recorded values of an item.
+     *
+     * @param id Id of the item.
+     * @param stamp Current stamp of stored data of the item.
+     *
+     * @returns The values or @c nullptr if item isn't in the snapshot or its
+     *          record is outdated.
+     *
+     * @throws std::runtime_error On broken file.
+     */
+    const values_t * get(const std::string &id, const std::string &stamp);
+    /**
+     * @brief Records new values of an item.
+     *
+     * @param id Id of the item.
+     * @param stamp Stamp of stored data of the item.
+     * @param values New values.
+     */
+    void update(const std::string &id, std::string stamp, values_t values);
+    /**
+     * @brief Writes updated records out.
+     *
+     * @throws std::runtime_error On write failure.
+     */
+    virtual void save() override;
+
+private:
+    /**
+     * @brief Actually reads the file.
+     *
+     * @throws std::runtime_error On broken file.
+     */
+    void load();
+    /**
+     * @brief Checks whether records can be appended to the file.
+     *
+     * @returns @c true if so, @c false if file ends with a torn record.
+     */
+    bool canAppend() const;
+    /**
+     * @brief Replaces the file with current set of records.
+     *
+     * @throws std::runtime_error On write failure.
+     */
+    void rewrite();
+
+private:
+    /**
+     * @brief Path to the file.
+     */
+    const std::string path;
+    /**
+     * @brief Values of items (id -> values).
+     */
+    std::map<std::string, values_t> entries;
+    /**
+     * @brief Stamps of stored data of items (id -> stamp).
+     */
+    std::map<std::string, std::string> stamps;
+    /**
+     * @brief Records that aren't written out yet (id -> stamp and values).
+     */
+    std::map<std::string, std::pair<std::string, values_t>> pending;
+    /**
+     * @brief Number of records in the file including outdated ones.
+     */
+    std::size_t nRecords = 0U;
+};
+
+#endif // DIT__SNAPSHOT_HPP__
@@ -17,26 +17,50 @@
 #include "Storage.hpp"
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
 
-#include <fstream>
+#include <algorithm>
 #include <functional>
-#include <iostream>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
-#include <boost/range/iterator_range.hpp>
-#include <boost/filesystem.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
 
+#include "utils/fs.hpp"
+#include "utils/memory.hpp"
+#include "utils/parallel.hpp"
 #include "Change.hpp"
+#include "ChangeFormat.hpp"
+#include "CompletionCache.hpp"
+#include "Config.hpp"
 #include "Item.hpp"
+#include "Journal.hpp"
 #include "Project.hpp"
-#include "file_format.hpp"
+#include "Snapshot.hpp"
+#include "StorageBackend.hpp"
+#include "TrigramIndex.hpp"
+#include "ValueIndex.hpp"
 
 namespace fs = boost::filesystem;
 
+static std::map<std::string, std::string> getCurrentValues(
+    const std::vector<Change> &changes);
+static std::map<std::string, std::string> getCurrentValues(Item &item);
+static std::string getJournalPath(Project &project);
+static void syncProject(Project &project);
+static std::uintmax_t getSize(Project &project, const std::string &key,
+                              const std::string &def);
+
 void
 Storage::init(Project &project)
 {
@@ -55,6 +79,10 @@ Storage::Storage(Project &project, pk<Project>)
 {
 }
 
+Storage::~Storage()
+{
+}
+
 Item &
 Storage::create()
 {
@@ -73,6 +101,25 @@ Storage::create()
     return it->second;
 }
 
+std::vector<std::reference_wrapper<Item>>
+Storage::create(int count)
+{
+    ensureLoaded();
+
+    std::vector<std::reference_wrapper<Item>> created;
+    created.reserve(count);
+    for (const std::string &id : idGenerator.takeIds(count)) {
+        decltype(items)::iterator it;
+        bool inserted;
+        std::tie(it, inserted) = items.emplace(id, Item(*this, id, false, {}));
+        assert(inserted && "Duplicated item id");
+        (void)inserted;
+
+        created.emplace_back(it->second);
+    }
+    return created;
+}
+
 void
 Storage::put(Item item, pk<Tests>)
 {
@@ -99,6 +146,7 @@ std::vector<std::reference_wrapper<Item>>
 Storage::list()
 {
     ensureLoaded();
+    useSnapshot = true;
 
     std::vector<std::reference_wrapper<Item>> list;
     list.reserve(items.size());
@@ -108,32 +156,191 @@ Storage::list()
     return list;
 }
 
+std::vector<std::reference_wrapper<Item>>
+Storage::loadAll(bool history)
+{
+    std::vector<std::reference_wrapper<Item>> items = list();
+
+    // Unless history is needed, bulk read is necessary only if snapshot isn't
+    // complete.
+    std::vector<Item *> toRead;
+    for (Item &item : items) {
+        if (!item.wasLoaded({}) &&
+            (history || getSnapshotted(item.getId()) == nullptr)) {
+            toRead.push_back(&item);
+        }
+    }
+    if (toRead.empty()) {
+        return items;
+    }
+
+    StorageBackend &backend = getBackend();
+    backend.prefetch();
+
+    // Each thread writes only to its own element of the vector.
+    std::vector<std::vector<Change>> changes(toRead.size());
+    parallelFor(toRead.size(), [&](std::size_t i) {
+        backend.read(toRead[i]->getId(), changes[i]);
+    });
+
+    // Items are filled sequentially from results of parsing.
+    for (std::size_t i = 0U; i < toRead.size(); ++i) {
+        parsed.emplace(toRead[i]->getId(), std::move(changes[i]));
+        toRead[i]->getChanges();
+    }
+    parsed.clear();
+
+    return items;
+}
+
 void
-Storage::load()
+Storage::forEach(const std::function<bool(Item &item)> &visit)
 {
-    const std::string &dataDir = project.getDataDir();
+    useSnapshot = true;
 
-    // Suppress throwing exceptions if project doesn't have any items.
-    if (project.exists() && !fs::is_directory(dataDir)) {
+    if (isLoaded()) {
+        for (auto &e : items) {
+            if (!visit(e.second)) {
+                break;
+            }
+        }
         return;
     }
 
-    using dir_it = fs::directory_iterator;
-    for (fs::directory_entry &e :
-         boost::make_iterator_range(dir_it(dataDir), dir_it())) {
-        loadDir(e.path());
-    }
+    getBackend().forEachId([this, &visit](const std::string &id) {
+        Item item(*this, id, true, {});
+        const std::size_t nUnsnapshotted = unsnapshotted.size();
+
+        bool more;
+        try {
+            more = visit(item);
+        } catch (...) {
+            unsnapshotted.resize(nUnsnapshotted);
+            throw;
+        }
+
+        // Item is gone after the visit, so record its values right away.
+        if (unsnapshotted.size() != nUnsnapshotted) {
+            unsnapshotted.resize(nUnsnapshotted);
+            snapshotItem(getBackend(), id,
+                         getCurrentValues(item.getChanges({})));
+        }
+        return more;
+    });
 }
 
 void
-Storage::loadDir(const fs::path &path)
+Storage::adopt(Storage &other, const std::vector<std::string> &paths)
+{
+    std::set<std::string> changed;
+    if (!other.backend || other.getBackendName() != getBackendName() ||
+        !other.backend->listChanged(paths, changed)) {
+        return;
+    }
+
+    ensureLoaded();
+
+    std::vector<Item *> toFill;
+    for (auto &e : other.items) {
+        Item &item = e.second;
+        if (!item.wasLoaded({}) || item.wasChanged() ||
+            changed.find(e.first) != changed.end()) {
+            continue;
+        }
+
+        const auto it = items.find(e.first);
+        if (it != items.end() && !it->second.wasLoaded({})) {
+            parsed.emplace(e.first, item.getChanges({}));
+            toFill.push_back(&it->second);
+        }
+    }
+
+    for (Item *item : toFill) {
+        item->getChanges();
+    }
+    parsed.clear();
+}
+
+bool
+Storage::find(const std::vector<std::pair<std::string, std::string>> &values,
+              const std::vector<std::string> &needles,
+              std::vector<std::reference_wrapper<Item>> &found)
 {
-    using dir_it = fs::directory_iterator;
-    fs::path prefix = path.filename();
-    for (fs::directory_entry &e :
-         boost::make_iterator_range(dir_it(path), dir_it())) {
-        const std::string id = prefix.string() + e.path().filename().string();
+    const bool useValues = !values.empty()
+                        && isIndexEnabled("index.values")
+                        && getValueIndex().exists();
+
+    std::vector<std::string> usableNeedles;
+    if (isIndexEnabled("index.trigrams") && getTrigramIndex().exists()) {
+        std::copy_if(needles.cbegin(), needles.cend(),
+                     std::back_inserter(usableNeedles),
+                     &TrigramIndex::canFind);
+    }
+
+    if (!useValues && usableNeedles.empty()) {
+        return false;
+    }
+
+    ensureLoaded();
+
+    std::vector<std::string> ids;
+    bool first = true;
+    auto intersect = [&ids, &first](std::vector<std::string> matched) {
+        if (first) {
+            ids = std::move(matched);
+            first = false;
+            return;
+        }
+
+        std::vector<std::string> intersection;
+        std::set_intersection(ids.cbegin(), ids.cend(),
+                              matched.cbegin(), matched.cend(),
+                              std::back_inserter(intersection));
+        ids = std::move(intersection);
+    };
 
+    if (useValues) {
+        for (const auto &value : values) {
+            intersect(getValueIndex().find(value.first, value.second));
+        }
+    }
+    for (const std::string &needle : usableNeedles) {
+        intersect(getTrigramIndex().find(needle));
+    }
+
+    // Indexes reflect only saved state of items.
+    std::vector<std::string> unsaved;
+    for (auto &e : items) {
+        if (isUnsaved(e.second)) {
+            unsaved.push_back(e.first);
+        }
+    }
+    std::vector<std::string> candidates;
+    std::set_union(ids.cbegin(), ids.cend(),
+                   unsaved.cbegin(), unsaved.cend(),
+                   std::back_inserter(candidates));
+
+    found.clear();
+    for (const std::string &id : candidates) {
+        const auto it = items.find(id);
+        if (it != items.end()) {
+            found.emplace_back(it->second);
+        }
+    }
+
+    // Reading everything at once is cheaper than reading many items one by
+    // one.
+    if (found.size() > items.size()/8U) {
+        loadAll();
+    }
+
+    return true;
+}
+
+void
+Storage::load()
+{
+    for (const std::string &id : getBackend().listIds()) {
         bool inserted = items.emplace(id, Item(*this, id, true, {})).second;
         assert(inserted && "Duplicated item id");
         (void)inserted;
@@ -143,44 +350,613 @@ Storage::loadDir(const fs::path &path)
 void
 Storage::fill(Item &item, pk<Item>)
 {
-    const std::string &id = item.getId();
-    const fs::path path =
-        fs::path(project.getDataDir())/id.substr(0, 1)/id.substr(1);
+    const auto it = parsed.find(item.getId());
+    if (it != parsed.end()) {
+        item.getChanges({}) = std::move(it->second);
+    } else {
+        getBackend().read(item.getId(), item.getChanges({}));
+    }
+
+    if (useSnapshot && getSnapshotted(item.getId()) == nullptr) {
+        unsnapshotted.push_back(&item);
+    }
+}
+
+const std::map<std::string, std::string> *
+Storage::getSnapshot(const std::string &id, pk<Item>)
+{
+    return useSnapshot ? getSnapshotted(id) : nullptr;
+}
 
-    std::ifstream file(path.string());
-    if (!file) {
-        throw std::runtime_error("Failed to read change set of " + id);
+CompletionCache *
+Storage::getCompletionCache()
+{
+    for (auto &e : items) {
+        if (isUnsaved(e.second)) {
+            return nullptr;
+        }
     }
 
-    file >> item.getChanges({});
+    CompletionCache &cache = getCompletions();
+    return cache.exists() ? &cache : nullptr;
 }
 
 void
 Storage::save()
 {
-    for (const auto &e : items) {
-        if (!e.second.wasChanged()) {
+    Journal journal(getJournalPath(project));
+
+    std::vector<Item *> toStore;
+    for (auto &e : items) {
+        Item &item = e.second;
+        if (!item.wasChanged()) {
             continue;
         }
 
-        const std::string &id = e.second.getId();
+        const std::vector<Change> &changes = item.getChanges({});
+        if (item.needsRewrite({})) {
+            journal.addItem(e.first, changes, 0U);
+            toStore.push_back(&item);
+        } else if (item.getStoredCount({}) < changes.size()) {
+            journal.addItem(e.first, changes, item.getStoredCount({}));
+            toStore.push_back(&item);
+        }
+    }
 
-        const fs::path dirPath =
-            fs::path(project.getDataDir())/id.substr(0, 1);
+    const std::vector<std::pair<std::string, std::string>> idsState =
+        idGenerator.getChangedState();
+    for (const auto &setting : idsState) {
+        journal.addSetting(setting.first, setting.second);
+    }
 
-        if (!fs::exists(dirPath)) {
-            fs::create_directories(dirPath);
+    journal.commit();
+    journaled = !toStore.empty() || !idsState.empty();
+
+    std::vector<Item *> stored;
+    std::vector<std::map<std::string, std::string>> former;
+    bool formerKnown = true;
+    for (Item *item : toStore) {
+        former.emplace_back();
+        formerKnown &= getStoredValues(*item, former.back());
+
+        const std::vector<Change> &changes = item->getChanges({});
+        if (item->needsRewrite({})) {
+            getBackend().write(item->getId(), changes, false);
+        } else {
+            getBackend().append(item->getId(), changes,
+                                item->getStoredCount({}));
         }
 
-        const fs::path filePath = dirPath/id.substr(1);
-        std::ofstream file(filePath.string());
-        if (!file) {
-            throw std::runtime_error("Failed to write change set of " +
-                                     e.second.getId());
+        item->markStored({});
+        stored.push_back(item);
+    }
+
+    const bool written = !stored.empty();
+    if (written) {
+        getBackend().commit();
+    }
+
+    for (const Item *item : stored) {
+        snapshotItem(getBackend(), item->getId(),
+                     getCurrentValues(item->getChanges({})));
+    }
+
+    updateIndexes(stored);
+    updateCompletions(stored, former, formerKnown);
+
+    for (const Item *item : unsnapshotted) {
+        snapshotItem(getBackend(), item->getId(),
+                     getCurrentValues(item->getChanges({})));
+    }
+    unsnapshotted.clear();
+
+    if (snapshot) {
+        try {
+            snapshot->save();
+        } catch (const std::runtime_error &) {
+            // Failing to cache values of unchanged items is harmless.
+            if (written) {
+                throw;
+            }
         }
-        /* TODO: write only new changes (append them). */
-        file << e.second.getChanges({});
     }
 
     idGenerator.save();
 }
+
+void
+Storage::finishJournal(pk<Project>)
+{
+    // Replaying takes longer as journal grows, so it's dropped once in a while.
+    const std::uintmax_t maxJournalSize = 1024U*1024U;
+
+    if (journaled) {
+        Journal journal(getJournalPath(project));
+        if (journal.getSize() > maxJournalSize || !journal.markApplied()) {
+            checkpoint();
+        }
+        journaled = false;
+    }
+}
+
+void
+Storage::recover(pk<Project>)
+{
+    Journal journal(getJournalPath(project));
+    if (!journal.exists() || journal.isApplied()) {
+        return;
+    }
+
+    StorageBackend &backend = getBackend();
+    Config &config = project.getConfig(false);
+    std::map<std::string, std::map<std::string, std::string>> replayed;
+    journal.replay(
+        [&](const std::string &id, std::size_t from,
+            std::vector<Change> changes) {
+            if (from != 0U) {
+                // Drop whatever part of the tail made it to the storage.
+                std::vector<Change> stored;
+                backend.read(id, stored);
+                if (stored.size() < from) {
+                    throw std::runtime_error("Journal doesn't match item " +
+                                             id);
+                }
+                stored.erase(stored.begin() + from, stored.end());
+                stored.insert(stored.end(),
+                              std::make_move_iterator(changes.begin()),
+                              std::make_move_iterator(changes.end()));
+                changes = std::move(stored);
+            }
+
+            backend.write(id, changes, false);
+            replayed[id] = getCurrentValues(changes);
+        },
+        [&](const std::string &key, const std::string &value) {
+            config.set(key, value);
+        });
+    backend.commit();
+
+    for (auto &e : replayed) {
+        snapshotItem(backend, e.first, std::move(e.second));
+    }
+
+    // Indexes could have missed some of the changes, they will be rebuilt on
+    // the next save.
+    if (getValueIndex().exists()) {
+        getValueIndex().clear();
+    }
+    if (getTrigramIndex().exists()) {
+        getTrigramIndex().clear();
+    }
+    if (getCompletions().exists()) {
+        getCompletions().clear();
+    }
+
+    getSnapshot().save();
+    config.save();
+    checkpoint();
+}
+
+void
+Storage::checkpoint()
+{
+    syncFileSystem(project.getRootDir());
+
+    Journal journal(getJournalPath(project));
+    if (journal.exists()) {
+        journal.discard();
+    }
+}
+
+void
+Storage::updateIndexes(const std::vector<Item *> &stored)
+{
+    ValueIndex &values = getValueIndex();
+    TrigramIndex &trigrams = getTrigramIndex();
+
+    const bool withValues = isIndexEnabled("index.values");
+    const bool withTrigrams = isIndexEnabled("index.trigrams");
+
+    // Index that isn't updated must not be used later.
+    if (!withValues && values.exists()) {
+        values.clear();
+    }
+    if (!withTrigrams && trigrams.exists()) {
+        trigrams.clear();
+    }
+
+    const bool buildValues = withValues && !values.exists();
+    const bool buildTrigrams = withTrigrams && !trigrams.exists();
+
+    if (buildValues || buildTrigrams) {
+        for (Item &item : loadAll()) {
+            const std::map<std::string, std::string> current =
+                getCurrentValues(item);
+            if (buildValues) {
+                values.add(item.getId(), current);
+            }
+            if (buildTrigrams) {
+                trigrams.add(item.getId(), current);
+            }
+        }
+    }
+
+    for (Item *item : stored) {
+        const std::vector<Change> &changes = item->getChanges({});
+        const std::map<std::string, std::string> current =
+            getCurrentValues(changes);
+
+        if (withValues && !buildValues) {
+            std::set<std::string> keys;
+            for (const Change &change : changes) {
+                keys.insert(change.getKey());
+            }
+
+            values.remove(item->getId(), keys);
+            values.add(item->getId(), current);
+        }
+
+        if (withTrigrams && !buildTrigrams) {
+            trigrams.remove(item->getId());
+            trigrams.add(item->getId(), current);
+        }
+    }
+
+    if (withValues) {
+        values.save();
+    }
+    if (withTrigrams) {
+        trigrams.save();
+    }
+}
+
+void
+Storage::updateCompletions(
+    const std::vector<Item *> &stored,
+    const std::vector<std::map<std::string, std::string>> &former,
+    bool formerKnown)
+{
+    // Cache is built along with the first write to not write anything on
+    // read-only invocations.
+    if (stored.empty()) {
+        return;
+    }
+
+    CompletionCache &cache = getCompletions();
+    if (!cache.exists() || !formerKnown) {
+        cache.clear();
+        for (Item &item : loadAll()) {
+            cache.add(item.getId(), getCurrentValues(item));
+        }
+    } else {
+        for (std::size_t i = 0U; i < stored.size(); ++i) {
+            cache.remove(former[i]);
+            cache.add(stored[i]->getId(),
+                      getCurrentValues(stored[i]->getChanges({})));
+        }
+    }
+    cache.save();
+}
+
+/**
+ * @brief Computes current values from a change set.
+ *
+ * @param changes Changes to replay.
+ *
+ * @returns Values (key -> value).
+ */
+static std::map<std::string, std::string>
+getCurrentValues(const std::vector<Change> &changes)
+{
+    std::map<std::string, std::string> values;
+    for (const Change &c : changes) {
+        if (c.getValue().empty()) {
+            values.erase(c.getKey());
+        } else {
+            values[c.getKey()] = c.getValue();
+        }
+    }
+    return values;
+}
+
+/**
+ * @brief Retrieves current values of an item.
+ *
+ * @param item The item.
+ *
+ * @returns Values (key -> value).
+ */
+static std::map<std::string, std::string>
+getCurrentValues(Item &item)
+{
+    std::map<std::string, std::string> values;
+    for (const std::string &key : item.listRecordNames()) {
+        values.emplace(key, item.getValue(key));
+    }
+    return values;
+}
+
+/**
+ * @brief Retrieves path to journal of a project.
+ *
+ * @param project The project.
+ *
+ * @returns The path.
+ */
+static std::string
+getJournalPath(Project &project)
+{
+    return (fs::path(project.getRootDir())/"journal").string();
+}
+
+/**
+ * @brief Makes configuration of a project and its directory durable.
+ *
+ * @param project The project.
+ *
+ * @throws std::runtime_error On failure.
+ */
+static void
+syncProject(Project &project)
+{
+    const fs::path root = project.getRootDir();
+    if (fs::exists(root/"config")) {
+        syncPath((root/"config").string());
+    }
+    syncPath(root.string());
+}
+
+/**
+ * @brief Retrieves non-negative integer value of a setting.
+ *
+ * @param project Project whose configuration is queried.
+ * @param key Name of the setting.
+ * @param def Default value.
+ *
+ * @returns The value.
+ *
+ * @throws std::runtime_error If the value isn't a number.
+ */
+static std::uintmax_t
+getSize(Project &project, const std::string &key, const std::string &def)
+{
+    const std::string value = project.getConfig().get(key, def);
+    if (value.empty() ||
+        value.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::runtime_error("Invalid value of " + key + ": " + value);
+    }
+    try {
+        return std::stoull(value);
+    } catch (const std::out_of_range &) {
+        throw std::runtime_error("Invalid value of " + key + ": " + value);
+    }
+}
+
+std::string
+Storage::getBackendName()
+{
+    return project.getConfig(false).get("!storage.backend", "dir");
+}
+
+void
+Storage::convert(const std::string &name)
+{
+    std::unique_ptr<StorageBackend> target =
+        StorageBackend::create(name, project, getFormat());
+
+    // Drop whatever an interrupted conversion might have left behind.
+    target->clear();
+    writeAll(*target, loadAll(true), false);
+
+    // Items are synced by writeAll(), old data may be removed only after the
+    // switch is persisted.
+    Config &config = project.getConfig(false);
+    config.set("!storage.backend", name);
+    config.save();
+    syncProject(project);
+
+    getBackend().clear();
+    backend = std::move(target);
+}
+
+std::string
+Storage::getFormatName()
+{
+    return project.getConfig(false).get("!storage.format", "text");
+}
+
+void
+Storage::convertFormat(const std::string &name)
+{
+    std::vector<std::reference_wrapper<Item>> all = loadAll(true);
+
+    getFormat().setName(name);
+
+    writeAll(getBackend(), all, false);
+
+    // Items are synced by writeAll(), so the switch can be persisted.
+    Config &config = project.getConfig(false);
+    config.set("!storage.format", name);
+    config.save();
+    syncProject(project);
+}
+
+int
+Storage::compact()
+{
+    return writeAll(getBackend(), loadAll(true), true);
+}
+
+int
+Storage::writeAll(StorageBackend &backend,
+                  const std::vector<std::reference_wrapper<Item>> &all,
+                  bool compact)
+{
+    std::uintmax_t maxAge = 0U;
+    std::uintmax_t maxSize = 0U;
+    if (compact) {
+        maxAge = getSize(project, "storage.compress.age", "90");
+        maxSize = getSize(project, "storage.compress.size", "65536");
+    }
+    const std::time_t now = std::time(nullptr);
+
+    auto isCold = [&](const std::vector<Change> &changes) {
+        std::uintmax_t size = 0U;
+        for (const Change &change : changes) {
+            size += change.getKey().size() + change.getValue().size();
+        }
+
+        const std::time_t last = changes.empty()
+                               ? now
+                               : changes.back().getTimestamp();
+        return (maxAge != 0U && now - last > 0 &&
+                std::uintmax_t(now - last)/(24*60*60) >= maxAge)
+            || (maxSize != 0U && size >= maxSize);
+    };
+
+    int nCompressed = 0;
+    for (Item &item : all) {
+        const std::vector<Change> &changes = item.getChanges();
+
+        // Conversions keep compression of items as is.
+        const bool cold = compact ? isCold(changes)
+                                  : getBackend().isCompressed(item.getId());
+
+        backend.write(item.getId(), changes, cold);
+        item.markStored({});
+        nCompressed += cold;
+    }
+    backend.commit();
+    // All previously stored data got superseded.
+    backend.repack();
+    checkpoint();
+
+    for (Item &item : all) {
+        snapshotItem(backend, item.getId(),
+                     getCurrentValues(item.getChanges({})));
+    }
+
+    return nCompressed;
+}
+
+StorageBackend &
+Storage::getBackend()
+{
+    if (!backend) {
+        backend = StorageBackend::create(getBackendName(), project,
+                                         getFormat());
+    }
+    return *backend;
+}
+
+ChangeFormat &
+Storage::getFormat()
+{
+    if (!format) {
+        const fs::path root = project.getRootDir();
+        format = make_unique<ChangeFormat>(getFormatName(),
+                                           (root/"keys").string());
+    }
+    return *format;
+}
+
+Snapshot &
+Storage::getSnapshot()
+{
+    if (!snapshot) {
+        const fs::path root = project.getRootDir();
+        snapshot = make_unique<Snapshot>((root/"snapshot").string());
+    }
+    return *snapshot;
+}
+
+ValueIndex &
+Storage::getValueIndex()
+{
+    if (!valueIndex) {
+        const fs::path root = project.getRootDir();
+        valueIndex = make_unique<ValueIndex>((root/"index").string());
+    }
+    return *valueIndex;
+}
+
+TrigramIndex &
+Storage::getTrigramIndex()
+{
+    if (!trigramIndex) {
+        const fs::path root = project.getRootDir();
+        trigramIndex = make_unique<TrigramIndex>((root/"trigrams").string());
+    }
+    return *trigramIndex;
+}
+
+CompletionCache &
+Storage::getCompletions()
+{
+    if (!completions) {
+        const fs::path root = project.getRootDir();
+        completions =
+            make_unique<CompletionCache>((root/"completion").string());
+    }
+    return *completions;
+}
+
+const std::string &
+Storage::getStamp(const std::string &id)
+{
+    auto it = stamps.find(id);
+    if (it == stamps.end()) {
+        it = stamps.emplace(id, getBackend().getStamp(id)).first;
+    }
+    return it->second;
+}
+
+const std::map<std::string, std::string> *
+Storage::getSnapshotted(const std::string &id)
+{
+    return getSnapshot().get(id, getStamp(id));
+}
+
+void
+Storage::snapshotItem(StorageBackend &backend, const std::string &id,
+                      std::map<std::string, std::string> values)
+{
+    std::string &stamp = stamps[id];
+    stamp = backend.getStamp(id);
+    getSnapshot().update(id, stamp, std::move(values));
+}
+
+bool
+Storage::isUnsaved(Item &item)
+{
+    return item.wasChanged()
+        && (item.needsRewrite({}) ||
+            item.getStoredCount({}) < item.getChanges({}).size());
+}
+
+bool
+Storage::getStoredValues(Item &item, std::map<std::string, std::string> &values)
+{
+    const std::vector<Change> &changes = item.getChanges({});
+    const std::size_t nStored = item.getStoredCount({});
+
+    if (!item.needsRewrite({}) || nStored == 0U) {
+        values = getCurrentValues({ changes.cbegin(),
+                                    changes.cbegin() + nStored });
+        return true;
+    }
+
+    // Stored changes were updated in place, so only snapshot knows the values.
+    if (const std::map<std::string, std::string> *snapshotted =
+            getSnapshotted(item.getId())) {
+        values = *snapshotted;
+        return true;
+    }
+    return false;
+}
+
+bool
+Storage::isIndexEnabled(const std::string &setting)
+{
+    return project.getConfig().get(setting, "no") == "yes";
+}
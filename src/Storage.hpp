@@ -19,20 +19,25 @@
 
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "utils/Passkey.hpp"
 #include "IdGenerator.hpp"
 #include "StorageBacked.hpp"
 
-namespace boost { namespace filesystem {
-    class path;
-} }
-
+class Change;
+class ChangeFormat;
+class CompletionCache;
 class Item;
 class Project;
+class Snapshot;
+class StorageBackend;
 class Tests;
+class TrigramIndex;
+class ValueIndex;
 
 /**
  * @brief Storage for a set of items.
@@ -62,6 +67,10 @@ public:
      * @param project Project, which is parent of the storage.
      */
     Storage(Project &project, pk<Project>);
+    /**
+     * @brief Emit destructor code in corresponding source file.
+     */
+    ~Storage();
 
 public:
     /**
@@ -70,6 +79,14 @@ public:
      * @returns Reference to newly created item.
      */
     Item & create();
+    /**
+     * @brief Creates several new items at once.
+     *
+     * @param count Number of items to create.
+     *
+     * @returns References to newly created items.
+     */
+    std::vector<std::reference_wrapper<Item>> create(int count);
     /**
      * @brief Inserts the item into the storage.
      *
@@ -94,6 +111,69 @@ public:
      * @throws boost::filesystem::filesystem_error On broken storage.
      */
     std::vector<std::reference_wrapper<Item>> list();
+    /**
+     * @brief Lists all available items reading their data in bulk.
+     *
+     * Should be preferred over list() when contents of all items is needed.
+     * Items that aren't in the snapshot are parsed in parallel.
+     *
+     * @param history Whether change sets of items are going to be needed
+     *                even if the snapshot has their current values.
+     *
+     * @returns Snapshot of current list of items.
+     *
+     * @throws boost::filesystem::filesystem_error On broken storage.
+     * @throws std::runtime_error On missing item data.
+     */
+    std::vector<std::reference_wrapper<Item>> loadAll(bool history = false);
+    /**
+     * @brief Visits items one at a time without listing all of them first.
+     *
+     * Should be preferred when results are produced as items are visited.
+     * Unless the storage is already loaded, items are read as they are visited
+     * and are dropped afterwards, so visitor must not change them.
+     *
+     * @param visit Visitor, which returns @c false to stop the iteration.
+     *
+     * @throws boost::filesystem::filesystem_error On broken storage.
+     * @throws std::runtime_error On missing item data.
+     */
+    void forEach(const std::function<bool(Item &item)> &visit);
+    /**
+     * @brief Takes over change sets read by another storage of the project.
+     *
+     * Lets reopened project skip reading items that weren't changed.  Nothing
+     * is taken if changed items can't be determined.
+     *
+     * @param other Storage of the same project that was opened earlier.
+     * @param paths Paths to files changed since @p other was loaded.
+     *
+     * @throws boost::filesystem::filesystem_error On broken storage.
+     * @throws std::runtime_error On broken data of backend.
+     */
+    void adopt(Storage &other, const std::vector<std::string> &paths);
+    /**
+     * @brief Lists items that might match the criteria using indexes.
+     *
+     * Items that have all the @p values are listed, if index of values is
+     * available.  Items that might contain each of the @p needles in some value
+     * (ignoring case) are listed, if index of trigrams is available.  Criteria
+     * that can't be checked by available indexes are ignored.
+     *
+     * Items with unsaved changes aren't covered by indexes and are always
+     * listed.  Contents of items is read in bulk if many items are found.
+     *
+     * @param values Pairs of keys and values to look for.
+     * @param needles Substrings to look for.
+     * @param[out] found The items.
+     *
+     * @returns @c false if no criteria can be checked by available indexes.
+     *
+     * @throws std::runtime_error On broken index.
+     */
+    bool find(const std::vector<std::pair<std::string, std::string>> &values,
+              const std::vector<std::string> &needles,
+              std::vector<std::reference_wrapper<Item>> &found);
     /**
      * @brief Fills empty item with actual content.
      *
@@ -102,13 +182,51 @@ public:
      * @throws std::runtime_error On missing item data.
      */
     void fill(Item &item, pk<Item>);
+    /**
+     * @brief Retrieves current values of an item without loading its changes.
+     *
+     * Values are available only after items were listed, because reading
+     * snapshot of all items doesn't pay off otherwise.
+     *
+     * @param id Id of the item.
+     *
+     * @returns The values (key -> value) or @c nullptr if they aren't known.
+     */
+    const std::map<std::string, std::string> * getSnapshot(
+        const std::string &id,
+        pk<Item>);
+    /**
+     * @brief Retrieves data for completion that doesn't require reading items.
+     *
+     * @returns The cache or @c nullptr if it wasn't built or there are unsaved
+     *          changes.
+     */
+    CompletionCache * getCompletionCache();
     /**
      * @brief Stores changed items.
      *
+     * Changes are recorded in the journal before item files are updated.
+     *
      * @throws boost::filesystem::filesystem_error On issues with storage.
      * @throws std::runtime_error On data write failure.
      */
     virtual void save() override;
+    /**
+     * @brief Marks journaled save as applied after configuration was saved as
+     *        well.
+     *
+     * Journal that grew too large is discarded after syncing the data.
+     *
+     * @throws std::runtime_error On failure to sync or remove the journal.
+     */
+    void finishJournal(pk<Project>);
+    /**
+     * @brief Finishes saves interrupted by a crash by replaying the journal.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     * @throws std::runtime_error On broken journal or write failure.
+     */
+    void recover(pk<Project>);
 
     /**
      * @brief Retrieves ID generation option employed by this storage.
@@ -117,21 +235,201 @@ public:
      */
     IdGenerator & getIdGenerator() { return idGenerator; }
 
+    /**
+     * @brief Retrieves name of backend that stores items.
+     *
+     * @returns The name.
+     */
+    std::string getBackendName();
+    /**
+     * @brief Moves all items to a different backend.
+     *
+     * Choice of the backend is saved to configuration right away and data of
+     * the previous backend is removed only after that.  Items that are
+     * stored compressed stay compressed, other items aren't compressed.
+     *
+     * @param name Name of the new backend.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     * @throws std::runtime_error On unknown backend or write failure.
+     */
+    void convert(const std::string &name);
+    /**
+     * @brief Retrieves name of form in which change sets are written.
+     *
+     * @returns The name.
+     */
+    std::string getFormatName();
+    /**
+     * @brief Rewrites all items in a different form.
+     *
+     * Choice of the format is saved to configuration right away after items
+     * are synced.  Compression of items is kept as is.
+     *
+     * @param name Name of the new format.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     * @throws std::runtime_error On unknown format or write failure.
+     */
+    void convertFormat(const std::string &name);
+    /**
+     * @brief Rewrites all items compressing cold ones.
+     *
+     * Item is cold if its last change is older than "storage.compress.age"
+     * days or size of its history reaches "storage.compress.size" bytes.
+     * Other items are stored uncompressed.
+     *
+     * @returns Number of items that are stored compressed.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     * @throws std::runtime_error On invalid setting or write failure.
+     */
+    int compact();
+
 private:
     /**
-     * @brief Actually loads storage from physical source, first level.
+     * @brief Actually loads storage from physical source.
      *
      * @throws boost::filesystem::filesystem_error On broken storage.
      */
     void load();
     /**
-     * @brief Loads items from a directory, second level.
+     * @brief Retrieves backend, creating it on first use.
+     *
+     * @returns The backend.
+     */
+    StorageBackend & getBackend();
+    /**
+     * @brief Retrieves form of change sets, creating it on first use.
      *
-     * @param path Parent directories of items.
+     * @returns The format.
+     */
+    ChangeFormat & getFormat();
+    /**
+     * @brief Retrieves snapshot of values, creating it on first use.
      *
-     * @throws boost::filesystem::filesystem_error On broken storage.
+     * @returns The snapshot.
+     */
+    Snapshot & getSnapshot();
+    /**
+     * @brief Retrieves index of values, creating it on first use.
+     *
+     * @returns The index.
+     */
+    ValueIndex & getValueIndex();
+    /**
+     * @brief Retrieves index of trigrams, creating it on first use.
+     *
+     * @returns The index.
+     */
+    TrigramIndex & getTrigramIndex();
+    /**
+     * @brief Retrieves cache of data for completion, creating it on first use.
+     *
+     * @returns The cache.
+     */
+    CompletionCache & getCompletions();
+    /**
+     * @brief Retrieves stamp of stored data of an item, caching it.
+     *
+     * @param id Id of the item.
+     *
+     * @returns The stamp.
+     */
+    const std::string & getStamp(const std::string &id);
+    /**
+     * @brief Retrieves values of an item from snapshot if they're up to date.
+     *
+     * @param id Id of the item.
+     *
+     * @returns The values (key -> value) or @c nullptr if snapshot doesn't
+     *          have them.
+     */
+    const std::map<std::string, std::string> * getSnapshotted(
+        const std::string &id);
+    /**
+     * @brief Records current values of a stored item in the snapshot.
+     *
+     * @param backend Backend that stores the item.
+     * @param id Id of the item.
+     * @param values Current values of the item (key -> value).
+     */
+    void snapshotItem(StorageBackend &backend, const std::string &id,
+                      std::map<std::string, std::string> values);
+    /**
+     * @brief Checks whether item has changes that weren't stored yet.
+     *
+     * @param item The item.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    bool isUnsaved(Item &item);
+    /**
+     * @brief Retrieves values of an item as of its last save.
+     *
+     * Must be called before the item is stored.
+     *
+     * @param item The item.
+     * @param values Storage for the values (key -> value).
+     *
+     * @returns @c false if the values aren't known, @c true otherwise.
+     */
+    bool getStoredValues(Item &item,
+                         std::map<std::string, std::string> &values);
+    /**
+     * @brief Checks whether an index should be maintained.
+     *
+     * @param setting Name of setting that enables the index.
+     *
+     * @returns @c true if so, @c false otherwise.
      */
-    void loadDir(const boost::filesystem::path &path);
+    bool isIndexEnabled(const std::string &setting);
+    /**
+     * @brief Writes all items into a backend.
+     *
+     * @param backend Destination.
+     * @param all All items of the storage.
+     * @param compact Whether to compress cold items instead of keeping
+     *                compression of items as is.
+     *
+     * @returns Number of compressed items.
+     *
+     * @throws std::runtime_error On invalid setting or write failure.
+     */
+    int writeAll(StorageBackend &backend,
+                 const std::vector<std::reference_wrapper<Item>> &all,
+                 bool compact);
+    /**
+     * @brief Makes everything written durable and discards the journal.
+     *
+     * @throws std::runtime_error On failure to sync or remove the journal.
+     */
+    void checkpoint();
+    /**
+     * @brief Brings indexes in sync with items.
+     *
+     * @param stored Items that were just stored.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     * @throws std::runtime_error On write failure.
+     */
+    void updateIndexes(const std::vector<Item *> &stored);
+    /**
+     * @brief Brings cache of data for completion in sync with items.
+     *
+     * Cache is (re)built if it's missing or former values aren't known.
+     *
+     * @param stored Items that were just stored.
+     * @param former Values of stored items as of their previous save.
+     * @param formerKnown Whether @p former is complete.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     * @throws std::runtime_error On write failure.
+     */
+    void updateCompletions(
+        const std::vector<Item *> &stored,
+        const std::vector<std::map<std::string, std::string>> &former,
+        bool formerKnown);
 
 private:
     /**
@@ -146,6 +444,50 @@ private:
      * @brief Implementation of ID generation algorithm.
      */
     IdGenerator idGenerator;
+    /**
+     * @brief Form of change sets.
+     */
+    std::unique_ptr<ChangeFormat> format;
+    /**
+     * @brief Physical storage of items.
+     */
+    std::unique_ptr<StorageBackend> backend;
+    /**
+     * @brief Current values of items.
+     */
+    std::unique_ptr<Snapshot> snapshot;
+    /**
+     * @brief Index of values of items.
+     */
+    std::unique_ptr<ValueIndex> valueIndex;
+    /**
+     * @brief Index of trigrams of values of items.
+     */
+    std::unique_ptr<TrigramIndex> trigramIndex;
+    /**
+     * @brief Ids, keys and values for completion.
+     */
+    std::unique_ptr<CompletionCache> completions;
+    /**
+     * @brief Stamps of stored data of items that were checked (id -> stamp).
+     */
+    std::map<std::string, std::string> stamps;
+    /**
+     * @brief Whether snapshot is used to get values of items.
+     */
+    bool useSnapshot = false;
+    /**
+     * @brief Whether last save recorded a transaction in the journal.
+     */
+    bool journaled = false;
+    /**
+     * @brief Loaded items that are missing from the snapshot.
+     */
+    std::vector<Item *> unsnapshotted;
+    /**
+     * @brief Changes read in bulk, which are consumed by fill().
+     */
+    std::map<std::string, std::vector<Change>> parsed;
 };
 
 #endif // DIT__STORAGE_HPP__
@@ -0,0 +1,99 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "StorageBackend.hpp"
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utils/memory.hpp"
+#include "DirBackend.hpp"
+#include "PackedBackend.hpp"
+
+std::vector<std::string>
+StorageBackend::list()
+{
+    return { "dir", "packed" };
+}
+
+std::unique_ptr<StorageBackend>
+StorageBackend::create(const std::string &name, Project &project,
+                       ChangeFormat &format)
+{
+    if (name == "dir") {
+        return make_unique<DirBackend>(project, format);
+    }
+    if (name == "packed") {
+        return make_unique<PackedBackend>(project, format);
+    }
+    throw std::runtime_error("Unknown storage backend: " + name);
+}
+
+StorageBackend::StorageBackend(ChangeFormat &format) : format(format)
+{
+}
+
+StorageBackend::~StorageBackend()
+{
+    // Put destructor and virtual table here.
+}
+
+void
+StorageBackend::forEachId(
+    const std::function<bool(const std::string &id)> &visit)
+{
+    for (const std::string &id : listIds()) {
+        if (!visit(id)) {
+            break;
+        }
+    }
+}
+
+void
+StorageBackend::prefetch()
+{
+    // Reading items one by one is fine by default.
+}
+
+void
+StorageBackend::commit()
+{
+    // Nothing to do if writes are persistent on their own.
+}
+
+void
+StorageBackend::repack()
+{
+    // Nothing to do if writes replace data in place.
+}
+
+bool
+StorageBackend::listChanged(const std::vector<std::string> &,
+                            std::set<std::string> &)
+{
+    // Can't tell which files hold which items.
+    return false;
+}
+
+ChangeFormat &
+StorageBackend::getFormat()
+{
+    return format;
+}
@@ -0,0 +1,203 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DIT__STORAGEBACKEND_HPP__
+#define DIT__STORAGEBACKEND_HPP__
+
+#include <cstddef>
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+class Change;
+class ChangeFormat;
+class Project;
+
+/**
+ * @brief Physical representation of items of a storage.
+ *
+ * Storage deals with items, while backend deals with files that keep their
+ * change sets.
+ */
+class StorageBackend
+{
+public:
+    /**
+     * @brief Lists names of all available backends.
+     *
+     * @returns The names.
+     */
+    static std::vector<std::string> list();
+    /**
+     * @brief Creates backend by its name.
+     *
+     * @param name Name of the backend.
+     * @param project Project whose data is managed by the backend.
+     * @param format Form of change sets.
+     *
+     * @returns The backend.
+     *
+     * @throws std::runtime_error On unknown backend name.
+     */
+    static std::unique_ptr<StorageBackend> create(const std::string &name,
+                                                  Project &project,
+                                                  ChangeFormat &format);
+
+protected:
+    /**
+     * @brief Initializes base part of a backend.
+     *
+     * @param format Form of change sets.
+     */
+    explicit StorageBackend(ChangeFormat &format);
+
+public:
+    /**
+     * @brief Properly destructs objects of derived classes.
+     */
+    virtual ~StorageBackend();
+
+public:
+    /**
+     * @brief Lists ids of all stored items.
+     *
+     * @returns The ids.
+     *
+     * @throws boost::filesystem::filesystem_error On broken storage.
+     */
+    virtual std::vector<std::string> listIds() = 0;
+    /**
+     * @brief Invokes visitor for ids of stored items one at a time.
+     *
+     * By default ids are listed by listIds() first.
+     *
+     * @param visit Visitor, which returns @c false to stop the iteration.
+     *
+     * @throws boost::filesystem::filesystem_error On broken storage.
+     */
+    virtual void forEachId(
+        const std::function<bool(const std::string &id)> &visit);
+    /**
+     * @brief Hints that contents of all items is going to be read.
+     *
+     * Backends can use this to read data in bulk.  After this call and until
+     * the next write read() can be called concurrently.
+     */
+    virtual void prefetch();
+    /**
+     * @brief Reads change set of an item.
+     *
+     * @param id Id of the item.
+     * @param changes Storage for read changes.
+     *
+     * @throws std::runtime_error On missing item data.
+     */
+    virtual void read(const std::string &id, std::vector<Change> &changes) = 0;
+    /**
+     * @brief Retrieves token that changes along with stored data of an item.
+     *
+     * @param id Id of the item.
+     *
+     * @returns The token (without spaces) or empty string if item isn't
+     *          stored.
+     */
+    virtual std::string getStamp(const std::string &id) = 0;
+    /**
+     * @brief Checks whether change set of an item is stored compressed.
+     *
+     * @param id Id of the item.
+     *
+     * @returns @c true if so, @c false otherwise (including absent items).
+     */
+    virtual bool isCompressed(const std::string &id) = 0;
+    /**
+     * @brief Writes change set of an item.
+     *
+     * @param id Id of the item.
+     * @param changes Changes to write.
+     * @param compress Whether to store the changes compressed.
+     *
+     * @throws std::runtime_error On data write failure.
+     */
+    virtual void write(const std::string &id,
+                       const std::vector<Change> &changes, bool compress) = 0;
+    /**
+     * @brief Adds tail of change set to already stored part of it.
+     *
+     * Compressed change set is rewritten uncompressed as a whole.
+     *
+     * @param id Id of the item.
+     * @param changes All changes of the item.
+     * @param from Index of the first change that isn't stored yet.
+     *
+     * @throws std::runtime_error On data write failure.
+     */
+    virtual void append(const std::string &id,
+                        const std::vector<Change> &changes,
+                        std::size_t from) = 0;
+    /**
+     * @brief Completes preceding writes.
+     *
+     * Durability is provided by the caller, but files of the backend must
+     * stay consistent with each other after a crash.
+     *
+     * @throws std::runtime_error On data write failure.
+     */
+    virtual void commit();
+    /**
+     * @brief Reclaims space taken by data that was superseded by later
+     *        writes.
+     *
+     * @throws std::runtime_error On read or write failure.
+     */
+    virtual void repack();
+    /**
+     * @brief Removes all data of the backend.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     */
+    virtual void clear() = 0;
+    /**
+     * @brief Finds items whose data was changed behind back of the backend.
+     *
+     * @param paths Paths to changed files.
+     * @param[out] ids Ids of changed items.
+     *
+     * @returns @c false if changed items can't be determined, @c true
+     *          otherwise.
+     */
+    virtual bool listChanged(const std::vector<std::string> &paths,
+                             std::set<std::string> &ids);
+
+protected:
+    /**
+     * @brief Retrieves form of change sets.
+     *
+     * @returns The format.
+     */
+    ChangeFormat & getFormat();
+
+private:
+    /**
+     * @brief Form of change sets.
+     */
+    ChangeFormat &format;
+};
+
+#endif // DIT__STORAGEBACKEND_HPP__
@@ -0,0 +1,242 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TrigramIndex.hpp"
+
+#include <cctype>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "file_format.hpp"
+
+namespace fs = boost::filesystem;
+
+static std::string fold(std::string str);
+
+bool
+TrigramIndex::canFind(const std::string &needle)
+{
+    return needle.size() >= 3U;
+}
+
+TrigramIndex::TrigramIndex(std::string path) : path(std::move(path))
+{
+}
+
+bool
+TrigramIndex::exists() const
+{
+    return fs::is_regular_file(path);
+}
+
+std::vector<std::string>
+TrigramIndex::find(const std::string &needle)
+{
+    const std::string folded = fold(needle);
+
+    std::set<std::string> needed;
+    for (std::string::size_type i = 0U; i + 3U <= folded.size(); ++i) {
+        needed.insert(folded.substr(i, 3U));
+    }
+
+    // Querying doesn't need the whole index in memory, only changes to it do.
+    if (!isLoaded()) {
+        std::ifstream file(path);
+        if (!file) {
+            return {};
+        }
+        return findTrigrams(file, { needed.cbegin(), needed.cend() });
+    }
+
+    std::vector<std::string> ids;
+    bool first = true;
+    for (const std::string &trigram : needed) {
+        const auto it = trigrams.find(trigram);
+        if (it == trigrams.end()) {
+            return {};
+        }
+
+        if (first) {
+            ids.assign(it->second.cbegin(), it->second.cend());
+            first = false;
+            continue;
+        }
+
+        std::vector<std::string> intersection;
+        std::set_intersection(ids.cbegin(), ids.cend(),
+                              it->second.cbegin(), it->second.cend(),
+                              std::back_inserter(intersection));
+        ids = std::move(intersection);
+    }
+    return ids;
+}
+
+void
+TrigramIndex::add(const std::string &id,
+                  const std::map<std::string, std::string> &values)
+{
+    ensureLoaded();
+
+    std::set<std::string> added;
+    for (const auto &e : values) {
+        const std::string folded = fold(e.second);
+        for (std::string::size_type i = 0U; i + 3U <= folded.size(); ++i) {
+            added.insert(folded.substr(i, 3U));
+        }
+    }
+
+    if (!added.empty()) {
+        for (const std::string &trigram : added) {
+            trigrams[trigram].insert(id);
+        }
+        items[id].insert(added.cbegin(), added.cend());
+    }
+
+    const auto it = items.find(id);
+    pending[id] = (it == items.end()) ? std::set<std::string>() : it->second;
+}
+
+void
+TrigramIndex::remove(const std::string &id)
+{
+    ensureLoaded();
+
+    pending[id].clear();
+
+    const auto it = items.find(id);
+    if (it == items.end()) {
+        return;
+    }
+
+    for (const std::string &trigram : it->second) {
+        const auto entry = trigrams.find(trigram);
+        entry->second.erase(id);
+        if (entry->second.empty()) {
+            trigrams.erase(entry);
+        }
+    }
+    items.erase(it);
+}
+
+void
+TrigramIndex::load()
+{
+    std::ifstream file(path);
+    if (file) {
+        nRecords = readTrigrams(file, items);
+    }
+
+    for (const auto &e : items) {
+        for (const std::string &trigram : e.second) {
+            trigrams[trigram].insert(e.first);
+        }
+    }
+}
+
+void
+TrigramIndex::save()
+{
+    if (pending.empty() && exists()) {
+        return;
+    }
+
+    // Outdated records are dropped when they start to dominate.
+    if (!exists() || !canAppend() ||
+        nRecords + pending.size() > 2U*items.size() + 64U) {
+        ensureLoaded();
+        rewrite();
+        pending.clear();
+        return;
+    }
+
+    std::ofstream file(path, std::ios::out | std::ios::app);
+    for (const auto &e : pending) {
+        writeTrigrams(file, e.first, e.second);
+    }
+    if (!file.flush()) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+
+    nRecords += pending.size();
+    pending.clear();
+}
+
+bool
+TrigramIndex::canAppend() const
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file || !file.seekg(0, std::ios::end) || file.tellg() == 0) {
+        return true;
+    }
+
+    // Each complete record is terminated by a new line.
+    char last;
+    return file.seekg(-1, std::ios::end) && file.get(last) && last == '\n';
+}
+
+void
+TrigramIndex::rewrite()
+{
+    const std::string tmpPath = path + ".tmp";
+
+    std::ofstream file(tmpPath);
+    for (const auto &e : items) {
+        writeTrigrams(file, e.first, e.second);
+    }
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write " + tmpPath);
+    }
+
+    fs::rename(tmpPath, path);
+    nRecords = items.size();
+}
+
+void
+TrigramIndex::clear()
+{
+    fs::remove(path);
+    items.clear();
+    trigrams.clear();
+    pending.clear();
+    nRecords = 0U;
+}
+
+/**
+ * @brief Converts string to lower case.
+ *
+ * @param str The string.
+ *
+ * @returns Lower case version of the string.
+ */
+static std::string
+fold(std::string str)
+{
+    for (char &c : str) {
+        c = std::tolower(static_cast<unsigned char>(c));
+    }
+    return str;
+}
@@ -0,0 +1,152 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DIT__TRIGRAMINDEX_HPP__
+#define DIT__TRIGRAMINDEX_HPP__
+
+#include <cstddef>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "StorageBacked.hpp"
+
+/**
+ * @brief Persistent mapping of trigrams of values to ids of items.
+ *
+ * Trigrams are taken from lower case versions of all current values of items,
+ * so the index provides candidates for case-insensitive substring matching.
+ * The file holds per-item records, is append-only and is compacted once it
+ * accumulates too many outdated records.  Lookups stream the file until the
+ * index is modified, which loads it.
+ */
+class TrigramIndex : private StorageBacked<TrigramIndex>
+{
+    friend class StorageBacked<TrigramIndex>;
+
+public:
+    /**
+     * @brief Checks whether index can be used to look for the substring.
+     *
+     * @param needle The substring.
+     *
+     * @returns @c true if so, @c false if substring is too short.
+     */
+    static bool canFind(const std::string &needle);
+
+public:
+    /**
+     * @brief Creates index backed by the specified file.
+     *
+     * @param path Path to the file.
+     */
+    explicit TrigramIndex(std::string path);
+
+public:
+    /**
+     * @brief Checks whether index was built.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    bool exists() const;
+    /**
+     * @brief Finds items that might contain the substring ignoring case.
+     *
+     * @param needle The substring, canFind() must be @c true for it.
+     *
+     * @returns Sorted ids of the items.
+     *
+     * @throws std::runtime_error On broken index.
+     */
+    std::vector<std::string> find(const std::string &needle);
+    /**
+     * @brief Adds values of an item that isn't in the index yet.
+     *
+     * @param id Id of the item.
+     * @param values Values of the item (key -> value).
+     *
+     * @throws std::runtime_error On broken index.
+     */
+    void add(const std::string &id,
+             const std::map<std::string, std::string> &values);
+    /**
+     * @brief Removes an item from the index.
+     *
+     * @param id Id of the item.
+     *
+     * @throws std::runtime_error On broken index.
+     */
+    void remove(const std::string &id);
+    /**
+     * @brief Writes updated records out.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     * @throws std::runtime_error On write failure.
+     */
+    virtual void save() override;
+    /**
+     * @brief Removes the index.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     */
+    void clear();
+
+private:
+    /**
+     * @brief Actually reads the file.
+     *
+     * @throws std::runtime_error On broken file.
+     */
+    void load();
+    /**
+     * @brief Checks whether records can be appended to the file.
+     *
+     * @returns @c true if so, @c false if file ends with a torn record.
+     */
+    bool canAppend() const;
+    /**
+     * @brief Replaces the file with current set of records.
+     *
+     * @throws std::runtime_error On write failure.
+     */
+    void rewrite();
+
+private:
+    /**
+     * @brief Path to the file.
+     */
+    const std::string path;
+    /**
+     * @brief Trigrams of items (id -> trigrams).
+     */
+    std::map<std::string, std::set<std::string>> items;
+    /**
+     * @brief Ids of items by trigrams.
+     */
+    std::map<std::string, std::set<std::string>> trigrams;
+    /**
+     * @brief Records that aren't written out yet (id -> trigrams).
+     */
+    std::map<std::string, std::set<std::string>> pending;
+    /**
+     * @brief Number of records in the file including outdated ones.
+     */
+    std::size_t nRecords = 0U;
+};
+
+#endif // DIT__TRIGRAMINDEX_HPP__
@@ -0,0 +1,130 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ValueIndex.hpp"
+
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "file_format.hpp"
+
+namespace fs = boost::filesystem;
+
+ValueIndex::ValueIndex(std::string path) : path(std::move(path))
+{
+}
+
+bool
+ValueIndex::exists() const
+{
+    return fs::is_directory(path);
+}
+
+std::vector<std::string>
+ValueIndex::find(const std::string &key, const std::string &value)
+{
+    const entries_t &entries = getEntries(key);
+
+    const auto it = entries.find(value);
+    if (it == entries.end()) {
+        return {};
+    }
+    return { it->second.cbegin(), it->second.cend() };
+}
+
+void
+ValueIndex::add(const std::string &id,
+                const std::map<std::string, std::string> &values)
+{
+    for (const auto &e : values) {
+        getEntries(e.first)[e.second].insert(id);
+        keys[e.first].second = true;
+    }
+}
+
+void
+ValueIndex::remove(const std::string &id, const std::set<std::string> &keys)
+{
+    for (const std::string &key : keys) {
+        entries_t &entries = getEntries(key);
+        for (auto it = entries.begin(); it != entries.end(); ) {
+            if (it->second.erase(id) != 0U) {
+                this->keys[key].second = true;
+            }
+
+            if (it->second.empty()) {
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void
+ValueIndex::save()
+{
+    fs::create_directories(path);
+
+    for (auto &e : keys) {
+        if (!e.second.second) {
+            continue;
+        }
+
+        const std::string filePath = (fs::path(path)/e.first).string();
+        const std::string tmpPath = filePath + ".tmp";
+
+        std::ofstream file(tmpPath);
+        writeIndex(file, e.second.first);
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Failed to write " + tmpPath);
+        }
+
+        fs::rename(tmpPath, filePath);
+        e.second.second = false;
+    }
+}
+
+void
+ValueIndex::clear()
+{
+    fs::remove_all(path);
+    keys.clear();
+}
+
+ValueIndex::entries_t &
+ValueIndex::getEntries(const std::string &key)
+{
+    const auto it = keys.find(key);
+    if (it != keys.end()) {
+        return it->second.first;
+    }
+
+    entries_t &entries = keys[key].first;
+    std::ifstream file((fs::path(path)/key).string());
+    if (file) {
+        readIndex(file, entries);
+    }
+    return entries;
+}
@@ -0,0 +1,122 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DIT__VALUEINDEX_HPP__
+#define DIT__VALUEINDEX_HPP__
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Persistent mapping of (key, value) pairs to ids of items.
+ *
+ * Each key is stored in a separate file, which is read only when the key is
+ * queried or updated.
+ */
+class ValueIndex
+{
+public:
+    /**
+     * @brief Creates index backed by the specified directory.
+     *
+     * @param path Path to the directory.
+     */
+    explicit ValueIndex(std::string path);
+
+public:
+    /**
+     * @brief Checks whether index was built.
+     *
+     * @returns @c true if so, @c false otherwise.
+     */
+    bool exists() const;
+    /**
+     * @brief Finds items that have the value of the key.
+     *
+     * @param key Name of the key.
+     * @param value Value of the key.
+     *
+     * @returns Sorted ids of the items.
+     *
+     * @throws std::runtime_error On broken index.
+     */
+    std::vector<std::string> find(const std::string &key,
+                                  const std::string &value);
+    /**
+     * @brief Adds values of an item that isn't in the index yet.
+     *
+     * @param id Id of the item.
+     * @param values Values of the item (key -> value).
+     *
+     * @throws std::runtime_error On broken index.
+     */
+    void add(const std::string &id,
+             const std::map<std::string, std::string> &values);
+    /**
+     * @brief Removes an item from indexes of the keys.
+     *
+     * @param id Id of the item.
+     * @param keys Names of the keys.
+     *
+     * @throws std::runtime_error On broken index.
+     */
+    void remove(const std::string &id, const std::set<std::string> &keys);
+    /**
+     * @brief Writes updated parts of the index out.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     * @throws std::runtime_error On write failure.
+     */
+    void save();
+    /**
+     * @brief Removes the index.
+     *
+     * @throws boost::filesystem::filesystem_error On issues with storage.
+     */
+    void clear();
+
+private:
+    /**
+     * @brief Type of index of a single key (value -> ids).
+     */
+    using entries_t = std::map<std::string, std::set<std::string>>;
+
+    /**
+     * @brief Retrieves index of a key reading it on first use.
+     *
+     * @param key Name of the key.
+     *
+     * @returns The index.
+     *
+     * @throws std::runtime_error On broken index.
+     */
+    entries_t & getEntries(const std::string &key);
+
+private:
+    /**
+     * @brief Path to the directory.
+     */
+    const std::string path;
+    /**
+     * @brief Loaded indexes of keys with a flag of modification (key -> data).
+     */
+    std::map<std::string, std::pair<entries_t, bool>> keys;
+};
+
+#endif // DIT__VALUEINDEX_HPP__
@@ -0,0 +1,347 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <cstdlib>
+
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "utils/args.hpp"
+#include "utils/opts.hpp"
+#include "Command.hpp"
+#include "Commands.hpp"
+#include "Config.hpp"
+#include "Dit.hpp"
+#include "Invocation.hpp"
+#include "Project.hpp"
+#include "parsing.hpp"
+
+namespace po = boost::program_options;
+
+static bool spawnsEditor(const std::string &name,
+                         const std::vector<std::string> &args);
+
+/**
+ * @brief Usage message for "batch" command.
+ */
+const char *const USAGE =
+R"(Usage: batch [--help|-h] [--null|-0] [--save-every|-n count]
+
+Reads command lines (composition of commands followed by its arguments) from
+standard input one per line and executes them as if they were passed to dit one
+by one, except for commands that read standard input or spawn an editor.
+Changes are saved only after all of the commands succeed or after every count of
+successful commands, execution stops at the first failed command discarding
+unsaved changes.)";
+
+namespace {
+
+/**
+ * @brief Where commands of a batch are executed.
+ */
+class Context
+{
+public:
+    /**
+     * @brief Constructs the context.
+     *
+     * @param dit Application instance.
+     */
+    explicit Context(Dit &dit);
+
+public:
+    /**
+     * @brief Retrieves application instance.
+     *
+     * @returns The instance.
+     */
+    Dit & getDit();
+    /**
+     * @brief Retrieves project opening it if necessary.
+     *
+     * @param error Error message on failure to open project.
+     *
+     * @returns The project or @c nullptr setting @p error to a message.
+     */
+    Project * getProject(std::string &error);
+    /**
+     * @brief Saves changes of the project and global configuration.
+     */
+    void save();
+
+private:
+    /**
+     * @brief Application instance.
+     */
+    Dit &dit;
+    /**
+     * @brief Project opened by the batch or @c nullptr.
+     */
+    std::unique_ptr<Project> project;
+};
+
+/**
+ * @brief Implementation of "batch" command, which runs many commands at once.
+ */
+class BatchCmd : public AutoRegisteredCommand<BatchCmd>
+{
+public:
+    /**
+     * @brief Constructs the command implementation.
+     */
+    BatchCmd();
+
+public:
+    /**
+     * @copydoc Command::run(Dit &, const std::vector<std::string> &)
+     */
+    virtual boost::optional<int> run(
+        Dit &dit,
+        const std::vector<std::string> &args) override;
+
+private:
+    /**
+     * @brief Executes commands read from standard input.
+     *
+     * @param ctx Where to execute commands.
+     * @param args List of arguments for the command.
+     *
+     * @returns Exit code suitable for returning it from @c main().
+     */
+    int run(Context &ctx, const std::vector<std::string> &args);
+    /**
+     * @brief Executes single command line.
+     *
+     * Aliases and compositions are expanded the same way as for command-line
+     * of the application.
+     *
+     * @param ctx Where to execute the command.
+     * @param line The command line.
+     *
+     * @returns @c true on success, @c false otherwise.
+     */
+    bool runLine(Context &ctx, const std::string &line);
+
+private:
+    /**
+     * @brief Options of the sub-command.
+     */
+    po::options_description opts;
+};
+
+}
+
+Context::Context(Dit &dit) : dit(dit)
+{
+}
+
+Dit &
+Context::getDit()
+{
+    return dit;
+}
+
+Project *
+Context::getProject(std::string &error)
+{
+    if (project == nullptr) {
+        project = dit.openProject(dit.getPrj(), error);
+    }
+    return project.get();
+}
+
+void
+Context::save()
+{
+    if (project != nullptr) {
+        project->save();
+    }
+    dit.getConfig().save();
+}
+
+BatchCmd::BatchCmd()
+    : parent("batch", "execute commands read from standard input", USAGE),
+      opts("batch sub-command options")
+{
+    opts.add_options()
+        ("help,h", "display help message")
+        ("null,0", "command lines are separated by NUL characters")
+        ("save-every,n", po::value<int>()->default_value(0),
+         "save after this many commands (0 means only at the end)");
+}
+
+boost::optional<int>
+BatchCmd::run(Dit &dit, const std::vector<std::string> &args)
+{
+    Context ctx(dit);
+    const int exitCode = run(ctx, args);
+    // Project is opened here, so it's not saved by the caller.
+    if (exitCode == EXIT_SUCCESS) {
+        ctx.save();
+    }
+    return exitCode;
+}
+
+int
+BatchCmd::run(Context &ctx, const std::vector<std::string> &args)
+{
+    po::variables_map vm = parseOpts(args, opts);
+
+    if (vm.count("help")) {
+        out() << opts;
+        return EXIT_SUCCESS;
+    }
+
+    if (vm.count("positional")) {
+        err() << "Expected no positional arguments.\n";
+        return EXIT_FAILURE;
+    }
+
+    const int saveEvery = vm["save-every"].as<int>();
+    if (saveEvery < 0) {
+        err() << "Number of commands can't be negative.\n";
+        return EXIT_FAILURE;
+    }
+
+    const char separator = vm.count("null") ? '\0' : '\n';
+
+    int nUnsaved = 0;
+    std::string line;
+    while (std::getline(std::cin, line, separator)) {
+        if (line.empty()) {
+            continue;
+        }
+
+        if (!runLine(ctx, line)) {
+            return EXIT_FAILURE;
+        }
+
+        if (++nUnsaved == saveEvery) {
+            ctx.save();
+            nUnsaved = 0;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+bool
+BatchCmd::runLine(Context &ctx, const std::string &line)
+{
+    Dit &dit = ctx.getDit();
+    Config &config = dit.getConfig();
+
+    Invocation invocation;
+    invocation.setDefCmdLine(config.get("core.defcmd"));
+    invocation.setAliasResolver([&config](const std::string &name) {
+        return config.get("alias." + name, std::string());
+    });
+
+    try {
+        std::vector<std::string> cmdLine = breakIntoArgs(line);
+        if (cmdLine.empty()) {
+            return true;
+        }
+
+        invocation.setCmdLine(std::move(cmdLine));
+        invocation.parse();
+    } catch (const std::exception &e) {
+        err() << "Failed to parse command line: " << line << '\n'
+              << e.what() << '\n';
+        return false;
+    }
+
+    // Project and settings are shared by all commands of the batch.
+    if (invocation.shouldPrintHelp() || invocation.shouldPrintVersion() ||
+        !invocation.getPrjName().empty() || !invocation.getConfs().empty()) {
+        err() << "Options, project and settings can't be specified in a "
+                 "batch: " << line << '\n';
+        return false;
+    }
+
+    const std::string name = invocation.getCmdName();
+    const std::vector<std::string> args = invocation.getCmdArgs();
+
+    Command *const cmd = Commands::get(name);
+    if (cmd == nullptr) {
+        err() << "Unknown command name: " << name << '\n';
+        return false;
+    }
+
+    // Standard input is occupied by command lines.
+    if (cmd == this || name == "import") {
+        err() << "Command can't be executed in a batch: " << name << '\n';
+        return false;
+    }
+
+    if (spawnsEditor(name, args)) {
+        err() << "Editor can't be used in a batch: " << line << '\n';
+        return false;
+    }
+
+    boost::optional<int> exitCode = cmd->run(dit, args);
+    if (!exitCode) {
+        std::string error;
+        Project *const project = ctx.getProject(error);
+        if (project == nullptr) {
+            err() << error << '\n';
+            return false;
+        }
+        exitCode = cmd->run(*project, args);
+    }
+    if (!exitCode) {
+        err() << "Command can't be executed in a batch: " << name << '\n';
+        return false;
+    }
+
+    if (*exitCode != EXIT_SUCCESS) {
+        err() << "Command failed: " << line << '\n';
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks whether command asks for a value via an external editor.
+ *
+ * @param name Name of the command.
+ * @param args Arguments of the command.
+ *
+ * @returns @c true if so, @c false otherwise.
+ */
+static bool
+spawnsEditor(const std::string &name, const std::vector<std::string> &args)
+{
+    if (name != "add" && name != "set" && name != "config") {
+        return false;
+    }
+
+    for (const std::string &arg : parsePairedArgs(args)) {
+        const std::string::size_type pos = arg.find('=');
+        if (pos != std::string::npos && arg.compare(pos + 1U,
+                                                    std::string::npos,
+                                                    "-") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -83,7 +83,7 @@ CheckCmd::run(Project &project, const std::vector<std::string> &)
     Storage &storage = project.getStorage();
     IdGenerator &idGenerator = storage.getIdGenerator();
 
-    std::vector<std::reference_wrapper<Item>> items = storage.list();
+    std::vector<std::reference_wrapper<Item>> items = storage.loadAll();
 
     // Check that number of items equals "total" in configuration.
     const int total = items.size();
@@ -0,0 +1,79 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Command.hpp"
+#include "Commands.hpp"
+#include "Project.hpp"
+#include "Storage.hpp"
+
+/**
+ * @brief Usage message for "compact" command.
+ */
+const char *const USAGE = R"(Usage: compact
+
+Rewrites all items compressing cold ones and decompressing the rest, then
+prints number of compressed items.  Item is cold if it wasn't changed for
+storage.compress.age days or its history is at least storage.compress.size
+bytes long.  Data file of packed storage is replaced with one that holds only
+current records.)";
+
+namespace {
+
+/**
+ * @brief Implementation of "compact" command, which recompresses items.
+ */
+class CompactCmd : public AutoRegisteredCommand<CompactCmd>
+{
+public:
+    /**
+     * @brief Constructs the command implementation.
+     */
+    CompactCmd();
+
+public:
+    /**
+     * @copydoc Command::run()
+     */
+    virtual boost::optional<int> run(
+        Project &project,
+        const std::vector<std::string> &args) override;
+};
+
+}
+
+CompactCmd::CompactCmd()
+    : parent("compact", "compress histories of cold items", USAGE)
+{
+}
+
+boost::optional<int>
+CompactCmd::run(Project &project, const std::vector<std::string> &args)
+{
+    if (!args.empty()) {
+        err() << "Expected no arguments.\n";
+        return EXIT_FAILURE;
+    }
+
+    const int nCompressed = project.getStorage().compact();
+    out() << "Compressed items: " << nCompressed << '\n';
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Command.hpp"
+#include "Commands.hpp"
+#include "Daemon.hpp"
+
+/**
+ * @brief Usage message for "daemon" command.
+ */
+const char *const USAGE = R"(Usage: daemon
+
+Runs in foreground serving other invocations of dit until SIGINT or SIGTERM.
+Projects are kept loaded in memory and reloaded when their files change.  The
+socket is created in $XDG_RUNTIME_DIR and invocations use it automatically
+while the server is running.)";
+
+namespace {
+
+/**
+ * @brief Implementation of "daemon" command, which starts a server.
+ */
+class DaemonCmd : public AutoRegisteredCommand<DaemonCmd>
+{
+public:
+    /**
+     * @brief Constructs the command implementation.
+     */
+    DaemonCmd();
+
+public:
+    /**
+     * @copydoc Command::run()
+     */
+    virtual boost::optional<int> run(
+        Dit &dit,
+        const std::vector<std::string> &args) override;
+};
+
+}
+
+DaemonCmd::DaemonCmd() : parent("daemon", "serve invocations from memory", USAGE)
+{
+}
+
+boost::optional<int>
+DaemonCmd::run(Dit &, const std::vector<std::string> &args)
+{
+    if (!args.empty()) {
+        err() << "Expected no arguments.\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        Daemon().serve();
+    } catch (const std::runtime_error &e) {
+        err() << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -14,35 +14,56 @@
 // You should have received a copy of the GNU General Public License
 // along with dit.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 #include <algorithm>
-#include <sstream>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <ostream>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
-#include <boost/algorithm/string/classification.hpp>
-#include <boost/algorithm/string/find_format.hpp>
-#include <boost/algorithm/string/finder.hpp>
+#include <boost/program_options.hpp>
 
+#include "utils/opts.hpp"
 #include "Command.hpp"
 #include "Commands.hpp"
 #include "Item.hpp"
 #include "ItemFilter.hpp"
 #include "Project.hpp"
 #include "completion.hpp"
+#include "integration.hpp"
+
+extern char **environ;
+
+namespace po = boost::program_options;
 
 /**
  * @brief Usage message for "export" command.
  */
-const char *const USAGE = R"(Usage: export (-|cmd) [expr like for ls...]
+const char *const USAGE =
+R"(Usage: export [--help|-h] [--jobs|-j N] [--max-items|-n N] (-|cmd) [expr...]
 
-Either the cmd is run once for each item with arguments of the form key=value
+Either the cmd is run for each item with arguments of the form key=value
 or items are printed to standard output with key=value fields terminated by null
-character and each item also finished by null character.)";
+character and each item also finished by null character.
+
+Expressions are the same as for ls.  Up to --jobs commands are run in parallel,
+their output is printed in order of items.  Up to --max-items items are passed
+to each invocation of the cmd, each item starts with _id=value argument.)";
 
 namespace {
 
@@ -75,71 +96,213 @@ public:
 
 private:
     /**
-     * @brief Invokes the command for given item.
+     * @brief Prints item data to standard output.
      *
-     * @param cmd Beginning of command line to be constructed.
      * @param item Source of item data.
-     *
-     * @throws std::runtime_error On external command failure.
      */
-    void exportItem(const std::string &cmd, Item &item);
+    void printItem(Item &item);
+
+private:
     /**
-     * @brief Escapes special shell characters in a string.
-     *
-     * @param str String to escape.
-     *
-     * @returns Escaped string.
+     * @brief Options of the sub-command.
      */
-    std::string shellEscape(std::string str);
+    po::options_description opts;
 };
 
 /**
- * @brief Command-line escaping helper.
+ * @brief Runs exporters in parallel reporting their results in order.
+ *
+ * Exporters are started in the order of their items.  Unless there is only one
+ * job at a time, output of exporters is captured into temporary files and
+ * printed once all preceding exporters have finished.
+ *
+ * Like std::system(), SIGINT and SIGQUIT are ignored while exporters are
+ * around, so that interrupting them from terminal makes export fail instead of
+ * killing it.  Only processes started here are waited for.
  */
-class ShellEscaper
+class Exporters
 {
 public:
     /**
-     * @brief Escapes range of characters.
+     * @brief Prepares to run exporters setting up signal handling.
      *
-     * @tparam T Type of range.
-     * @param match Range itself.
+     * @param maxJobs Maximum number of exporters running at the same time.
+     * @param out Stream for standard output of exporters.
+     */
+    Exporters(unsigned int maxJobs, std::ostream &out);
+    /**
+     * @brief Waits for exporters that are still running discarding output.
      *
-     * @returns Escaped range.
+     * Signal handling is restored afterwards.
      */
-    template <typename T>
-    std::string operator()(const T& match) const
+    ~Exporters();
+
+public:
+    /**
+     * @brief Starts new exporter, waiting for a free job if needed.
+     *
+     * @param cmd Command to run via shell.
+     * @param args Arguments of the command.
+     *
+     * @throws std::runtime_error On failure of an earlier exporter or if
+     *                            exporter can't be started.
+     */
+    void run(const std::string &cmd, const std::vector<std::string> &args);
+    /**
+     * @brief Waits for all exporters to finish.
+     *
+     * @throws std::runtime_error On failure of an exporter.
+     */
+    void finish();
+
+private:
+    /**
+     * @brief Temporary file that is closed automatically.
+     */
+    using file_t = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+
+    /**
+     * @brief Information about single exporter.
+     */
+    struct Job
     {
-        std::ostringstream oss;
-        for (const auto &c : match) {
-            oss << '\\' << c;
-        }
-        return oss.str();
-    }
+        pid_t pid;          //!< Process id.
+        file_t output;      //!< Captured standard output or @c nullptr.
+        file_t errors;      //!< Captured standard error or @c nullptr.
+        bool finished;      //!< Whether process has exited.
+        bool success;       //!< Whether process has exited successfully.
+    };
+
+private:
+    /**
+     * @brief Waits for any of running exporters to finish.
+     *
+     * @throws std::runtime_error On failure to wait.
+     */
+    void waitForOne();
+    /**
+     * @brief Prints output of leading finished exporters and forgets them.
+     *
+     * @throws std::runtime_error On failure of an exporter.
+     */
+    void reportFinished();
+
+private:
+    /**
+     * @brief Maximum number of exporters running at the same time.
+     */
+    const unsigned int maxJobs;
+    /**
+     * @brief Stream for standard output of exporters.
+     */
+    std::ostream &out;
+    /**
+     * @brief Exporters that weren't reported yet in order of their start.
+     */
+    std::deque<Job> jobs;
+    /**
+     * @brief Number of exporters that haven't finished yet.
+     */
+    unsigned int nRunning = 0U;
+    /**
+     * @brief Set that consists of SIGCHLD, which is blocked to be waited for.
+     */
+    sigset_t chldMask;
+    /**
+     * @brief Signal mask to restore.
+     */
+    sigset_t prevMask;
+    /**
+     * @brief Action for SIGINT to restore.
+     */
+    struct sigaction prevInt;
+    /**
+     * @brief Action for SIGQUIT to restore.
+     */
+    struct sigaction prevQuit;
 };
 
 }
 
-ExportCmd::ExportCmd() : parent("export", "item data exporter", USAGE)
+static void appendItem(std::vector<std::string> &args, Item &item);
+static void copyFile(std::FILE *file, std::ostream &os);
+
+ExportCmd::ExportCmd()
+    : parent("export", "item data exporter", USAGE),
+      opts("export sub-command options")
 {
+    opts.add_options()
+        ("help,h", "display help message")
+        ("jobs,j", po::value<unsigned int>()->default_value(1U),
+         "run up to N commands in parallel")
+        ("max-items,n", po::value<unsigned int>()->default_value(1U),
+         "pass up to N items to each invocation of the command");
 }
 
 boost::optional<int>
 ExportCmd::run(Project &project, const std::vector<std::string> &args)
 {
-    if (args.empty()) {
+    po::variables_map vm = parseOpts(args, opts);
+
+    if (vm.count("help")) {
+        out() << opts;
+        return EXIT_SUCCESS;
+    }
+
+    if (!vm.count("positional")) {
         err() << "Expected at least one argument.\n";
         return EXIT_FAILURE;
     }
 
-    const std::string &cmd = args.front();
-    ItemFilter filter({ args.cbegin() + 1, args.cend() });
+    const unsigned int maxJobs = vm["jobs"].as<unsigned int>();
+    const unsigned int maxItems = vm["max-items"].as<unsigned int>();
+    if (maxJobs == 0U || maxItems == 0U) {
+        err() << "Number of jobs and items must be positive.\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto &positional = vm["positional"].as<std::vector<std::string>>();
+    const std::string &cmd = positional.front();
+    ItemFilter filter({ positional.cbegin() + 1, positional.cend() });
+
+    // Check for special value meaning "printing to stdout".
+    if (cmd == "-") {
+        for (Item &item : filter.select(project.getStorage())) {
+            if (RedirectToPager::isConsumerGone()) {
+                break;
+            }
+            if (filter.passes(item)) {
+                printItem(item);
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Execute commands after anything we've output so far.
+    out().flush();
 
-    for (Item &item : project.getStorage().list()) {
-        if (filter.passes(item)) {
-            exportItem(cmd, item);
+    Exporters exporters(maxJobs, out());
+    std::vector<std::string> cmdArgs;
+    unsigned int nItems = 0U;
+    for (Item &item : filter.select(project.getStorage())) {
+        if (RedirectToPager::isConsumerGone()) {
+            break;
+        }
+        if (!filter.passes(item)) {
+            continue;
         }
+
+        appendItem(cmdArgs, item);
+        if (++nItems == maxItems) {
+            exporters.run(cmd, cmdArgs);
+            cmdArgs.clear();
+            nItems = 0U;
+        }
+    }
+    if (nItems != 0U) {
+        exporters.run(cmd, cmdArgs);
     }
+    exporters.finish();
 
     return EXIT_SUCCESS;
 }
@@ -154,49 +317,213 @@ ExportCmd::complete(Project &project, const std::vector<std::string> &args)
 }
 
 void
-ExportCmd::exportItem(const std::string &cmd, Item &item)
+ExportCmd::printItem(Item &item)
 {
-    // Check for special value meaning "printing to stdout".
-    if (cmd == "-") {
-        out() << "_id=" << item.getValue("_id") << '\0';
-        for (const std::string &key : item.listRecordNames()) {
-            out() << key << '=' << item.getValue(key) << '\0';
-        }
-        out() << '\0';
-        return;
+    out() << "_id=" << item.getValue("_id") << '\0';
+    for (const std::string &key : item.listRecordNames()) {
+        out() << key << '=' << item.getValue(key) << '\0';
     }
+    out() << '\0';
+}
 
-    // Compose command-line.
-    std::ostringstream cmdLine(cmd, std::ios::out | std::ios::ate);
-    cmdLine << " _id=" << shellEscape(item.getValue("_id"));
+/**
+ * @brief Appends arguments that describe an item to argument list.
+ *
+ * @param args Argument list to extend.
+ * @param item Source of item data.
+ */
+static void
+appendItem(std::vector<std::string> &args, Item &item)
+{
+    // Turn newlines into spaces and let export client wrap the result if
+    // needed.
+    auto arg = [](const std::string &key, std::string value) {
+        std::replace(value.begin(), value.end(), '\n', ' ');
+        return key + '=' + value;
+    };
+
+    args.push_back(arg("_id", item.getValue("_id")));
     for (const std::string &key : item.listRecordNames()) {
-        cmdLine << ' ' << key << '=' << shellEscape(item.getValue(key));
+        args.push_back(arg(key, item.getValue(key)));
     }
+}
 
-    // Execute the command-line.
-    int status = std::system(cmdLine.str().c_str());
-    bool success = (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+Exporters::Exporters(unsigned int maxJobs, std::ostream &out)
+    : maxJobs(maxJobs), out(out)
+{
+    struct sigaction ignore = {};
+    ignore.sa_handler = SIG_IGN;
+    sigemptyset(&ignore.sa_mask);
+    sigaction(SIGINT, &ignore, &prevInt);
+    sigaction(SIGQUIT, &ignore, &prevQuit);
 
-    // Throw an exception on failure.
-    if (!success) {
-        throw std::runtime_error("Exporter client returned an error.");
+    // Blocked SIGCHLD stays pending until it's waited for.
+    sigemptyset(&chldMask);
+    sigaddset(&chldMask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chldMask, &prevMask);
+}
+
+Exporters::~Exporters()
+{
+    while (nRunning != 0U) {
+        try {
+            waitForOne();
+        } catch (const std::runtime_error &) {
+            break;
+        }
     }
+
+    sigprocmask(SIG_SETMASK, &prevMask, nullptr);
+    sigaction(SIGINT, &prevInt, nullptr);
+    sigaction(SIGQUIT, &prevQuit, nullptr);
 }
 
-std::string
-ExportCmd::shellEscape(std::string str)
+void
+Exporters::run(const std::string &cmd, const std::vector<std::string> &args)
 {
-    // Turn newlines into spaces and let export client wrap the result if
-    // needed.
-    // XXX: might not be the best solution, but will do for most use cases.
-    std::replace(str.begin(), str.end(), '\n', ' ');
+    reportFinished();
+    while (nRunning >= maxJobs) {
+        waitForOne();
+        reportFinished();
+    }
+
+    // Command is run by shell, which receives item data as positional
+    // parameters and thus doesn't need them escaped.
+    std::vector<std::string> argv = { "sh", "-c", cmd + " \"$@\"", "sh" };
+    argv.insert(argv.end(), args.cbegin(), args.cend());
+
+    std::vector<char *> cargv;
+    for (std::string &arg : argv) {
+        cargv.push_back(&arg[0]);
+    }
+    cargv.push_back(nullptr);
+
+    Job job = { -1, file_t(nullptr, &std::fclose),
+                file_t(nullptr, &std::fclose), false, false };
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (maxJobs > 1U) {
+        job.output.reset(std::tmpfile());
+        job.errors.reset(std::tmpfile());
+        if (!job.output || !job.errors) {
+            posix_spawn_file_actions_destroy(&actions);
+            throw std::runtime_error("Failed to create temporary file.");
+        }
+        posix_spawn_file_actions_adddup2(&actions, fileno(job.output.get()),
+                                         STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, fileno(job.errors.get()),
+                                         STDERR_FILENO);
+    }
+
+    // Exporters shouldn't inherit our signal handling.
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGINT);
+    sigaddset(&defaults, SIGQUIT);
+    sigaddset(&defaults, SIGPIPE);
 
-    // Escape characters that have special meaning for shells.
-    boost::find_format_all(
-        str,
-        boost::token_finder(
-            boost::is_any_of("\\\r\n\t'\"; ?|[]{}<>`!$&*()#~")),
-        ShellEscaper());
+    posix_spawnattr_t attrs;
+    posix_spawnattr_init(&attrs);
+    posix_spawnattr_setflags(&attrs,
+                             POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+    posix_spawnattr_setsigdefault(&attrs, &defaults);
+    posix_spawnattr_setsigmask(&attrs, &prevMask);
 
-    return str;
+    const int error = posix_spawn(&job.pid, "/bin/sh", &actions, &attrs,
+                                  cargv.data(), environ);
+    posix_spawnattr_destroy(&attrs);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) {
+        throw std::runtime_error(std::string("Failed to run exporter: ") +
+                                 std::strerror(error));
+    }
+
+    jobs.push_back(std::move(job));
+    ++nRunning;
+}
+
+void
+Exporters::finish()
+{
+    while (nRunning != 0U) {
+        waitForOne();
+        reportFinished();
+    }
+    reportFinished();
+}
+
+void
+Exporters::waitForOne()
+{
+    // Each SIGCHLD is followed by a check of every running exporter, so
+    // signals that arrive during the check aren't lost.
+    const timespec timeout = { 1, 0 };
+    while (true) {
+        for (Job &job : jobs) {
+            if (job.finished) {
+                continue;
+            }
+
+            int status;
+            const pid_t pid = waitpid(job.pid, &status, WNOHANG);
+            if (pid == 0 || (pid == -1 && errno == EINTR)) {
+                continue;
+            }
+
+            if (pid == -1) {
+                const int error = errno;
+                nRunning = 0U;
+                throw std::runtime_error("Failed to wait for exporter: " +
+                                         std::string(std::strerror(error)));
+            }
+
+            job.finished = true;
+            job.success = (WIFEXITED(status) &&
+                           WEXITSTATUS(status) == EXIT_SUCCESS);
+            --nRunning;
+            return;
+        }
+
+        sigtimedwait(&chldMask, nullptr, &timeout);
+    }
+}
+
+void
+Exporters::reportFinished()
+{
+    while (!jobs.empty() && jobs.front().finished) {
+        const Job job = std::move(jobs.front());
+        jobs.pop_front();
+
+        if (job.output) {
+            copyFile(job.output.get(), out);
+            out.flush();
+        }
+        if (job.errors) {
+            copyFile(job.errors.get(), std::cerr);
+        }
+
+        if (!job.success) {
+            throw std::runtime_error("Exporter client returned an error.");
+        }
+    }
+}
+
+/**
+ * @brief Prints out contents of a file from its beginning.
+ *
+ * @param file The file.
+ * @param os Stream to print to.
+ */
+static void
+copyFile(std::FILE *file, std::ostream &os)
+{
+    std::rewind(file);
+
+    char buf[4096];
+    std::size_t n;
+    while ((n = std::fread(buf, 1U, sizeof(buf), file)) != 0U) {
+        os.write(buf, n);
+    }
 }
@@ -0,0 +1,167 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <cstddef>
+#include <cstdlib>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Command.hpp"
+#include "Commands.hpp"
+#include "Item.hpp"
+#include "Project.hpp"
+#include "Storage.hpp"
+#include "file_format.hpp"
+
+/**
+ * @brief Usage message for "import" command.
+ */
+const char *const USAGE = R"(Usage: import
+
+Reads items in the form produced by "export -" from standard input and adds
+them to the project as new items, then prints import rate.  Pseudo-fields (like
+_id) are ignored.  Items are saved all at once after reading whole input, so
+nothing is imported if any of the items is malformed.)";
+
+/**
+ * @brief Number of items whose ids are allocated at once.
+ *
+ * Batches only amortize id allocation, created items stay in memory until
+ * project is saved after the command is done.
+ */
+const std::size_t batchSize = 1024U;
+
+namespace {
+
+/**
+ * @brief Implementation of "import" command, which adds items in bulk.
+ */
+class ImportCmd : public AutoRegisteredCommand<ImportCmd>
+{
+public:
+    /**
+     * @brief Constructs the command implementation.
+     */
+    ImportCmd();
+
+public:
+    /**
+     * @copydoc Command::run()
+     */
+    virtual boost::optional<int> run(
+        Project &project,
+        const std::vector<std::string> &args) override;
+};
+
+}
+
+/**
+ * @brief Type of fields of a single item.
+ */
+using fields_t = std::vector<std::pair<std::string, std::string>>;
+
+static void importBatch(Storage &storage, const std::vector<fields_t> &batch);
+
+ImportCmd::ImportCmd() : parent("import", "item data importer", USAGE)
+{
+}
+
+boost::optional<int>
+ImportCmd::run(Project &project, const std::vector<std::string> &args)
+{
+    if (!args.empty()) {
+        err() << "Expected no arguments.\n";
+        return EXIT_FAILURE;
+    }
+
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+
+    Storage &storage = project.getStorage();
+
+    std::size_t nRead = 0U, nImported = 0U;
+    std::vector<fields_t> batch;
+    fields_t fields;
+    try {
+        while (readExportedItem(std::cin, fields)) {
+            fields_t item;
+            for (auto &field : fields) {
+                if (field.first[0] == '_' || field.second.empty()) {
+                    continue;
+                }
+
+                std::string error;
+                if (!Item::isValidKeyName(field.first, true, error)) {
+                    throw std::runtime_error(error);
+                }
+                item.push_back(std::move(field));
+            }
+
+            ++nRead;
+            if (item.empty()) {
+                continue;
+            }
+
+            batch.push_back(std::move(item));
+            if (batch.size() == batchSize) {
+                importBatch(storage, batch);
+                nImported += batch.size();
+                batch.clear();
+            }
+        }
+        importBatch(storage, batch);
+        nImported += batch.size();
+    } catch (const std::runtime_error &e) {
+        err() << "Failed to import item #" << nRead + 1U << ": " << e.what()
+              << '\n';
+        return EXIT_FAILURE;
+    }
+
+    const std::chrono::duration<double> elapsed = clock::now() - start;
+    const double rate = (elapsed.count() > 0.0)
+                      ? nImported/elapsed.count()
+                      : nImported;
+
+    out() << "Imported items: " << nImported
+          << " (" << static_cast<unsigned long long>(rate) << " items/sec)\n";
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Creates items for a batch of parsed ones.
+ *
+ * @param storage Storage to add items to.
+ * @param batch Fields of the items with valid key names.
+ */
+static void
+importBatch(Storage &storage, const std::vector<fields_t> &batch)
+{
+    std::vector<std::reference_wrapper<Item>> items =
+        storage.create(batch.size());
+
+    for (std::size_t i = 0U; i < batch.size(); ++i) {
+        for (const auto &field : batch[i]) {
+            items[i].get().setValue(field.first, field.second);
+        }
+    }
+}
@@ -37,6 +37,7 @@
 #include "Storage.hpp"
 #include "completion.hpp"
 #include "decoration.hpp"
+#include "integration.hpp"
 #include "printing.hpp"
 
 namespace po = boost::program_options;
@@ -109,40 +110,48 @@ LogCmd::run(Project &project, const std::vector<std::string> &args)
     auto positional = vm["positional"].as<std::vector<std::string>>();
 
     const std::string &id = positional[0];
-    std::unordered_set<std::string> filter {
-        ++positional.cbegin(), positional.cend()
-    };
+    std::unordered_set<Change::KeyId> filter;
+    for (auto it = ++positional.cbegin(); it != positional.cend(); ++it) {
+        filter.insert(Change::findKey(*it));
+    }
 
     Item &item = project.getStorage().get(id);
     const std::vector<Change> &changes = item.getChanges();
 
-    std::unordered_map<std::string, std::string> values;
+    // Previous values point into the change set, which isn't changed here.
+    std::unordered_map<Change::KeyId, const std::string *> values;
 
     for (const Change &change : changes) {
+        if (RedirectToPager::isConsumerGone()) {
+            break;
+        }
+
         const std::string &key = change.getKey();
         const std::string &value = change.getValue();
 
-        if (!filter.empty() && !contains(filter, key)) {
+        if (!filter.empty() && !contains(filter, change.getKeyId())) {
             continue;
         }
 
+        const std::string *&prev = values[change.getKeyId()];
+
         const std::string at = withTimestamps
                              ? " (" + timeToString(change.getTimestamp()) + ')'
                              : std::string();
         if (value.empty()) {
             out() << Key{key} << (decor::red_fg + decor::bold << " deleted")
                   << at << '\n';
-        } else if (values[key].empty()) {
+        } else if (prev == nullptr || prev->empty()) {
             out() << Key{key} << (decor::yellow_fg + decor::bold << " created")
                   << at
                   << Value{value} << '\n';
         } else {
             out() << Key{key} << (decor::blue_fg + decor::bold << " changed")
                   << at
-                  << Value{diff(split(values[key], '\n'), split(value, '\n'))};
+                  << Value{diff(split(*prev, '\n'), split(value, '\n'))};
         }
 
-        values[key] = value;
+        prev = &value;
     }
 
     return EXIT_SUCCESS;
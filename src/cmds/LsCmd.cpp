@@ -14,12 +14,15 @@
 // You should have received a copy of the GNU General Public License
 // along with dit.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <boost/program_options.hpp>
+
 #include <cstdlib>
 
 #include <string>
 #include <unordered_set>
 #include <vector>
 
+#include "utils/opts.hpp"
 #include "Command.hpp"
 #include "Commands.hpp"
 #include "Item.hpp"
@@ -33,7 +36,7 @@
 /**
  * @brief Usage message for "ls" command.
  */
-const char *const USAGE = R"(Usage: ls [expr...]
+const char *const USAGE = R"(Usage: ls [--help|-h] [--limit|-n N] [--unsorted|-u] [expr...]
 
 Where <expr> is of the form:
 
@@ -49,6 +52,8 @@ For example:
     status==done title/ui
     category!=cli)";
 
+namespace po = boost::program_options;
+
 namespace {
 
 /**
@@ -75,28 +80,77 @@ public:
     virtual boost::optional<int> complete(
         Project &project,
         const std::vector<std::string> &args) override;
+
+private:
+    /**
+     * @brief Options of the sub-command.
+     */
+    po::options_description opts;
 };
 
 }
 
-LsCmd::LsCmd() : parent("ls", "list items", USAGE)
+LsCmd::LsCmd()
+    : parent("ls", "list items", USAGE), opts("ls sub-command options")
 {
+    opts.add_options()
+        ("help,h", "display help message")
+        ("limit,n", po::value<unsigned int>()->default_value(0U),
+         "display at most N first items (0 means no limit)")
+        ("unsorted,u", "keep items in order of storage");
 }
 
 boost::optional<int>
 LsCmd::run(Project &project, const std::vector<std::string> &args)
 {
+    po::variables_map vm = parseOpts(args, opts);
+    if (vm.count("help")) {
+        out() << opts;
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<std::string> exprs;
+    if (vm.count("positional")) {
+        exprs = vm["positional"].as<std::vector<std::string>>();
+    }
+
     Config &config = project.getConfig();
     std::string fmt = config.get("ui.ls.fmt");
     std::string colorSpec = config.get("ui.ls.color");
-    std::string sort = config.get("ui.ls.sort");
+    std::string sort = vm.count("unsorted") ? std::string()
+                                            : config.get("ui.ls.sort");
+    const unsigned int limit = vm["limit"].as<unsigned int>();
+
+    ItemTable table(fmt, colorSpec, sort, getTerminalWidth(), limit);
+
+    if (!isOutputToTerminal()) {
+        const std::string layout = config.get("ui.ls.pipe", "table");
+        if (layout == "tsv") {
+            table.makeDelimited(out(), '\t');
+        } else if (layout == "nul") {
+            table.makeDelimited(out(), '\0');
+        } else if (layout != "table") {
+            err() << "Unknown value of ui.ls.pipe: " << layout << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    ItemFilter filter(exprs);
 
-    ItemTable table(fmt, colorSpec, sort, getTerminalWidth());
-    ItemFilter filter(args);
+    // Rows that are printed right away don't need all items to be read first.
+    if (table.isStreaming()) {
+        filter.forEachMatch(project.getStorage(), [&table](Item &item) {
+            table.append(item);
+            return !table.isFull() && !RedirectToPager::isConsumerGone();
+        });
+        return EXIT_SUCCESS;
+    }
 
-    for (Item &item : project.getStorage().list()) {
+    for (Item &item : filter.select(project.getStorage())) {
         if (filter.passes(item)) {
             table.append(item);
+            if (table.isFull()) {
+                break;
+            }
         }
     }
 
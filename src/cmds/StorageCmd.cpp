@@ -0,0 +1,141 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utils/contains.hpp"
+#include "ChangeFormat.hpp"
+#include "Command.hpp"
+#include "Commands.hpp"
+#include "Project.hpp"
+#include "Storage.hpp"
+#include "StorageBackend.hpp"
+
+/**
+ * @brief Usage message for "storage" command.
+ */
+const char *const USAGE = R"(Usage: storage [dir|packed|text|binary]
+
+Without arguments prints name of storage backend of the project followed by
+name of format if it's not the default one.
+
+With a backend name moves items to the specified backend:
+
+    dir     --  one file per item under items/ directory
+    packed  --  single append-only data file plus an index
+
+With a format name rewrites items in the specified format:
+
+    text    --  human-readable lines
+    binary  --  compact form that is faster to read)";
+
+namespace {
+
+/**
+ * @brief Implementation of "storage" command, which manages item storage.
+ */
+class StorageCmd : public AutoRegisteredCommand<StorageCmd>
+{
+public:
+    /**
+     * @brief Constructs the command implementation.
+     */
+    StorageCmd();
+
+public:
+    /**
+     * @copydoc Command::run()
+     */
+    virtual boost::optional<int> run(
+        Project &project,
+        const std::vector<std::string> &args) override;
+    /**
+     * @copydoc Command::complete()
+     */
+    virtual boost::optional<int> complete(
+        Project &project,
+        const std::vector<std::string> &args) override;
+};
+
+}
+
+StorageCmd::StorageCmd() : parent("storage", "view/change item storage", USAGE)
+{
+}
+
+boost::optional<int>
+StorageCmd::run(Project &project, const std::vector<std::string> &args)
+{
+    Storage &storage = project.getStorage();
+
+    if (args.empty()) {
+        out() << storage.getBackendName();
+        if (storage.getFormatName() != ChangeFormat::list().front()) {
+            out() << ' ' << storage.getFormatName();
+        }
+        out() << '\n';
+        return EXIT_SUCCESS;
+    }
+
+    if (args.size() != 1U) {
+        err() << "Expected at most one argument.\n";
+        return EXIT_FAILURE;
+    }
+
+    const std::string &name = args[0];
+    if (contains(ChangeFormat::list(), name)) {
+        if (storage.getFormatName() == name) {
+            err() << "Project already uses this format: " << name << '\n';
+            return EXIT_FAILURE;
+        }
+
+        storage.convertFormat(name);
+        return EXIT_SUCCESS;
+    }
+
+    if (!contains(StorageBackend::list(), name)) {
+        err() << "Unknown storage backend: " << name << '\n';
+        return EXIT_FAILURE;
+    }
+
+    if (storage.getBackendName() == name) {
+        err() << "Project already uses this backend: " << name << '\n';
+        return EXIT_FAILURE;
+    }
+
+    storage.convert(name);
+    return EXIT_SUCCESS;
+}
+
+boost::optional<int>
+StorageCmd::complete(Project &, const std::vector<std::string> &args)
+{
+    if (args.size() > 1U) {
+        return EXIT_FAILURE;
+    }
+
+    for (const std::string &name : StorageBackend::list()) {
+        out() << name << '\n';
+    }
+    for (const std::string &name : ChangeFormat::list()) {
+        out() << name << '\n';
+    }
+    return EXIT_SUCCESS;
+}
@@ -77,7 +77,7 @@ ValuesCmd::run(Project &project, const std::vector<std::string> &args)
 
     std::set<std::string> values;
 
-    for (Item &item : project.getStorage().list()) {
+    for (Item &item : project.getStorage().loadAll()) {
         std::string value = item.getValue(args[0]);
         if (!value.empty()) {
             values.insert(std::move(value));
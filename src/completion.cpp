@@ -28,6 +28,7 @@
 #include <boost/range/iterator_range.hpp>
 #include <boost/filesystem.hpp>
 
+#include "CompletionCache.hpp"
 #include "Item.hpp"
 #include "Project.hpp"
 #include "Storage.hpp"
@@ -50,9 +51,18 @@ listProjects(const std::string &projectsDir)
     return names;
 }
 
+static std::set<std::string> listKeys(Storage &storage);
+
 int
 completeIds(Storage &storage, std::ostream &os)
 {
+    if (CompletionCache *cache = storage.getCompletionCache()) {
+        for (const std::string &id : cache->getIds()) {
+            os << id << '\n';
+        }
+        return EXIT_SUCCESS;
+    }
+
     for (Item &item : storage.list()) {
         os << item.getId() << '\n';
     }
@@ -79,12 +89,7 @@ completeKeys(Item &item, std::ostream &os, const std::vector<std::string> &args)
 int
 completeKeys(Storage &storage, std::ostream &os)
 {
-    std::set<std::string> keys;
-
-    for (Item &item : storage.list()) {
-        const std::set<std::string> &itemKeys = item.listRecordNames();
-        keys.insert(itemKeys.cbegin(), itemKeys.cend());
-    }
+    std::set<std::string> keys = listKeys(storage);
 
     for (const std::string &key : keys) {
         os << key << '\n';
@@ -97,12 +102,7 @@ int
 completeKeys(Storage &storage, std::ostream &os,
              const std::vector<std::string> &args)
 {
-    std::set<std::string> keys;
-
-    for (Item &item : storage.list()) {
-        const std::set<std::string> &itemKeys = item.listRecordNames();
-        keys.insert(itemKeys.cbegin(), itemKeys.cend());
-    }
+    std::set<std::string> keys = listKeys(storage);
 
     // Remove elements already present on the command-line from completion list.
     for (const std::string &arg : args) {
@@ -129,6 +129,13 @@ completeKeys(Storage &storage, std::ostream &os,
 int
 completeValues(Storage &storage, std::ostream &os, const std::string &key)
 {
+    if (CompletionCache *cache = storage.getCompletionCache()) {
+        for (const std::string &value : cache->getValues(key)) {
+            os << value << '\n';
+        }
+        return EXIT_SUCCESS;
+    }
+
     std::set<std::string> values;
 
     for (Item &item : storage.list()) {
@@ -144,3 +151,25 @@ completeValues(Storage &storage, std::ostream &os, const std::string &key)
 
     return EXIT_SUCCESS;
 }
+
+/**
+ * @brief Lists names of keys that have values in at least one item.
+ *
+ * @param storage Storage of items.
+ *
+ * @returns The names.
+ */
+static std::set<std::string>
+listKeys(Storage &storage)
+{
+    if (CompletionCache *cache = storage.getCompletionCache()) {
+        return cache->getKeys();
+    }
+
+    std::set<std::string> keys;
+    for (Item &item : storage.loadAll()) {
+        const std::set<std::string> &itemKeys = item.listRecordNames();
+        keys.insert(itemKeys.cbegin(), itemKeys.cend());
+    }
+    return keys;
+}
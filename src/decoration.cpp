@@ -32,6 +32,14 @@ public:
      * @brief Constructs the class checking whether stdout is a terminal.
      */
     void disable() { isAscii = false; }
+    /**
+     * @brief Enables decorations regardless of type of stdout.
+     */
+    void enable() { isAscii = true; }
+    /**
+     * @brief Enables decorations if stdout is a terminal.
+     */
+    void detect() { isAscii = isOutputToTerminal(); }
 
     const char * bold () { return isAscii ? "\033[1m" : ""; }
     const char * inv  () { return isAscii ? "\033[7m" : ""; }
@@ -153,3 +161,15 @@ decor::disableDecorations(pk<Tests>)
 {
     C.disable();
 }
+
+void
+decor::enableDecorations(pk<Tests>)
+{
+    C.enable();
+}
+
+void
+decor::detectTerminal(pk<Daemon>)
+{
+    C.detect();
+}
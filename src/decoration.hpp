@@ -25,6 +25,7 @@
 
 #include "utils/Passkey.hpp"
 
+class Daemon;
 class Tests;
 
 /**
@@ -379,6 +380,18 @@ extern const Decoration white_bg;
  */
 void disableDecorations(pk<Tests>);
 
+/**
+ * @brief Forces enabling of decorations.
+ */
+void enableDecorations(pk<Tests>);
+
+/**
+ * @brief Checks again whether decorations should be enabled.
+ *
+ * Needed after standard output was replaced.
+ */
+void detectTerminal(pk<Daemon>);
+
 /**
  * @}
  */
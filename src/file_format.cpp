@@ -17,31 +17,46 @@
 #include "file_format.hpp"
 
 #include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <ctime>
 
 #include <istream>
+#include <limits>
+#include <map>
 #include <ostream>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
-#include <boost/algorithm/string/replace.hpp>
-#include <boost/lexical_cast.hpp>
-
 #include "utils/getLines.hpp"
 #include "utils/strings.hpp"
 #include "Change.hpp"
+#include "KeyTable.hpp"
 
+static std::time_t parseTimestamp(const char *from, const char *to);
 static std::pair<std::string, std::string> splitRecord(const std::string &s);
-static std::string decode(std::string str);
-static std::string encode(std::string str);
+static std::string decode(const char *from, const char *to);
+static std::string encode(const std::string &str);
+static bool readVarint(const char *&p, const char *end, std::uint64_t &value);
+static void writeVarint(std::string &buf, std::uint64_t value);
+
+/**
+ * @brief Signature at the beginning of binary change sets.
+ */
+static const char binaryMagic[] = { '\x89', 'D', 'I', 'T' };
+/**
+ * @brief Version of binary format that follows the signature.
+ */
+static const char binaryVersion = '\x01';
 
 std::istream &
 operator>>(std::istream &s, std::vector<Change> &changes)
 {
-    using boost::lexical_cast;
-
     std::time_t timestamp;
     bool timestampSet = false;
     for (const std::string &l : getLines(s)) {
@@ -50,7 +65,7 @@ operator>>(std::istream &s, std::vector<Change> &changes)
         }
 
         if (std::isdigit(l[0])) {
-            timestamp = lexical_cast<std::time_t>(l);
+            timestamp = parseTimestamp(l.data(), l.data() + l.size());
             timestampSet = true;
             continue;
         }
@@ -68,6 +83,80 @@ operator>>(std::istream &s, std::vector<Change> &changes)
     return s;
 }
 
+void
+parseChanges(const char data[], std::size_t size, std::vector<Change> &changes)
+{
+    const char *const end = data + size;
+
+    std::time_t timestamp;
+    bool timestampSet = false;
+    for (const char *l = data; ; ) {
+        // Unterminated last line is ignored just like getLines() does.
+        const char *const eol =
+            static_cast<const char *>(std::memchr(l, '\n', end - l));
+        if (eol == nullptr) {
+            break;
+        }
+
+        if (eol == l) {
+            throw std::runtime_error("Empty strings are not expected");
+        }
+
+        if (std::isdigit(*l)) {
+            timestamp = parseTimestamp(l, eol);
+            timestampSet = true;
+        } else {
+            if (!timestampSet) {
+                throw std::runtime_error("Wrong field ordering, no timestamp");
+            }
+
+            const char *const eq =
+                static_cast<const char *>(std::memchr(l, '=', eol - l));
+            if (eq == nullptr) {
+                throw std::runtime_error("Can't split " + std::string(l, eol) +
+                                         " with =");
+            }
+
+            changes.emplace_back(timestamp, std::string(l, eq),
+                                 decode(eq + 1, eol));
+        }
+
+        l = eol + 1;
+    }
+}
+
+/**
+ * @brief Parses timestamp line.
+ *
+ * @param from Beginning of the line.
+ * @param to End of the line.
+ *
+ * @returns The timestamp.
+ *
+ * @throws std::runtime_error On wrong format or overflow.
+ */
+static std::time_t
+parseTimestamp(const char *from, const char *to)
+{
+    const std::time_t max = std::numeric_limits<std::time_t>::max();
+
+    std::time_t timestamp = 0;
+    for (const char *c = from; c != to; ++c) {
+        if (!std::isdigit(*c)) {
+            throw std::runtime_error("Invalid timestamp: " +
+                                     std::string(from, to));
+        }
+
+        const int digit = *c - '0';
+        if (timestamp > (max - digit)/10) {
+            throw std::runtime_error("Timestamp is too big: " +
+                                     std::string(from, to));
+        }
+        timestamp = timestamp*10 + digit;
+    }
+    return timestamp;
+}
+
 /**
  * @brief Splits single entry string into key and value pair.
  *
@@ -79,33 +168,71 @@ static std::pair<std::string, std::string>
 splitRecord(const std::string &s)
 {
     const std::pair<std::string, std::string> p = splitAt(s, '=');
-    return { p.first, decode(p.second) };
+    const std::string &val = p.second;
+    return { p.first, decode(val.data(), val.data() + val.size()) };
 }
 
 /**
  * @brief Decodes value restoring its original content.
  *
- * @param str Encoded data.
+ * Values without escape sequences are copied as is.
+ *
+ * @param from Beginning of encoded data.
+ * @param to End of encoded data.
  *
  * @returns Decoded data.
  */
 static std::string
-decode(std::string str)
+decode(const char *from, const char *to)
 {
-    boost::replace_all(str, R"(\n)", "\n");
-    boost::replace_all(str, R"(\\)", R"(\)");
+    const char *bs = static_cast<const char *>(std::memchr(from, '\\',
+                                                           to - from));
+    if (bs == nullptr) {
+        return std::string(from, to);
+    }
+
+    std::string str;
+    str.reserve(to - from);
+    while (bs != nullptr) {
+        str.append(from, bs);
+
+        if (bs + 1 == to) {
+            from = bs;
+            break;
+        }
+
+        switch (bs[1]) {
+            case 'n':  str += '\n'; break;
+            case '\\': str += '\\'; break;
+            default:   str.append(bs, 2); break;
+        }
+
+        from = bs + 2;
+        bs = static_cast<const char *>(std::memchr(from, '\\', to - from));
+    }
+    str.append(from, to);
     return str;
 }
 
 std::ostream &
 operator<<(std::ostream &s, const std::vector<Change> &changes)
 {
-    if (changes.empty()) {
+    return writeChanges(s, changes, 0U);
+}
+
+std::ostream &
+writeChanges(std::ostream &s, const std::vector<Change> &changes,
+             std::size_t from)
+{
+    if (from >= changes.size()) {
         return s;
     }
 
-    std::time_t timestamp = changes.front().getTimestamp() + 1;
-    for (const Change &c : changes) {
+    std::time_t timestamp = (from == 0U)
+                          ? changes.front().getTimestamp() + 1
+                          : changes[from - 1U].getTimestamp();
+    for (std::size_t i = from; i < changes.size(); ++i) {
+        const Change &c = changes[i];
         const std::time_t ts = c.getTimestamp();
         if (ts != timestamp) {
             s << ts << '\n';
@@ -118,6 +245,120 @@ operator<<(std::ostream &s, const std::vector<Change> &changes)
     return s;
 }
 
+bool
+isBinaryChanges(const char data[], std::size_t size)
+{
+    return size >= sizeof(binaryMagic)
+        && std::memcmp(data, binaryMagic, sizeof(binaryMagic)) == 0;
+}
+
+void
+parseBinaryChanges(const char data[], std::size_t size, const KeyTable &keys,
+                   std::vector<Change> &changes)
+{
+    if (!isBinaryChanges(data, size)) {
+        throw std::runtime_error("Not a binary change set");
+    }
+    if (size == sizeof(binaryMagic) ||
+        data[sizeof(binaryMagic)] != binaryVersion) {
+        throw std::runtime_error("Unsupported binary change set version");
+    }
+
+    const char *p = data + sizeof(binaryMagic) + 1;
+    const char *const end = data + size;
+
+    std::int64_t timestamp = 0;
+    while (p != end) {
+        std::uint64_t delta, keyId, length;
+        if (!readVarint(p, end, delta) || !readVarint(p, end, keyId) ||
+            !readVarint(p, end, length) ||
+            length > static_cast<std::uint64_t>(end - p)) {
+            // Unfinished entry left by an interrupted write.
+            break;
+        }
+
+        // Deltas are zigzag-encoded to allow for clock going backward.
+        timestamp += static_cast<std::int64_t>(delta >> 1) ^
+                     -static_cast<std::int64_t>(delta & 1U);
+        changes.emplace_back(timestamp, keys.getKey(keyId),
+                             std::string(p, length));
+        p += length;
+    }
+}
+
+std::ostream &
+writeBinaryChanges(std::ostream &s, const std::vector<Change> &changes,
+                   std::size_t from, KeyTable &keys)
+{
+    std::string buf;
+    if (from == 0U) {
+        buf.append(binaryMagic, sizeof(binaryMagic));
+        buf += binaryVersion;
+    }
+
+    std::int64_t timestamp = (from == 0U || from > changes.size())
+                           ? 0
+                           : changes[from - 1U].getTimestamp();
+    for (std::size_t i = from; i < changes.size(); ++i) {
+        const Change &c = changes[i];
+        const std::int64_t delta = c.getTimestamp() - timestamp;
+        timestamp = c.getTimestamp();
+
+        writeVarint(buf, (static_cast<std::uint64_t>(delta) << 1) ^
+                         static_cast<std::uint64_t>(delta >> 63));
+        writeVarint(buf, keys.getId(c.getKeyId()));
+        writeVarint(buf, c.getValue().size());
+        buf += c.getValue();
+    }
+
+    return s.write(buf.data(), buf.size());
+}
+
+/**
+ * @brief Reads unsigned LEB128 integer.
+ *
+ * @param p Current position, advanced past the integer on success.
+ * @param end End of the data.
+ * @param[out] value Read value.
+ *
+ * @returns @c true on success, @c false on truncated or too long integer.
+ */
+static bool
+readVarint(const char *&p, const char *end, std::uint64_t &value)
+{
+    value = 0U;
+    for (const char *c = p; c != end; ++c) {
+        const unsigned int shift = 7U*(c - p);
+        if (shift > 63U) {
+            return false;
+        }
+
+        const unsigned char byte = *c;
+        value |= static_cast<std::uint64_t>(byte & 0x7fU) << shift;
+        if ((byte & 0x80U) == 0U) {
+            p = c + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Appends unsigned LEB128 integer to a buffer.
+ *
+ * @param buf Buffer to append to.
+ * @param value Value to append.
+ */
+static void
+writeVarint(std::string &buf, std::uint64_t value)
+{
+    while (value >= 0x80U) {
+        buf += static_cast<char>((value & 0x7fU) | 0x80U);
+        value >>= 7;
+    }
+    buf += static_cast<char>(value);
+}
+
 /**
  * @brief Encodes value to make it single-line string.
  *
@@ -126,9 +367,269 @@ operator<<(std::ostream &s, const std::vector<Change> &changes)
  * @returns Encoded data.
  */
 static std::string
-encode(std::string str)
+encode(const std::string &str)
 {
-    boost::replace_all(str, R"(\)", R"(\\)");
-    boost::replace_all(str, "\n", R"(\n)");
-    return str;
+    std::string::size_type pos = str.find_first_of("\\\n");
+    if (pos == std::string::npos) {
+        return str;
+    }
+
+    std::string encoded(str, 0U, pos);
+    encoded.reserve(str.size() + 16U);
+    for (; pos < str.size(); ++pos) {
+        switch (str[pos]) {
+            case '\\': encoded += R"(\\)"; break;
+            case '\n': encoded += R"(\n)"; break;
+            default:   encoded += str[pos]; break;
+        }
+    }
+    return encoded;
+}
+
+std::size_t
+readValues(std::istream &s,
+           std::map<std::string, std::map<std::string, std::string>> &values,
+           std::map<std::string, std::string> &stamps)
+{
+    std::size_t nRecords = 0U;
+    std::string id, stamp;
+    std::map<std::string, std::string> record;
+    for (const std::string &l : getLines(s)) {
+        if (l.empty()) {
+            if (id.empty()) {
+                throw std::runtime_error("Unexpected end of values record");
+            }
+            values[id] = std::move(record);
+            if (stamp.empty()) {
+                stamps.erase(id);
+            } else {
+                stamps[id] = std::move(stamp);
+            }
+            record.clear();
+            id.clear();
+            stamp.clear();
+            ++nRecords;
+            continue;
+        }
+
+        if (l[0] == '@') {
+            if (!id.empty()) {
+                throw std::runtime_error("Unterminated values record: " + id);
+            }
+            const std::string::size_type sep = l.find(' ');
+            id = l.substr(1U, sep == std::string::npos ? sep : sep - 1U);
+            if (id.empty()) {
+                throw std::runtime_error("Values record without id");
+            }
+            if (sep != std::string::npos) {
+                stamp = l.substr(sep + 1U);
+            }
+            continue;
+        }
+
+        if (id.empty()) {
+            throw std::runtime_error("Value outside of a record");
+        }
+        record.insert(splitRecord(l));
+    }
+
+    return nRecords;
+}
+
+std::ostream &
+writeValues(std::ostream &s, const std::string &id, const std::string &stamp,
+            const std::map<std::string, std::string> &values)
+{
+    s << '@' << id;
+    if (!stamp.empty()) {
+        s << ' ' << stamp;
+    }
+    s << '\n';
+    for (const auto &e : values) {
+        s << e.first << '=' << encode(e.second) << '\n';
+    }
+    return s << '\n';
+}
+
+std::istream &
+readIndex(std::istream &s, std::map<std::string, std::set<std::string>> &index)
+{
+    for (const std::string &l : getLines(s)) {
+        std::string ids, val;
+        std::tie(ids, val) = splitRecord(l);
+        if (ids.empty()) {
+            throw std::runtime_error("No ids in index entry: " + l);
+        }
+
+        std::set<std::string> &entry = index[val];
+        for (const std::string &id : split(ids, ',')) {
+            entry.insert(id);
+        }
+    }
+
+    return s;
+}
+
+std::ostream &
+writeIndex(std::ostream &s,
+           const std::map<std::string, std::set<std::string>> &index)
+{
+    for (const auto &e : index) {
+        const char *sep = "";
+        for (const std::string &id : e.second) {
+            s << sep << id;
+            sep = ",";
+        }
+        s << '=' << encode(e.first) << '\n';
+    }
+    return s;
+}
+
+std::size_t
+readTrigrams(std::istream &s,
+             std::map<std::string, std::set<std::string>> &items)
+{
+    std::size_t nRecords = 0U;
+    for (const std::string &l : getLines(s)) {
+        std::string id, trigrams;
+        std::tie(id, trigrams) = splitRecord(l);
+        if (id.empty() || trigrams.size() % 3U != 0U) {
+            throw std::runtime_error("Broken trigrams record: " + l);
+        }
+
+        ++nRecords;
+        if (trigrams.empty()) {
+            items.erase(id);
+            continue;
+        }
+
+        std::set<std::string> &entry = items[id];
+        entry.clear();
+        for (std::string::size_type i = 0U; i < trigrams.size(); i += 3U) {
+            entry.insert(trigrams.substr(i, 3U));
+        }
+    }
+    return nRecords;
+}
+
+std::ostream &
+writeTrigrams(std::ostream &s, const std::string &id,
+              const std::set<std::string> &trigrams)
+{
+    std::string joined;
+    joined.reserve(trigrams.size()*3U);
+    for (const std::string &trigram : trigrams) {
+        joined += trigram;
+    }
+    return s << id << '=' << encode(joined) << '\n';
+}
+
+std::vector<std::string>
+findTrigrams(std::istream &s, const std::vector<std::string> &trigrams)
+{
+    std::set<std::string> ids;
+    for (const std::string &l : getLines(s)) {
+        std::string id, joined;
+        std::tie(id, joined) = splitRecord(l);
+        if (id.empty() || joined.size() % 3U != 0U) {
+            throw std::runtime_error("Broken trigrams record: " + l);
+        }
+
+        // Trigrams of records are sorted, so both lists are walked only once.
+        std::string::size_type i = 0U;
+        auto it = trigrams.cbegin();
+        while (it != trigrams.cend() && i < joined.size()) {
+            const int cmp = joined.compare(i, 3U, *it);
+            if (cmp == 0) {
+                ++it;
+            } else if (cmp > 0) {
+                break;
+            }
+            i += 3U;
+        }
+
+        if (it == trigrams.cend() && !joined.empty()) {
+            ids.insert(std::move(id));
+        } else {
+            ids.erase(id);
+        }
+    }
+    return { ids.cbegin(), ids.cend() };
+}
+
+std::istream &
+readCompletions(std::istream &s, std::set<std::string> &ids,
+                std::map<std::string, std::map<std::string, int>> &counts)
+{
+    bool first = true;
+    for (const std::string &l : getLines(s)) {
+        if (first) {
+            if (!l.empty()) {
+                const std::vector<std::string> list = split(l, ',');
+                ids.insert(list.cbegin(), list.cend());
+            }
+            first = false;
+            continue;
+        }
+
+        const std::string::size_type sep = l.find(' ');
+        if (sep == 0U || sep == std::string::npos || sep > 9U ||
+            l.find_first_not_of("0123456789") != sep) {
+            throw std::runtime_error("Broken completion entry: " + l);
+        }
+
+        std::string key, val;
+        std::tie(key, val) = splitRecord(l.substr(sep + 1U));
+        if (key.empty() || val.empty()) {
+            throw std::runtime_error("Broken completion entry: " + l);
+        }
+        counts[key][std::move(val)] = std::stoi(l.substr(0U, sep));
+    }
+
+    return s;
+}
+
+std::ostream &
+writeCompletions(std::ostream &s, const std::set<std::string> &ids,
+                 const std::map<std::string, std::map<std::string, int>> &counts)
+{
+    const char *sep = "";
+    for (const std::string &id : ids) {
+        s << sep << id;
+        sep = ",";
+    }
+    s << '\n';
+
+    for (const auto &e : counts) {
+        for (const auto &value : e.second) {
+            s << value.second << ' ' << e.first << '=' << encode(value.first)
+              << '\n';
+        }
+    }
+    return s;
+}
+
+bool
+readExportedItem(std::istream &s,
+                 std::vector<std::pair<std::string, std::string>> &fields)
+{
+    fields.clear();
+
+    std::string field;
+    while (std::getline(s, field, '\0')) {
+        if (field.empty()) {
+            return true;
+        }
+
+        const std::string::size_type pos = field.find('=');
+        if (pos == 0U || pos == std::string::npos) {
+            throw std::runtime_error("Broken field of an item: " + field);
+        }
+        fields.emplace_back(field.substr(0U, pos), field.substr(pos + 1U));
+    }
+
+    if (!fields.empty()) {
+        throw std::runtime_error("Unterminated item");
+    }
+    return false;
 }
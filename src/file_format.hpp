@@ -17,10 +17,17 @@
 #ifndef DIT__FILE_FORMAT_HPP__
 #define DIT__FILE_FORMAT_HPP__
 
+#include <cstddef>
+
 #include <iosfwd>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
 #include <vector>
 
 class Change;
+class KeyTable;
 
 /**
  * @brief Converts text data read from @p s into set of changes.
@@ -34,6 +41,21 @@ class Change;
  */
 std::istream & operator>>(std::istream &s, std::vector<Change> &changes);
 
+/**
+ * @brief Converts text data in memory into set of changes.
+ *
+ * Does the same as operator>>, but in a single pass over the buffer and without
+ * intermediate copies of lines.
+ *
+ * @param data Beginning of the data.
+ * @param size Size of the data.
+ * @param changes Storage for parsed data.
+ *
+ * @throws std::runtime_error On broken textual representation.
+ */
+void parseChanges(const char data[], std::size_t size,
+                  std::vector<Change> &changes);
+
 /**
  * @brief Writes @p changes in the stream @p s in text form.
  *
@@ -44,4 +66,218 @@ std::istream & operator>>(std::istream &s, std::vector<Change> &changes);
  */
 std::ostream & operator<<(std::ostream &s, const std::vector<Change> &changes);
 
+/**
+ * @brief Writes tail of @p changes in the stream @p s in text form.
+ *
+ * The output is meant to be appended to representation of preceding changes,
+ * so timestamp is omitted if it matches timestamp of the previous change.
+ *
+ * @param s Output stream for the data.
+ * @param changes Changes to write.
+ * @param from Index of the first change to write.
+ *
+ * @returns @p s.
+ */
+std::ostream & writeChanges(std::ostream &s, const std::vector<Change> &changes,
+                            std::size_t from);
+
+/**
+ * @brief Checks whether data in memory is a change set in binary form.
+ *
+ * @param data Beginning of the data.
+ * @param size Size of the data.
+ *
+ * @returns @c true if so, @c false otherwise.
+ */
+bool isBinaryChanges(const char data[], std::size_t size);
+
+/**
+ * @brief Converts binary data in memory into set of changes.
+ *
+ * The data starts with a header and consists of entries, each of which holds
+ * difference with previous timestamp, key number and length of a value as
+ * variable-length integers followed by the value itself.  Incomplete last
+ * entry is ignored.
+ *
+ * @param data Beginning of the data.
+ * @param size Size of the data.
+ * @param keys Table that maps key numbers to keys.
+ * @param changes Storage for parsed data.
+ *
+ * @throws std::runtime_error On broken binary representation.
+ */
+void parseBinaryChanges(const char data[], std::size_t size,
+                        const KeyTable &keys, std::vector<Change> &changes);
+
+/**
+ * @brief Writes tail of @p changes in the stream @p s in binary form.
+ *
+ * The header is written only if @p from is zero, otherwise the output is meant
+ * to be appended to representation of preceding changes.
+ *
+ * @param s Output stream for the data.
+ * @param changes Changes to write.
+ * @param from Index of the first change to write.
+ * @param keys Table that maps keys to their numbers.
+ *
+ * @returns @p s.
+ *
+ * @throws std::runtime_error On failure to update @p keys.
+ */
+std::ostream & writeBinaryChanges(std::ostream &s,
+                                  const std::vector<Change> &changes,
+                                  std::size_t from, KeyTable &keys);
+
+/**
+ * @brief Reads records of current values of items from @p s.
+ *
+ * Later records of an item replace earlier ones.  Unterminated trailing record
+ * is ignored.  Records without a stamp get no entry in @p stamps.
+ *
+ * @param s Stream to read data from.
+ * @param values Storage for read data (id -> key -> value).
+ * @param stamps Storage for stamps of stored data of items (id -> stamp).
+ *
+ * @returns Number of read records.
+ *
+ * @throws std::runtime_error On broken textual representation.
+ */
+std::size_t readValues(std::istream &s,
+                       std::map<std::string,
+                                std::map<std::string, std::string>> &values,
+                       std::map<std::string, std::string> &stamps);
+
+/**
+ * @brief Writes record of current values of an item in the stream @p s.
+ *
+ * @param s Output stream for the data.
+ * @param id Id of the item.
+ * @param stamp Stamp of stored data of the item, can't contain spaces.
+ * @param values Values of the item (key -> value).
+ *
+ * @returns @p s.
+ */
+std::ostream & writeValues(std::ostream &s, const std::string &id,
+                           const std::string &stamp,
+                           const std::map<std::string, std::string> &values);
+
+/**
+ * @brief Reads index of values of a key from @p s.
+ *
+ * @param s Stream to read data from.
+ * @param index Storage for read data (value -> ids).
+ *
+ * @returns @p s.
+ *
+ * @throws std::runtime_error On broken textual representation.
+ */
+std::istream & readIndex(std::istream &s,
+                         std::map<std::string, std::set<std::string>> &index);
+
+/**
+ * @brief Writes index of values of a key in the stream @p s.
+ *
+ * @param s Output stream for the data.
+ * @param index Index to write (value -> ids).
+ *
+ * @returns @p s.
+ */
+std::ostream & writeIndex(std::ostream &s,
+                          const std::map<std::string,
+                                         std::set<std::string>> &index);
+
+/**
+ * @brief Reads records of trigrams of items from @p s.
+ *
+ * Later records of an item replace earlier ones, a record without trigrams
+ * removes the item.
+ *
+ * @param s Stream to read data from.
+ * @param items Storage for read data (id -> trigrams).
+ *
+ * @returns Number of read records.
+ *
+ * @throws std::runtime_error On broken textual representation.
+ */
+std::size_t readTrigrams(std::istream &s,
+                         std::map<std::string, std::set<std::string>> &items);
+
+/**
+ * @brief Writes record of trigrams of an item in the stream @p s.
+ *
+ * @param s Output stream for the data.
+ * @param id Id of the item.
+ * @param trigrams Trigrams of the item, empty set marks removed item.
+ *
+ * @returns @p s.
+ */
+std::ostream & writeTrigrams(std::ostream &s, const std::string &id,
+                             const std::set<std::string> &trigrams);
+
+/**
+ * @brief Finds items whose records of trigrams in @p s have all the trigrams.
+ *
+ * Records are checked as they are read, so trigrams of items aren't kept in
+ * memory.  Later records of an item replace earlier ones.
+ *
+ * @param s Stream to read data from.
+ * @param trigrams Sorted trigrams to look for.
+ *
+ * @returns Sorted ids of the items.
+ *
+ * @throws std::runtime_error On broken textual representation.
+ */
+std::vector<std::string> findTrigrams(std::istream &s,
+                                      const std::vector<std::string> &trigrams);
+
+/**
+ * @brief Reads data for completion from @p s.
+ *
+ * The first line lists comma-separated ids, the rest are keys and their values
+ * prefixed with number of items that have them.
+ *
+ * @param s Stream to read data from.
+ * @param ids Storage for read ids.
+ * @param counts Storage for read values (key -> value -> number of items).
+ *
+ * @returns @p s.
+ *
+ * @throws std::runtime_error On broken textual representation.
+ */
+std::istream & readCompletions(std::istream &s, std::set<std::string> &ids,
+                               std::map<std::string,
+                                        std::map<std::string, int>> &counts);
+
+/**
+ * @brief Writes data for completion in the stream @p s.
+ *
+ * @param s Output stream for the data.
+ * @param ids Ids of items.
+ * @param counts Values of keys (key -> value -> number of items).
+ *
+ * @returns @p s.
+ */
+std::ostream & writeCompletions(std::ostream &s,
+                                const std::set<std::string> &ids,
+                                const std::map<std::string,
+                                               std::map<std::string,
+                                                        int>> &counts);
+
+/**
+ * @brief Reads next item in the form produced by "export -" from @p s.
+ *
+ * Each field is a key=value pair terminated by null character, the item is
+ * terminated by an empty field.  Only data of one item is consumed.
+ *
+ * @param s Stream to read data from.
+ * @param fields Storage for fields of the item in order of their appearance.
+ *
+ * @returns @c false if there are no more items, @c true otherwise.
+ *
+ * @throws std::runtime_error On broken or unterminated item.
+ */
+bool readExportedItem(std::istream &s,
+                      std::vector<std::pair<std::string,
+                                            std::string>> &fields);
+
 #endif // DIT__FILE_FORMAT_HPP__
@@ -22,7 +22,11 @@
 #include <termios.h>
 #include <unistd.h>
 
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
 #include <cstdio>
+#include <cstring>
 
 #include <fstream>
 #include <iostream>
@@ -33,7 +37,6 @@
 #include <utility>
 
 #include <boost/algorithm/string/trim.hpp>
-#include <boost/iostreams/device/file_descriptor.hpp>
 #include <boost/iostreams/stream_buffer.hpp>
 #include <boost/optional.hpp>
 #include <boost/scope_exit.hpp>
@@ -43,6 +46,9 @@
 
 namespace io = boost::iostreams;
 
+//! Whether reader of the output has quit before reaching its end.
+static bool consumerGone;
+
 static std::pair<unsigned int, unsigned int> getTerminalSize();
 static void writeBufferFile(const std::string &path, const std::string &key,
                             const std::string &current);
@@ -59,6 +65,52 @@ public:
     virtual ~Impl() = default;
 };
 
+/**
+ * @brief Turns SIGPIPE into @c EPIPE error of writes within a scope.
+ *
+ * Unlike ignoring the signal, this doesn't affect processes we start.
+ */
+class SigPipeGuard
+{
+public:
+    /**
+     * @brief Blocks the signal.
+     */
+    SigPipeGuard()
+    {
+        sigemptyset(&pipeSet);
+        sigaddset(&pipeSet, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipeSet, &prevMask);
+    }
+
+    //! No copy-constructor.
+    SigPipeGuard(const SigPipeGuard &rhs) = delete;
+    //! No copy-assignment.
+    SigPipeGuard & operator=(const SigPipeGuard &rhs) = delete;
+
+    /**
+     * @brief Discards signal raised by failed writes and unblocks it.
+     */
+    ~SigPipeGuard()
+    {
+        const int savedErrno = errno;
+        sigset_t pending;
+        if (!sigismember(&prevMask, SIGPIPE) && sigpending(&pending) == 0 &&
+            sigismember(&pending, SIGPIPE)) {
+            int sig;
+            sigwait(&pipeSet, &sig);
+        }
+        pthread_sigmask(SIG_SETMASK, &prevMask, nullptr);
+        errno = savedErrno;
+    }
+
+private:
+    //! Set that consists of SIGPIPE.
+    sigset_t pipeSet;
+    //! Signal mask to restore.
+    sigset_t prevMask;
+};
+
 /**
  * @brief Redirects standard output into a pager.
  *
@@ -90,11 +142,9 @@ public:
          *
          * @param pagerCmd Command to invoke a pager.
          * @param screenHeight Height of terminal in lines.
-         * @param out Storage for output stream buffer backed up by a file.
          */
         ScreenPageBuffer(const std::string &pagerCmd,
-                         unsigned int screenHeight,
-                         io::stream_buffer<io::file_descriptor_sink> *out);
+                         unsigned int screenHeight);
         /**
          * @brief Dumps output onto the screen or waits for pager to finish.
          */
@@ -112,18 +162,19 @@ public:
         std::streamsize write(const char s[], std::streamsize n);
 
     private:
-        /**
-         * @brief Writes single character.
-         *
-         * @param c Character to write.
-         *
-         * @returns @c true on success, @c false otherwise.
-         */
-        bool put(char c);
         /**
          * @brief Opens pager for output.
          */
         void openPager();
+        /**
+         * @brief Writes data to the pager as is.
+         *
+         * Output is dropped once pager has quit.
+         *
+         * @param s Character buffer.
+         * @param n Size of the buffer.
+         */
+        void writeToPager(const char s[], std::size_t n);
 
     private:
         //! Whether redirection into pager is enabled.
@@ -138,13 +189,8 @@ public:
         std::string buffer;
         //! Process id of a pager.
         pid_t pid;
-
-        /**
-         * @brief Pointer to buffer stored in RedirectToPager.
-         *
-         * This is not by value, because ScreenPageBuffer needs to be copyable.
-         */
-        io::stream_buffer<io::file_descriptor_sink> *out;
+        //! Write end of a pipe connected to the pager.
+        int pipeFd = -1;
     };
 
 public:
@@ -154,7 +200,7 @@ public:
      * @param pagerCmd Command to invoke a pager.
      */
     PagerRedirect(const std::string &pagerCmd)
-        : screenPageBuffer(pagerCmd, getTerminalSize().second, &out)
+        : screenPageBuffer(pagerCmd, getTerminalSize().second)
     {
         rdbuf = std::cout.rdbuf(&screenPageBuffer);
     }
@@ -172,27 +218,118 @@ public:
     }
 
 private:
-    //! This is stored for ScreenPageBuffer class.
-    io::stream_buffer<io::file_descriptor_sink> out;
     //! Custom buffer implementation.
     io::stream_buffer<ScreenPageBuffer> screenPageBuffer;
     //! Original buffer of @c std::cout.
     std::streambuf *rdbuf;
 };
 
+/**
+ * @brief Collects standard output in a large buffer that is flushed explicitly.
+ *
+ * Used when output isn't a terminal and thus doesn't need to appear right away,
+ * which reduces number of system calls for large outputs.  The buffer is also
+ * flushed before anything is written to standard error.
+ */
+class BufferedOutput : public RedirectToPager::Impl
+{
+    /**
+     * @brief Sink that passes data to original buffer of @c std::cout.
+     */
+    class Sink
+    {
+    public:
+        //! Type of character used by this sink.
+        using char_type = char;
+        //! Category of functionality provided by this sink implementation.
+        using category = boost::iostreams::sink_tag;
+
+    public:
+        /**
+         * @brief Constructs the sink.
+         *
+         * @param to Buffer to pass data to.
+         */
+        explicit Sink(std::streambuf *to) : to(to)
+        {
+        }
+
+    public:
+        /**
+         * @brief Writes @p n characters from @p s and flushes them.
+         *
+         * Original buffer is flushed to not write anything outside of
+         * SigPipeGuard.
+         *
+         * @param s Character buffer.
+         * @param n Size of the buffer.
+         *
+         * @returns @p n.
+         */
+        std::streamsize write(const char s[], std::streamsize n)
+        {
+            SigPipeGuard sigPipeGuard;
+
+            // Output is dropped once reader has quit.
+            if (!consumerGone && (to->sputn(s, n) != n ||
+                                  to->pubsync() != 0)) {
+                consumerGone = true;
+            }
+            return n;
+        }
+
+    private:
+        //! Buffer to pass data to.
+        std::streambuf *to;
+    };
+
+public:
+    /**
+     * @brief Replaces buffer of @c std::cout with a large one.
+     */
+    BufferedOutput()
+        : rdbuf(std::cout.rdbuf()), out(Sink(rdbuf), bufferSize)
+    {
+        std::cout.rdbuf(&out);
+
+        // Errors must not overtake output that precedes them.
+        prevTie = std::cerr.tie(&std::cout);
+    }
+
+    /**
+     * @brief Flushes output and restores original buffer of @c std::cout.
+     */
+    ~BufferedOutput()
+    {
+        std::cout.flush();
+        std::cout.rdbuf(rdbuf);
+        std::cerr.tie(prevTie);
+    }
+
+private:
+    //! Size of the buffer.
+    static constexpr std::streamsize bufferSize = 256*1024;
+
+    //! Original buffer of @c std::cout.
+    std::streambuf *rdbuf;
+    //! Buffer that collects output.
+    io::stream_buffer<Sink> out;
+    //! Stream that was flushed before writing to @c std::cerr.
+    std::ostream *prevTie;
+};
+
 using ScreenPageBuffer = PagerRedirect::ScreenPageBuffer;
 
 ScreenPageBuffer::ScreenPageBuffer(const std::string &pagerCmd,
-                                   unsigned int screenHeight,
-                               io::stream_buffer<io::file_descriptor_sink> *out)
-    : pagerCmd(pagerCmd), screenHeight(screenHeight - 1U), out(out)
+                                   unsigned int screenHeight)
+    : pagerCmd(pagerCmd), screenHeight(screenHeight - 1U)
 {
 }
 
 ScreenPageBuffer::~ScreenPageBuffer()
 {
     if (redirectToPager) {
-        out->close();
+        close(pipeFd);
         int wstatus;
         waitpid(pid, &wstatus, 0);
     } else {
@@ -202,39 +339,30 @@ ScreenPageBuffer::~ScreenPageBuffer()
 
 std::streamsize
 ScreenPageBuffer::write(const char s[], std::streamsize n)
-{
-    for (std::streamsize i = 0U; i < n; ++i) {
-        if (!put(s[i])) {
-            return i;
-        }
-    }
-    return n;
-}
-
-bool
-ScreenPageBuffer::put(char c)
 {
     if (redirectToPager) {
-        return boost::iostreams::put(*out, c);
+        writeToPager(s, n);
+        return n;
     }
 
-    if (c == '\n') {
-        ++nLines;
-    }
+    const char *const end = s + n;
+    for (const char *p = s;
+         (p = static_cast<const char *>(std::memchr(p, '\n', end - p)));
+         ++p) {
+        if (++nLines > screenHeight) {
+            openPager();
+            redirectToPager = true;
 
-    if (nLines > screenHeight) {
-        openPager();
-        redirectToPager = true;
-        for (char c : buffer) {
-            if (!boost::iostreams::put(*out, c)) {
-                return false;
-            }
+            writeToPager(buffer.data(), buffer.size());
+            std::string().swap(buffer);
+
+            writeToPager(s, n);
+            return n;
         }
-        return boost::iostreams::put(*out, c);
     }
 
-    buffer.push_back(c);
-    return true;
+    buffer.append(s, n);
+    return n;
 }
 
 void
@@ -262,18 +390,45 @@ ScreenPageBuffer::openPager()
         _Exit(127);
     }
 
-    out->open(io::file_descriptor_sink(pipePair[1],
-                                       boost::iostreams::close_handle));
+    pipeFd = pipePair[1];
+}
+
+void
+ScreenPageBuffer::writeToPager(const char s[], std::size_t n)
+{
+    // Quitting pager early shouldn't kill us, handle EPIPE instead.
+    SigPipeGuard sigPipeGuard;
+
+    while (n != 0U && !consumerGone) {
+        const ssize_t written = ::write(pipeFd, s, n);
+        if (written == -1) {
+            if (errno != EINTR) {
+                consumerGone = true;
+            }
+            continue;
+        }
+        s += written;
+        n -= written;
+    }
 }
 
 RedirectToPager::RedirectToPager(const std::string &pagerCmd)
-    : impl(isOutputToTerminal() ? make_unique<PagerRedirect>(pagerCmd)
-                                : nullptr)
 {
+    if (isOutputToTerminal()) {
+        impl = make_unique<PagerRedirect>(pagerCmd);
+    } else {
+        impl = make_unique<BufferedOutput>();
+    }
 }
 
 RedirectToPager::~RedirectToPager() = default;
 
+bool
+RedirectToPager::isConsumerGone()
+{
+    return consumerGone;
+}
+
 /**
  * @brief Retrieves terminal width and height in characters.
  *
@@ -344,6 +499,9 @@ editBufferFile(const std::string &path)
 {
     // TODO: maybe check for empty file and treat it as an error.
 
+    // Editor can share output with us.
+    std::cout.flush();
+
     const char *editorVar = std::getenv("EDITOR");
     std::string editor = (editorVar == NULL) ? "vim" : editorVar;
 
@@ -26,7 +26,8 @@
  * @brief A class that automatically spawns pager if output is large.
  *
  * Output must come to @c std::cout and is considered to be large when it
- * doesn't fit screen height.
+ * doesn't fit screen height.  When output isn't a terminal, it's collected in a
+ * large buffer instead, which is flushed on destruction.
  */
 class RedirectToPager
 {
@@ -50,6 +51,17 @@ public:
      */
     ~RedirectToPager();
 
+public:
+    /**
+     * @brief Checks whether reader of the output has quit.
+     *
+     * This happens when user closes pager before reaching end of the output,
+     * so there is no point in producing the rest of it.
+     *
+     * @returns @c true if so, otherwise @c false.
+     */
+    static bool isConsumerGone();
+
 private:
     //! Implementation details.
     std::unique_ptr<Impl> impl;
@@ -18,15 +18,21 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
+#include "Daemon.hpp"
 #include "Dit.hpp"
 
 int
 main(int argc, char *argv[])
 {
     try {
-        return Dit({ argv, argv + argc }).run();
+        const std::vector<std::string> args(argv, argv + argc);
+        if (boost::optional<int> exitCode = Daemon::forward(args)) {
+            return *exitCode;
+        }
+        return Dit(args).run();
     } catch (std::exception &e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return EXIT_FAILURE;
@@ -17,8 +17,14 @@
 #ifndef DIT__UTILS__FS_HPP__
 #define DIT__UTILS__FS_HPP__
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
 #include <cstdlib>
 
+#include <stdexcept>
 #include <string>
 
 #include <boost/filesystem/operations.hpp>
@@ -72,4 +78,77 @@ private:
     std::string path;
 };
 
+/**
+ * @brief Writes whole string into a file descriptor.
+ *
+ * @param fd The file descriptor.
+ * @param data Data to write.
+ *
+ * @returns @c true on success, @c false otherwise.
+ */
+inline bool
+writeFully(int fd, const std::string &data)
+{
+    const char *s = data.data();
+    std::size_t n = data.size();
+    while (n != 0U) {
+        const ssize_t written = ::write(fd, s, n);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        s += written;
+        n -= written;
+    }
+    return true;
+}
+
+/**
+ * @brief Makes contents of a file or a directory durable.
+ *
+ * @param path Path to the file or directory.
+ *
+ * @throws std::runtime_error On failure.
+ */
+inline void
+syncPath(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    const bool synced = (::fsync(fd) == 0);
+    ::close(fd);
+    if (!synced) {
+        throw std::runtime_error("Failed to sync " + path);
+    }
+}
+
+/**
+ * @brief Makes all data of a file system durable.
+ *
+ * Unlike @c sync() this doesn't flush other file systems.
+ *
+ * @param path Path to any file or directory of the file system.
+ *
+ * @throws std::runtime_error On failure.
+ */
+inline void
+syncFileSystem(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    const bool synced = (::syncfs(fd) == 0);
+    ::close(fd);
+    if (!synced) {
+        throw std::runtime_error("Failed to sync " + path);
+    }
+}
+
 #endif // DIT__UTILS__FS_HPP__
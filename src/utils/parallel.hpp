@@ -0,0 +1,92 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DIT__UTILS__PARALLEL_HPP__
+#define DIT__UTILS__PARALLEL_HPP__
+
+#include <cstddef>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Calls @p f for every index in [0; @p n) using a pool of threads.
+ *
+ * Pool is sized after number of hardware threads.  Calls for different indexes
+ * can happen concurrently and in any order.  The first exception thrown by
+ * @p f is rethrown after all threads are done.
+ *
+ * @tparam F Type of the function.
+ * @param n Number of indexes.
+ * @param f Function that accepts an index.
+ */
+template <typename F>
+void
+parallelFor(std::size_t n, F f)
+{
+    const std::size_t nThreads =
+        std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1U),
+                              n);
+    if (nThreads <= 1U) {
+        for (std::size_t i = 0U; i < n; ++i) {
+            f(i);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> next(0U);
+    std::vector<std::exception_ptr> errors(nThreads);
+
+    auto worker = [&](std::size_t thread) {
+        try {
+            for (std::size_t i = next++; i < n; i = next++) {
+                f(i);
+            }
+        } catch (...) {
+            errors[thread] = std::current_exception();
+            // Make other threads stop early.
+            next = n;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads - 1U);
+    for (std::size_t i = 1U; i < nThreads; ++i) {
+        try {
+            threads.emplace_back(worker, i);
+        } catch (const std::system_error &) {
+            // Do with fewer threads.
+            break;
+        }
+    }
+    worker(0U);
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (const std::exception_ptr &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+#endif // DIT__UTILS__PARALLEL_HPP__
@@ -0,0 +1,60 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Catch/catch.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Change.hpp"
+
+TEST_CASE("Equal key names are interned once", "[change]")
+{
+    const Change a(1, "interned-key", "a");
+    const Change b(2, std::string("interned-") + "key", "b");
+
+    REQUIRE(a.getKeyId() == b.getKeyId());
+    REQUIRE(&a.getKey() == &b.getKey());
+    REQUIRE(Change::findKey("interned-key") == a.getKeyId());
+    REQUIRE(Change(3, "other-key", "c").getKeyId() != a.getKeyId());
+}
+
+TEST_CASE("Unknown key names aren't registered on lookup", "[change]")
+{
+    REQUIRE(Change::findKey("never-used-key") == nullptr);
+    REQUIRE(Change::findKey("never-used-key") == nullptr);
+}
+
+TEST_CASE("Key names interned by different threads match", "[change]")
+{
+    std::vector<Change::KeyId> ids(4U);
+    std::vector<std::thread> threads;
+    for (Change::KeyId &id : ids) {
+        threads.emplace_back([&id]() {
+            for (int i = 0; i < 100; ++i) {
+                id = Change(i, "threaded-key", "value").getKeyId();
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (Change::KeyId id : ids) {
+        REQUIRE(id == Change::internKey("threaded-key"));
+    }
+}
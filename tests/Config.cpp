@@ -16,10 +16,13 @@
 
 #include "Catch/catch.hpp"
 
+#include <boost/filesystem/operations.hpp>
 #include <boost/property_tree/info_parser.hpp>
 
 #include "Config.hpp"
 
+namespace fs = boost::filesystem;
+
 TEST_CASE("Absent values are taken from parent", "[config][parent-child]")
 {
     Config parent("parent");
@@ -95,3 +98,38 @@ TEST_CASE("Loading file of wrong format throws exception", "[config]")
     REQUIRE_THROWS_AS(child.get("key", "v") == "value",
                       const pt::info_parser_error &);
 }
+
+TEST_CASE("Saving through symbolic link keeps the link", "[config]")
+{
+    const std::string target = "tests/data/config-target";
+    const std::string link = "tests/data/config-link";
+
+    try {
+
+        fs::create_symlink("config-target", link);
+
+        {
+            Config config(link);
+            config.set("key", "first");
+            config.save();
+        }
+        REQUIRE(fs::is_symlink(link));
+        REQUIRE(Config(target).get("key") == "first");
+
+        {
+            Config config(link);
+            config.set("key", "second");
+            config.save();
+        }
+        REQUIRE(fs::is_symlink(link));
+        REQUIRE(Config(target).get("key") == "second");
+
+    } catch (...) {
+        fs::remove(link);
+        fs::remove(target);
+        throw;
+    }
+
+    fs::remove(link);
+    fs::remove(target);
+}
@@ -0,0 +1,215 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Catch/catch.hpp"
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <cstdlib>
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/scope_exit.hpp>
+
+#include "Daemon.hpp"
+
+namespace fs = boost::filesystem;
+
+static std::string runWithOutputTo(const std::string &path,
+                                   boost::optional<int> &exitCode);
+
+TEST_CASE("Invocation is handled locally without daemon", "[daemon]")
+{
+    const char *const runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    const std::string prevRuntimeDir = (runtimeDir == nullptr ? "" : runtimeDir);
+    BOOST_SCOPE_EXIT_ALL(&prevRuntimeDir) {
+        setenv("XDG_RUNTIME_DIR", prevRuntimeDir.c_str(), 1);
+    };
+
+    setenv("XDG_RUNTIME_DIR", "tests/data", 1);
+    REQUIRE(!Daemon::forward({ "dit", "--version" }));
+
+    unsetenv("XDG_RUNTIME_DIR");
+    REQUIRE(!Daemon::forward({ "dit", "--version" }));
+    REQUIRE_THROWS_AS(Daemon(), const std::runtime_error &);
+}
+
+TEST_CASE("Daemon serves invocations", "[daemon]")
+{
+    const char *const runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    const std::string prevRuntimeDir = (runtimeDir == nullptr ? "" : runtimeDir);
+    BOOST_SCOPE_EXIT_ALL(&prevRuntimeDir) {
+        setenv("XDG_RUNTIME_DIR", prevRuntimeDir.c_str(), 1);
+        fs::remove_all("tests/data/run");
+    };
+
+    fs::create_directories("tests/data/run");
+    setenv("XDG_RUNTIME_DIR", "tests/data/run", 1);
+
+    const pid_t pid = fork();
+    REQUIRE(pid != -1);
+    if (pid == 0) {
+        try {
+            Daemon().serve();
+        } catch (...) {
+            _Exit(EXIT_FAILURE);
+        }
+        _Exit(EXIT_SUCCESS);
+    }
+
+    for (int i = 0; i < 500 && !fs::exists(Daemon::getSocketPath()); ++i) {
+        usleep(10*1000);
+    }
+
+    REQUIRE_THROWS_AS(Daemon(), const std::runtime_error &);
+
+    boost::optional<int> exitCode;
+    const std::string out = runWithOutputTo("tests/data/run/out", exitCode);
+
+    kill(pid, SIGTERM);
+    int wstatus;
+    REQUIRE(waitpid(pid, &wstatus, 0) == pid);
+    REQUIRE(WIFEXITED(wstatus));
+    REQUIRE(WEXITSTATUS(wstatus) == EXIT_SUCCESS);
+    REQUIRE(!fs::exists(Daemon::getSocketPath()));
+
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_SUCCESS);
+    REQUIRE(out == "0.11\n");
+}
+
+TEST_CASE("Daemon serves invocations concurrently", "[daemon]")
+{
+    const char *const runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    const std::string prevRuntimeDir = (runtimeDir == nullptr ? "" : runtimeDir);
+    const char *const configHome = std::getenv("XDG_CONFIG_HOME");
+    const std::string prevConfigHome = (configHome == nullptr ? "" : configHome);
+    BOOST_SCOPE_EXIT_ALL(&prevRuntimeDir, &prevConfigHome) {
+        setenv("XDG_RUNTIME_DIR", prevRuntimeDir.c_str(), 1);
+        setenv("XDG_CONFIG_HOME", prevConfigHome.c_str(), 1);
+        fs::remove_all("tests/data/run");
+    };
+
+    fs::create_directories("tests/data/run");
+    setenv("XDG_RUNTIME_DIR", "tests/data/run", 1);
+    setenv("XDG_CONFIG_HOME", "tests/data", 1);
+
+    const pid_t pid = fork();
+    REQUIRE(pid != -1);
+    if (pid == 0) {
+        try {
+            Daemon().serve();
+        } catch (...) {
+            _Exit(EXIT_FAILURE);
+        }
+        _Exit(EXIT_SUCCESS);
+    }
+    BOOST_SCOPE_EXIT_ALL(pid) {
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+    };
+
+    for (int i = 0; i < 500 && !fs::exists(Daemon::getSocketPath()); ++i) {
+        usleep(10*1000);
+    }
+
+    // Batch keeps running until its input is closed.
+    int input[2];
+    REQUIRE(pipe(input) == 0);
+    const pid_t batch = fork();
+    REQUIRE(batch != -1);
+    if (batch == 0) {
+        close(input[1]);
+        dup2(input[0], STDIN_FILENO);
+        close(input[0]);
+        boost::optional<int> exitCode = Daemon::forward({ "dit", "batch" });
+        _Exit(exitCode ? *exitCode : 100);
+    }
+    close(input[0]);
+
+    const pid_t version = fork();
+    REQUIRE(version != -1);
+    if (version == 0) {
+        boost::optional<int> exitCode;
+        const std::string out = runWithOutputTo("tests/data/run/out",
+                                                exitCode);
+        _Exit(exitCode && *exitCode == EXIT_SUCCESS && out == "0.11\n"
+              ? EXIT_SUCCESS
+              : EXIT_FAILURE);
+    }
+
+    // Second invocation must finish while the first one waits for input.
+    int wstatus = 0;
+    pid_t waited = 0;
+    for (int i = 0; i < 500 && waited == 0; ++i) {
+        waited = waitpid(version, &wstatus, WNOHANG);
+        if (waited == 0) {
+            usleep(10*1000);
+        }
+    }
+    if (waited == 0) {
+        kill(version, SIGKILL);
+        waitpid(version, nullptr, 0);
+    }
+
+    close(input[1]);
+    int batchStatus;
+    REQUIRE(waitpid(batch, &batchStatus, 0) == batch);
+
+    REQUIRE(waited == version);
+    REQUIRE(WIFEXITED(wstatus));
+    REQUIRE(WEXITSTATUS(wstatus) == EXIT_SUCCESS);
+
+    REQUIRE(WIFEXITED(batchStatus));
+    REQUIRE(WEXITSTATUS(batchStatus) == EXIT_SUCCESS);
+}
+
+/**
+ * @brief Forwards version query with standard output redirected to a file.
+ *
+ * @param path Path to the file.
+ * @param exitCode Exit code of the invocation.
+ *
+ * @returns Contents of the file.
+ */
+static std::string
+runWithOutputTo(const std::string &path, boost::optional<int> &exitCode)
+{
+    std::cout.flush();
+
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    const int prevStdout = dup(STDOUT_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+
+    exitCode = Daemon::forward({ "dit", "--version" });
+
+    dup2(prevStdout, STDOUT_FILENO);
+    close(prevStdout);
+
+    std::ifstream file(path);
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+}
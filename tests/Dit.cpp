@@ -22,6 +22,7 @@
 #include <sstream>
 #include <stdexcept>
 
+#include <boost/filesystem/operations.hpp>
 #include <boost/scope_exit.hpp>
 
 #include "utils/memory.hpp"
@@ -307,6 +308,10 @@ TEST_CASE("Running commands", "[app]")
         REQUIRE(out.str() == expectedOut);
         REQUIRE(err.str() == std::string());
     }
+
+    // Commands above don't change anything and must leave test data intact.
+    REQUIRE(!boost::filesystem::exists("tests/data/dit/projects/tests/"
+                                       "completion"));
 }
 
 TEST_CASE("Completion of projects", "[app][completion]")
@@ -370,7 +375,9 @@ TEST_CASE("Completion of commands", "[app][completion]")
             "-v\n"
             "a__\n"
             "add\n"
+            "batch\n"
             "check\n"
+            "compact\n"
             "complete\n"
             "config\n";
         REQUIRE(out.str().substr(0, expectedOut.length()) == expectedOut);
@@ -389,7 +396,9 @@ TEST_CASE("Completion of commands", "[app][completion]")
             "--version\n"
             "-h\n"
             "-v\n"
+            "add.batch\n"
             "add.check\n"
+            "add.compact\n"
             "add.complete\n"
             "add.config\n";
         REQUIRE(out.str().substr(0, expectedOut.length()) == expectedOut);
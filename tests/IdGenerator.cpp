@@ -77,6 +77,26 @@ TEST_CASE("IDs can not be exhausted", "[ids]")
     REQUIRE(idGenerator.getId().length() == 4U);
 }
 
+TEST_CASE("IDs are taken in bulk", "[ids]")
+{
+    Config parent("parent");
+    Config child("child", &parent);
+
+    IdGenerator::init(parent, "1234567890");
+    IdGenerator idGenerator(child);
+    IdGenerator bulkGenerator(child);
+
+    std::vector<std::string> ids;
+    for (int i = 0; i < 150; ++i) {
+        ids.push_back(idGenerator.getId());
+        idGenerator.advanceId();
+    }
+
+    REQUIRE(bulkGenerator.takeIds(150) == ids);
+    REQUIRE(bulkGenerator.getId() == idGenerator.getId());
+    REQUIRE(bulkGenerator.size() == 150);
+}
+
 TEST_CASE("All IDs are distinct", "[ids]")
 {
     Config parent("parent");
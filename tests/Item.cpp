@@ -20,6 +20,7 @@
 
 #include <ctime>
 
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -171,6 +172,70 @@ TEST_CASE("Reverted change cancels out the wrong one", "[item]")
     REQUIRE(item.getChanges().size() == 1U);
 }
 
+TEST_CASE("Latest values are found after removal of changes", "[item]")
+{
+    Item item = Tests::makeItem("id");
+
+    {
+        MockTimeSource timeMock([](){ return 0; });
+        item.setValue("title", "old title");
+        item.setValue("status", "open");
+    }
+
+    item.setValue("title", "new title");
+    item.setValue("author", "me");
+    item.setValue("title", "old title");
+    item.setValue("status", "");
+
+    REQUIRE(item.getChanges().size() == 4U);
+    REQUIRE(item.getValue("title") == "old title");
+    REQUIRE(item.getValue("status") == "");
+    REQUIRE(item.getValue("author") == "me");
+    REQUIRE(item.listRecordNames() ==
+            std::set<std::string>({ "author", "title" }));
+}
+
+TEST_CASE("Latest values are found in loaded items", "[item][load]")
+{
+    std::time_t t = std::time(nullptr);
+    MockTimeSource timeMock([&t](){ return t++; });
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+        std::string id;
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Item &item = prj.getStorage().create();
+            item.setValue("a", "1");
+            item.setValue("b", "2");
+            item.setValue("a", "3");
+            item.setValue("b", "");
+            id = item.getId();
+            prj.save();
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Item &item = prj.getStorage().get(id);
+            REQUIRE(item.getValue("a") == "3");
+            REQUIRE(item.getValue("b") == "");
+            REQUIRE(item.listRecordNames() == std::set<std::string>({ "a" }));
+
+            item.setValue("c", "4");
+            REQUIRE(item.listRecordNames() ==
+                    std::set<std::string>({ "a", "c" }));
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
 TEST_CASE("Items with broken timestamps fail to load.", "[item][load]")
 {
     std::time_t t = std::time(nullptr);
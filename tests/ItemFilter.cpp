@@ -16,8 +16,10 @@
 
 #include "Catch/catch.hpp"
 
+#include <chrono>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "utils/strings.hpp"
 #include "Change.hpp"
@@ -55,3 +57,56 @@ TEST_CASE("_any pseudo field", "[item-filter]")
     ItemFilter filter({ "_any==title" });
     REQUIRE(filter.passes(item));
 }
+
+TEST_CASE("Substring search ignores case", "[item-filter]")
+{
+    Item item = Tests::makeItem("id");
+    item.setValue("title", "Crash On Start");
+
+    REQUIRE(ItemFilter({ "title/CRASH" }).passes(item));
+    REQUIRE(ItemFilter({ "title/on s" }).passes(item));
+    REQUIRE(ItemFilter({ "title/" }).passes(item));
+    REQUIRE(!ItemFilter({ "title!/crash" }).passes(item));
+    REQUIRE(!ItemFilter({ "title/crashes" }).passes(item));
+}
+
+TEST_CASE("All conditions on the same key must match", "[item-filter]")
+{
+    Item item = Tests::makeItem("id");
+    item.setValue("title", "title");
+    item.setValue("status", "open");
+
+    REQUIRE(ItemFilter({ "_any==title", "_any==open" }).passes(item));
+    REQUIRE(!ItemFilter({ "_any==title", "_any==closed" }).passes(item));
+    REQUIRE(ItemFilter({ "title/ti", "title/le" }).passes(item));
+    REQUIRE(!ItemFilter({ "title/ti", "title!/le" }).passes(item));
+}
+
+TEST_CASE("Filtering of 100k items", "[.benchmark][item-filter]")
+{
+    MockTimeSource timeMock([](){ return 0; });
+
+    std::vector<Item> items;
+    items.reserve(100000);
+    for (int i = 0; i < 100000; ++i) {
+        items.emplace_back(Tests::makeItem(std::to_string(i)));
+        Item &item = items.back();
+        item.setValue("title", "Title of item number " + std::to_string(i));
+        item.setValue("status", (i % 3 == 0) ? "open" : "closed");
+        item.setValue("comment", "Some longer text to search through");
+    }
+
+    ItemFilter filter({ "status==open", "title/NUMBER 1", "_any/text" });
+
+    const auto start = std::chrono::steady_clock::now();
+    int nPassed = 0;
+    for (Item &item : items) {
+        nPassed += filter.passes(item);
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    REQUIRE(nPassed == 3702);
+    WARN("Filtered in " <<
+         std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
+         .count() << " ms");
+}
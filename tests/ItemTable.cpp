@@ -26,6 +26,8 @@
 
 #include "Tests.hpp"
 
+static std::string printDecorated(ItemTable &table);
+
 TEST_CASE("Throws on wrong specification.", "[item-table][format]")
 {
     REQUIRE_THROWS_AS(ItemTable(std::string(), "this is not valid",
@@ -114,3 +116,230 @@ TEST_CASE("Sorting is performed.", "[item-table][sorting]")
         "ccc\n";
     REQUIRE(oss.str() == expected);
 }
+
+TEST_CASE("Sorting is stable and multi-key.", "[item-table][sorting]")
+{
+    Item itemA = Tests::makeItem("aaa");
+    itemA.setValue("k", "2");
+    Item itemB = Tests::makeItem("bbb");
+    itemB.setValue("k", "1");
+    Item itemC = Tests::makeItem("ccc");
+    itemC.setValue("k", "2");
+
+    ItemTable table("_id", std::string(), std::string("k"), 80);
+    table.append(itemC);
+    table.append(itemA);
+    table.append(itemB);
+
+    std::ostringstream oss;
+    table.print(oss);
+
+    const std::string expected =
+        "ID \n"
+        "bbb\n"
+        "ccc\n"
+        "aaa\n";
+    REQUIRE(oss.str() == expected);
+}
+
+TEST_CASE("Limit keeps first items in sorting order.", "[item-table][sorting]")
+{
+    Item itemA = Tests::makeItem("aaa");
+    Item itemB = Tests::makeItem("bbb");
+    Item itemC = Tests::makeItem("ccc");
+    Item itemD = Tests::makeItem("ddd");
+
+    ItemTable table("_id", std::string(), std::string("_id"), 80, 2U);
+    table.append(itemC);
+    table.append(itemD);
+    table.append(itemA);
+    table.append(itemB);
+
+    std::ostringstream oss;
+    table.print(oss);
+
+    const std::string expected =
+        "ID \n"
+        "aaa\n"
+        "bbb\n";
+    REQUIRE(oss.str() == expected);
+}
+
+TEST_CASE("Only unsorted table gets full.", "[item-table][sorting]")
+{
+    Item itemA = Tests::makeItem("aaa");
+    Item itemB = Tests::makeItem("bbb");
+
+    ItemTable sorted("_id", std::string(), std::string("_id"), 80, 1U);
+    sorted.append(itemA);
+    REQUIRE(!sorted.isFull());
+
+    ItemTable unsorted("_id", std::string(), std::string(), 80, 2U);
+    unsorted.append(itemA);
+    REQUIRE(!unsorted.isFull());
+    unsorted.append(itemB);
+    REQUIRE(unsorted.isFull());
+
+    ItemTable unlimited("_id", std::string(), std::string(), 80);
+    unlimited.append(itemA);
+    REQUIRE(!unlimited.isFull());
+}
+
+TEST_CASE("Descending sorting keys are supported.", "[item-table][sorting]")
+{
+    Item itemA = Tests::makeItem("aaa");
+    itemA.setValue("k", "1");
+    Item itemB = Tests::makeItem("bbb");
+    itemB.setValue("k", "2");
+    Item itemC = Tests::makeItem("ccc");
+    itemC.setValue("k", "1");
+
+    ItemTable table("_id,k", std::string(), std::string("-k,-_id"), 80, 2U);
+    table.append(itemA);
+    table.append(itemB);
+    table.append(itemC);
+
+    std::ostringstream oss;
+    table.print(oss);
+
+    const std::string expected =
+        "ID   K\n"
+        "bbb  2\n"
+        "ccc  1\n";
+    REQUIRE(oss.str() == expected);
+}
+
+TEST_CASE("Unsorted delimited rows are printed on appending.",
+          "[item-table][delimited]")
+{
+    Item itemA = Tests::makeItem("aaa");
+    itemA.setValue("title", "a\tb\nc");
+    Item itemB = Tests::makeItem("bbb");
+    itemB.setValue("title", "title");
+
+    std::ostringstream oss;
+    ItemTable table("_id,title", std::string(), std::string(), 0);
+    table.makeDelimited(oss, '\t');
+
+    table.append(itemB);
+    REQUIRE(oss.str() == "bbb\ttitle\n");
+    table.append(itemA);
+    REQUIRE(oss.str() == "bbb\ttitle\naaa\ta b c\n");
+
+    table.print(oss);
+    REQUIRE(oss.str() == "bbb\ttitle\naaa\ta b c\n");
+}
+
+TEST_CASE("Sorted delimited rows are printed at the end.",
+          "[item-table][delimited]")
+{
+    Item itemA = Tests::makeItem("aaa");
+    itemA.setValue("title", "x");
+    Item itemB = Tests::makeItem("bbb");
+
+    std::ostringstream oss;
+    ItemTable table("_id,title", std::string(), std::string("_id"), 0);
+    table.makeDelimited(oss, '\0');
+
+    table.append(itemB);
+    table.append(itemA);
+    REQUIRE(oss.str() == std::string());
+
+    table.print(oss);
+    REQUIRE(oss.str() == std::string("aaa\0x\0bbb\0\0", 11));
+}
+
+TEST_CASE("First matching color rule is applied.", "[item-table][color]")
+{
+    Item itemA = Tests::makeItem("aaa");
+    itemA.setValue("title", "a");
+    Item itemB = Tests::makeItem("bbb");
+    itemB.setValue("title", "a");
+    Item itemC = Tests::makeItem("ccc");
+    itemC.setValue("title", "c");
+
+    ItemTable table("_id,title", "fg-red title==a; fg-green _id==bbb;"
+                                 "bold !heading",
+                    std::string("_id"), 80);
+    table.append(itemC);
+    table.append(itemB);
+    table.append(itemA);
+
+    const std::string expected =
+        "\033[1mID \033[1m\033[0m  \033[1mTITLE\033[1m\033[0m\n"
+        "\033[31maaa  a    \033[1m\033[0m\n"
+        "\033[31mbbb  a    \033[1m\033[0m\n"
+        "ccc  c    \033[1m\033[0m\n";
+    REQUIRE(printDecorated(table) == expected);
+}
+
+TEST_CASE("Any condition of color rule selects it.", "[item-table][color]")
+{
+    Item itemA = Tests::makeItem("aaa");
+    Item itemB = Tests::makeItem("bbb");
+    Item itemC = Tests::makeItem("ccc");
+
+    ItemTable table("_id", "inv _id==aaa _id==ccc", std::string("_id"), 80);
+    table.append(itemA);
+    table.append(itemB);
+    table.append(itemC);
+
+    const std::string expected =
+        "ID \033[1m\033[0m\n"
+        "\033[7maaa\033[1m\033[0m\n"
+        "bbb\033[1m\033[0m\n"
+        "\033[7mccc\033[1m\033[0m\n";
+    REQUIRE(printDecorated(table) == expected);
+}
+
+TEST_CASE("Color rules see values of columns and other keys.",
+          "[item-table][color]")
+{
+    Item itemA = Tests::makeItem("aaa");
+    itemA.setValue("k", "1");
+    itemA.setValue("hidden", "x");
+    Item itemB = Tests::makeItem("bbb");
+    itemB.setValue("k", "2");
+    Item itemC = Tests::makeItem("ccc");
+    itemC.setValue("k", "3");
+    itemC.setValue("hidden", "y");
+
+    // Key "k" is both a column and a sorting key, "hidden" isn't displayed.
+    ItemTable table("_id,k", "fg-blue k==2; fg-cyan hidden==x;"
+                             "fg-yellow _any==y",
+                    std::string("k"), 80);
+    table.append(itemC);
+    table.append(itemB);
+    table.append(itemA);
+
+    const std::string expected =
+        "ID \033[1m\033[0m  K\033[1m\033[0m\n"
+        "\033[36maaa  1\033[1m\033[0m\n"
+        "\033[34mbbb  2\033[1m\033[0m\n"
+        "\033[33mccc  3\033[1m\033[0m\n";
+    REQUIRE(printDecorated(table) == expected);
+}
+
+/**
+ * @brief Prints table with decorations enabled.
+ *
+ * @param table Table to print.
+ *
+ * @returns Printed table.
+ */
+static std::string
+printDecorated(ItemTable &table)
+{
+    std::ostringstream oss;
+
+    Tests::enableDecorations();
+    try {
+        table.print(oss);
+    } catch (...) {
+        Tests::disableDecorations();
+        throw;
+    }
+    Tests::disableDecorations();
+
+    return oss.str();
+}
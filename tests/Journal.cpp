@@ -0,0 +1,125 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Catch/catch.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <cstddef>
+
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Change.hpp"
+#include "Journal.hpp"
+
+namespace fs = boost::filesystem;
+
+TEST_CASE("Journal replays complete transactions", "[journal]")
+{
+    const std::string path = "tests/data/dit/projects/journal";
+
+    std::map<std::string, std::vector<Change>> items;
+    std::map<std::string, std::size_t> froms;
+    std::map<std::string, std::string> settings;
+    auto replay = [&]() {
+        items.clear();
+        froms.clear();
+        settings.clear();
+        Journal(path).replay(
+            [&](const std::string &id, std::size_t from,
+                std::vector<Change> changes) {
+                items[id] = std::move(changes);
+                froms[id] = from;
+            },
+            [&](const std::string &key, const std::string &value) {
+                settings[key] = value;
+            });
+    };
+
+    try {
+
+        Journal journal(path);
+        REQUIRE(!journal.exists());
+
+        journal.commit();
+        REQUIRE(!journal.exists());
+
+        journal.addItem("abc", { Change(1, "title", "first"),
+                                 Change(2, "title", "second") }, 0U);
+        journal.addSetting("!ids.next", "abd");
+        journal.commit();
+        REQUIRE(journal.exists());
+
+        journal.addItem("abd", { Change(3, "title", "line\nline") }, 0U);
+        journal.addItem("abe", { Change(3, "title", "old"),
+                                 Change(3, "status", "new") }, 1U);
+        journal.commit();
+
+        replay();
+        REQUIRE(items.size() == 3U);
+        REQUIRE(items["abc"].size() == 2U);
+        REQUIRE(items["abc"][1].getValue() == "second");
+        REQUIRE(froms["abc"] == 0U);
+        REQUIRE(items["abd"][0].getValue() == "line\nline");
+        REQUIRE(items["abe"].size() == 1U);
+        REQUIRE(items["abe"][0].getKey() == "status");
+        REQUIRE(items["abe"][0].getTimestamp() == 3);
+        REQUIRE(froms["abe"] == 1U);
+        REQUIRE(settings == (std::map<std::string, std::string> {
+            { "!ids.next", "abd" }
+        }));
+
+        SECTION("Torn transaction is skipped")
+        {
+            std::ofstream(path, std::ios::app) << "item abf 100\n3\ntitle=";
+            replay();
+            REQUIRE(items.size() == 3U);
+        }
+
+        SECTION("Applied transactions are still replayed")
+        {
+            REQUIRE(!journal.isApplied());
+            REQUIRE(journal.markApplied());
+            REQUIRE(journal.isApplied());
+
+            journal.addItem("abf", { Change(4, "title", "new") }, 0U);
+            journal.commit();
+            REQUIRE(!journal.isApplied());
+
+            replay();
+            REQUIRE(items.size() == 4U);
+        }
+
+        SECTION("Broken file is reported")
+        {
+            std::ofstream(path, std::ios::app) << "bad record\nend\n";
+            REQUIRE_THROWS_AS(replay(), const std::runtime_error &);
+        }
+
+        journal.discard();
+        REQUIRE(!journal.exists());
+
+    } catch (...) {
+        fs::remove(path);
+        throw;
+    }
+
+    fs::remove(path);
+}
@@ -0,0 +1,93 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Catch/catch.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "Change.hpp"
+#include "KeyTable.hpp"
+
+namespace fs = boost::filesystem;
+
+TEST_CASE("Key numbers are stored and loaded", "[key-table]")
+{
+    const std::string path = "tests/data/dit/projects/keys";
+
+    try {
+
+        {
+            KeyTable keys(path);
+            REQUIRE_THROWS_AS(keys.getKey(0U), const std::runtime_error &);
+
+            REQUIRE(keys.getId(Change::internKey("title")) == 0U);
+            REQUIRE(keys.getId(Change::internKey("status")) == 1U);
+            REQUIRE(keys.getId(Change::internKey("title")) == 0U);
+        }
+
+        {
+            const KeyTable keys(path);
+            REQUIRE(*keys.getKey(0U) == "title");
+            REQUIRE(*keys.getKey(1U) == "status");
+            REQUIRE_THROWS_AS(keys.getKey(2U), const std::runtime_error &);
+        }
+
+        {
+            std::ofstream(path) << "key=value\n";
+            REQUIRE_THROWS_AS(KeyTable { path }, const std::runtime_error &);
+        }
+
+    } catch (...) {
+        fs::remove(path);
+        throw;
+    }
+
+    fs::remove(path);
+}
+
+TEST_CASE("Keys added by other tables aren't renumbered", "[key-table]")
+{
+    const std::string path = "tests/data/dit/projects/keys";
+
+    try {
+
+        KeyTable first(path);
+        KeyTable second(path);
+
+        REQUIRE(first.getId(Change::internKey("title")) == 0U);
+        REQUIRE(second.getId(Change::internKey("status")) == 1U);
+        REQUIRE(second.getId(Change::internKey("title")) == 0U);
+        REQUIRE(first.getId(Change::internKey("type")) == 2U);
+        REQUIRE(*first.getKey(1U) == "status");
+
+        // Torn line is dropped on adding the next key.
+        std::ofstream(path, std::ios::app) << "tor";
+        KeyTable third(path);
+        REQUIRE_THROWS_AS(third.getKey(3U), const std::runtime_error &);
+        REQUIRE(third.getId(Change::internKey("torn")) == 3U);
+        REQUIRE(*KeyTable(path).getKey(3U) == "torn");
+
+    } catch (...) {
+        fs::remove(path);
+        throw;
+    }
+
+    fs::remove(path);
+}
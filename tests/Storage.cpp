@@ -16,11 +16,25 @@
 
 #include "Catch/catch.hpp"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+
 #include <boost/filesystem/operations.hpp>
 
+#include <ctime>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <set>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "Change.hpp"
 #include "Item.hpp"
+#include "Journal.hpp"
 #include "Project.hpp"
 #include "Storage.hpp"
 
@@ -28,6 +42,8 @@
 
 namespace fs = boost::filesystem;
 
+static std::string readFile(const std::string &path);
+
 TEST_CASE("Existing items are loaded", "[storage]")
 {
     Project prj("tests/data/dit/projects/first");
@@ -112,3 +128,902 @@ TEST_CASE("Storage throws on save if project removed", "[storage]")
 
     fs::remove_all("tests/data/dit/projects/tmp");
 }
+
+TEST_CASE("Items are stored in and loaded from packed storage", "[storage]")
+{
+    std::string id;
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getStorage().convert("packed");
+
+            Item &item = prj.getStorage().create();
+            item.setValue("title", "title value");
+            id = item.getId();
+            prj.save();
+        }
+
+        REQUIRE(!fs::exists("tests/data/dit/projects/tmp/items"));
+        REQUIRE(fs::exists("tests/data/dit/projects/tmp/items.pack"));
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+            REQUIRE(storage.getBackendName() == "packed");
+            REQUIRE(storage.loadAll().size() == 1U);
+            REQUIRE(storage.get(id).getValue("title") == "title value");
+
+            storage.get(id).setValue("title", "new value");
+            prj.save();
+        }
+
+        // Index is rebuilt from data file if it's missing.
+        fs::remove("tests/data/dit/projects/tmp/items.idx");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+            REQUIRE(storage.list().size() == 1U);
+            REQUIRE(storage.get(id).getValue("title") == "new value");
+
+            storage.convert("dir");
+            prj.save();
+        }
+
+        REQUIRE(!fs::exists("tests/data/dit/projects/tmp/items.pack"));
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+            REQUIRE(storage.getBackendName() == "dir");
+            REQUIRE(storage.get(id).getValue("title") == "new value");
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+TEST_CASE("Storage switches are saved by conversions", "[storage]")
+{
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        std::string id;
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Item &item = prj.getStorage().create();
+            item.setValue("title", "title");
+            id = item.getId();
+            prj.save();
+        }
+
+        // Leftover of interrupted conversion.
+        std::ofstream("tests/data/dit/projects/tmp/items.pack") << "stale 0\n";
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getStorage().convert("packed");
+        }
+
+        REQUIRE(!fs::exists("tests/data/dit/projects/tmp/items"));
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+            REQUIRE(storage.getBackendName() == "packed");
+            REQUIRE(storage.list().size() == 1U);
+            REQUIRE(storage.get(id).getValue("title") == "title");
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getStorage().convertFormat("binary");
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+            REQUIRE(storage.getFormatName() == "binary");
+            REQUIRE(storage.get(id).getValue("title") == "title");
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+TEST_CASE("Packed storage drops superseded records", "[storage]")
+{
+    std::time_t t = std::time(nullptr);
+    MockTimeSource timeMock([&t](){ return t; });
+
+    const std::string packPath = "tests/data/dit/projects/tmp/items.pack";
+    const std::string indexPath = "tests/data/dit/projects/tmp/items.idx";
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        std::string id;
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getStorage().convert("packed");
+
+            Item &item = prj.getStorage().create();
+            item.setValue("title", "title 0");
+            id = item.getId();
+            prj.save();
+        }
+
+        const std::uintmax_t initialSize = fs::file_size(packPath);
+
+        // Changes of the same second replace each other and cause rewrites.
+        for (int i = 1; i <= 10; ++i) {
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getStorage().get(id).setValue("title",
+                                              "title " + std::to_string(i));
+            prj.save();
+
+            REQUIRE(fs::file_size(packPath) <= 3U*initialSize);
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            REQUIRE(prj.getStorage().get(id).getValue("title") == "title 10");
+        }
+
+        // Repacked index has single line per item.
+        const std::string index = readFile(indexPath);
+        REQUIRE(std::count(index.cbegin(), index.cend(), '\n') <= 2);
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+TEST_CASE("Reopened storage takes over unchanged items", "[storage]")
+{
+    std::time_t t = std::time(nullptr);
+    MockTimeSource timeMock([&t](){ return t; });
+
+    const std::string root = "tests/data/dit/projects/tmp";
+
+    std::string backend;
+    SECTION("Directory backend") { backend = "dir"; }
+    SECTION("Packed backend") { backend = "packed"; }
+
+    try {
+
+        Project::init(root);
+
+        std::string id1, id2;
+        {
+            Project prj(root);
+            prj.getStorage().convert(backend);
+
+            Item &item1 = prj.getStorage().create();
+            item1.setValue("title", "first");
+            id1 = item1.getId();
+            Item &item2 = prj.getStorage().create();
+            item2.setValue("title", "second");
+            id2 = item2.getId();
+            prj.save();
+        }
+
+        Project former(root);
+        REQUIRE(former.getStorage().get(id1).getValue("title") == "first");
+        REQUIRE(former.getStorage().get(id2).getValue("title") == "second");
+
+        ++t;
+        {
+            Project prj(root);
+            prj.getStorage().get(id2).setValue("title", "changed");
+            prj.save();
+        }
+
+        std::vector<std::string> paths;
+        if (backend == "dir") {
+            const fs::path dataDir = former.getDataDir();
+            paths = { (dataDir/id2.substr(0, 1)/id2.substr(1)).string() };
+        } else {
+            paths = { root + "/items.pack", root + "/items.idx" };
+        }
+
+        Project reopened(root);
+        reopened.getStorage().adopt(former.getStorage(), paths);
+        REQUIRE(reopened.getStorage().get(id2).getValue("title") ==
+                "changed");
+
+        // Data of unchanged item isn't read again.
+        if (backend == "dir") {
+            fs::remove_all(reopened.getDataDir());
+        } else {
+            fs::remove(root + "/items.pack");
+        }
+        REQUIRE(reopened.getStorage().get(id1).getValue("title") == "first");
+
+    } catch (...) {
+        fs::remove_all(root);
+        throw;
+    }
+
+    fs::remove_all(root);
+}
+
+TEST_CASE("Only new changes are appended on save", "[storage]")
+{
+    std::time_t t = std::time(nullptr);
+    MockTimeSource timeMock([&t](){ return t; });
+
+    std::string id;
+    std::string path;
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Item &item = prj.getStorage().create();
+            item.setValue("title", "title");
+            id = item.getId();
+            prj.save();
+        }
+
+        path = "tests/data/dit/projects/tmp/items/" + id.substr(0, 1) + '/'
+             + id.substr(1);
+        const std::string stored = readFile(path);
+
+        SECTION("New change of the same second is appended")
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getStorage().get(id).setValue("status", "open");
+            prj.save();
+
+            REQUIRE(readFile(path) == stored + "status=open\n");
+        }
+
+        SECTION("New change of later time is appended with timestamp")
+        {
+            ++t;
+
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getStorage().get(id).setValue("title", "new");
+            prj.save();
+
+            REQUIRE(readFile(path) ==
+                    stored + std::to_string(t) + "\ntitle=new\n");
+        }
+
+        SECTION("Update of stored change rewrites the file")
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getStorage().get(id).setValue("title", "new");
+
+            // This must be dropped by rewrite.
+            std::ofstream(path, std::ios::app) << "extra=line\n";
+
+            prj.save();
+
+            REQUIRE(readFile(path) ==
+                    std::to_string(t) + "\ntitle=new\n");
+        }
+
+        SECTION("Packed storage appends changes as well")
+        {
+            {
+                Project prj("tests/data/dit/projects/tmp");
+                prj.getStorage().convert("packed");
+                prj.save();
+            }
+
+            {
+                Project prj("tests/data/dit/projects/tmp");
+                prj.getStorage().get(id).setValue("status", "open");
+                prj.save();
+            }
+
+            Project prj("tests/data/dit/projects/tmp");
+            Item &item = prj.getStorage().get(id);
+            REQUIRE(item.getValue("title") == "title");
+            REQUIRE(item.getValue("status") == "open");
+            REQUIRE(readFile("tests/data/dit/projects/tmp/items.pack")
+                    .find(id + " +12\nstatus=open\n") != std::string::npos);
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+TEST_CASE("Interrupted save is finished from journal", "[storage][journal]")
+{
+    const std::string journalPath = "tests/data/dit/projects/tmp/journal";
+
+    std::string id;
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Item &item = prj.getStorage().create();
+            item.setValue("title", "title");
+            id = item.getId();
+            prj.save();
+        }
+        REQUIRE(Journal(journalPath).isApplied());
+
+        {
+            // Emulate crash after journal was written and tail of the item
+            // was partially appended.
+            const std::time_t t = std::time(nullptr) + 10;
+
+            Journal journal(journalPath);
+            journal.addItem(id, { Change(1, "title", "title"),
+                                  Change(t, "status", "done"),
+                                  Change(t, "type", "bug") }, 1U);
+            journal.addItem("new", { Change(3, "title", "new") }, 0U);
+            journal.addSetting("!ids.total", "2");
+            journal.commit();
+
+            const std::string path = "tests/data/dit/projects/tmp/items/"
+                                   + id.substr(0, 1) + '/' + id.substr(1);
+            std::ofstream(path, std::ios::app) << t << "\nstatus=done\ntyp";
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            REQUIRE(!fs::exists(journalPath));
+
+            Storage &storage = prj.getStorage();
+            REQUIRE(storage.get(id).getValue("title") == "title");
+            REQUIRE(storage.get(id).getValue("status") == "done");
+            REQUIRE(storage.get(id).getValue("type") == "bug");
+            REQUIRE(storage.get(id).getChanges().size() == 3U);
+            REQUIRE(storage.get("new").getValue("title") == "new");
+            REQUIRE(storage.getIdGenerator().size() == 2);
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+TEST_CASE("Cold items are compressed on compaction", "[storage][compact]")
+{
+    const std::time_t now = std::time(nullptr);
+    std::time_t t = now - 100*24*60*60;
+    MockTimeSource timeMock([&t](){ return t; });
+
+    std::string oldId, newId;
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Item &oldItem = prj.getStorage().create();
+            oldItem.setValue("title", "old");
+            oldId = oldItem.getId();
+            t = now;
+            Item &newItem = prj.getStorage().create();
+            newItem.setValue("title", "new");
+            newId = newItem.getId();
+            prj.save();
+        }
+
+        for (const std::string backend : { "dir", "packed" }) {
+            if (backend != "dir") {
+                Project prj("tests/data/dit/projects/tmp");
+                prj.getStorage().convert(backend);
+                prj.save();
+            }
+
+            {
+                Project prj("tests/data/dit/projects/tmp");
+                Storage &storage = prj.getStorage();
+                REQUIRE(storage.compact() == 1);
+
+                prj.getConfig().set("storage.compress.age", "0");
+                prj.getConfig().set("storage.compress.size", "0");
+                REQUIRE(storage.compact() == 0);
+                prj.getConfig().set("storage.compress.size", "8");
+                REQUIRE(storage.compact() == 2);
+
+                prj.getConfig().set("storage.compress.size", "x");
+                REQUIRE_THROWS_AS(storage.compact(), const std::runtime_error &);
+            }
+
+            if (backend == "dir") {
+                const std::string path = "tests/data/dit/projects/tmp/items/"
+                                       + oldId.substr(0, 1) + '/'
+                                       + oldId.substr(1);
+                REQUIRE(readFile(path).substr(0, 2) == "\x1f\x8b");
+            }
+
+            {
+                // Modification makes item uncompressed again.
+                t = now - 100*24*60*60;
+                Project prj("tests/data/dit/projects/tmp");
+                Storage &storage = prj.getStorage();
+                REQUIRE(storage.get(oldId).getValue("title") == "old");
+                REQUIRE(storage.get(newId).getValue("title") == "new");
+                storage.get(oldId).setValue("status", backend);
+                prj.save();
+            }
+
+            {
+                Project prj("tests/data/dit/projects/tmp");
+                Item &item = prj.getStorage().get(oldId);
+                REQUIRE(item.getValue("title") == "old");
+                REQUIRE(item.getValue("status") == backend);
+            }
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+TEST_CASE("Conversions keep compression of items", "[storage][compact]")
+{
+    const std::time_t now = std::time(nullptr);
+    std::time_t t = now - 100*24*60*60;
+    MockTimeSource timeMock([&t](){ return t; });
+
+    std::string oldId, newId;
+    auto isCompressed = [](const std::string &id) {
+        const std::string path = "tests/data/dit/projects/tmp/items/"
+                               + id.substr(0, 1) + '/' + id.substr(1);
+        return readFile(path).substr(0, 2) == "\x1f\x8b";
+    };
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Item &oldItem = prj.getStorage().create();
+            oldItem.setValue("title", "old");
+            oldId = oldItem.getId();
+            t = now;
+            Item &newItem = prj.getStorage().create();
+            newItem.setValue("title", "new");
+            newId = newItem.getId();
+            prj.save();
+        }
+
+        {
+            // Cold item isn't compressed on a round trip between backends.
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getStorage().convert("packed");
+            prj.getStorage().convert("dir");
+            prj.save();
+        }
+        REQUIRE(!isCompressed(oldId));
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            REQUIRE(prj.getStorage().compact() == 1);
+            prj.getStorage().convert("packed");
+            prj.getStorage().convertFormat("binary");
+            prj.getStorage().convert("dir");
+            prj.save();
+        }
+        REQUIRE(isCompressed(oldId));
+        REQUIRE(!isCompressed(newId));
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            REQUIRE(prj.getStorage().get(oldId).getValue("title") == "old");
+            REQUIRE(prj.getStorage().get(newId).getValue("title") == "new");
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+TEST_CASE("Current values are taken from snapshot", "[storage][snapshot]")
+{
+    std::string id;
+    std::string path;
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Item &item = prj.getStorage().create();
+            item.setValue("title", "title");
+            item.setValue("status", "open");
+            id = item.getId();
+            prj.save();
+        }
+
+        const std::string snapshotPath = "tests/data/dit/projects/tmp/snapshot";
+        const std::string record = "\nstatus=open\ntitle=title\n\n";
+        // Header of the record includes stamp of item data.
+        auto isRecordOf = [&id](const std::string &data,
+                                const std::string &body) {
+            return data.compare(0U, id.size() + 2U, '@' + id + ' ') == 0
+                && data.size() > body.size()
+                && data.compare(data.size() - body.size(), body.size(),
+                                body) == 0;
+        };
+        REQUIRE(isRecordOf(readFile(snapshotPath), record));
+
+        path = "tests/data/dit/projects/tmp/items/" + id.substr(0, 1) + '/'
+             + id.substr(1);
+
+        SECTION("Listed items don't load their changes")
+        {
+            // Reading item data must fail now, while the file looks the same.
+            struct stat st;
+            REQUIRE(stat(path.c_str(), &st) == 0);
+            {
+                std::fstream file(path, std::ios::in | std::ios::out);
+                file << std::string(st.st_size - 1, '!') << '\n';
+            }
+            const timespec times[] = { st.st_atim, st.st_mtim };
+            REQUIRE(utimensat(AT_FDCWD, path.c_str(), times, 0) == 0);
+
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+            REQUIRE(storage.list().size() == 1U);
+
+            Item &item = storage.get(id);
+            REQUIRE(item.getValue("title") == "title");
+            REQUIRE(item.listRecordNames() ==
+                    std::set<std::string>({ "status", "title" }));
+            REQUIRE_THROWS_AS(item.getValue("_created"),
+                              const std::runtime_error &);
+        }
+
+        SECTION("Snapshot is updated on change")
+        {
+            {
+                Project prj("tests/data/dit/projects/tmp");
+                prj.getStorage().get(id).setValue("status", "");
+                prj.save();
+            }
+
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+            REQUIRE(storage.list().size() == 1U);
+            REQUIRE(storage.get(id).listRecordNames() ==
+                    std::set<std::string>({ "title" }));
+        }
+
+        SECTION("Outdated records are ignored")
+        {
+            const std::string outdated = readFile(snapshotPath);
+            {
+                Project prj("tests/data/dit/projects/tmp");
+                prj.getStorage().get(id).setValue("title", "new title");
+                prj.save();
+            }
+            std::ofstream(snapshotPath) << outdated;
+
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+            REQUIRE(storage.list().size() == 1U);
+            REQUIRE(storage.get(id).getValue("title") == "new title");
+        }
+
+        SECTION("Snapshot is rebuilt after listing")
+        {
+            fs::remove(snapshotPath);
+
+            {
+                Project prj("tests/data/dit/projects/tmp");
+                REQUIRE(prj.getStorage().loadAll().front().get()
+                        .getValue("title") == "title");
+                prj.save();
+            }
+
+            REQUIRE(isRecordOf(readFile(snapshotPath), record));
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+TEST_CASE("Items are loaded in bulk", "[storage]")
+{
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            for (int i = 0; i < 32; ++i) {
+                prj.getStorage().create().setValue("title", std::to_string(i));
+            }
+            prj.save();
+        }
+
+        fs::remove("tests/data/dit/projects/tmp/snapshot");
+
+        Project prj("tests/data/dit/projects/tmp");
+        Storage &storage = prj.getStorage();
+
+        // Unsaved item must not be read from the storage.
+        storage.create().setValue("title", "new");
+
+        std::set<std::string> titles;
+        for (Item &item : storage.loadAll()) {
+            titles.insert(item.getValue("title"));
+        }
+
+        REQUIRE(titles.size() == 33U);
+        REQUIRE(titles.count("0") == 1U);
+        REQUIRE(titles.count("31") == 1U);
+        REQUIRE(titles.count("new") == 1U);
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+TEST_CASE("Items are read as they are visited", "[storage]")
+{
+    std::vector<std::string> ids;
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            for (const std::string title : { "first", "second" }) {
+                Item &item = prj.getStorage().create();
+                item.setValue("title", title);
+                ids.push_back(item.getId());
+            }
+            prj.save();
+        }
+
+        Project prj("tests/data/dit/projects/tmp");
+
+        std::vector<std::string> titles;
+        prj.getStorage().forEach([&](Item &item) {
+            titles.push_back(item.getValue("title"));
+            if (titles.size() == 1U) {
+                // Change the other item after this one was visited.
+                const std::string &other = (item.getId() == ids[0] ? ids[1]
+                                                                   : ids[0]);
+                Project changer("tests/data/dit/projects/tmp");
+                changer.getStorage().get(other).setValue("title", "changed");
+                changer.save();
+            }
+            return true;
+        });
+
+        REQUIRE(titles.size() == 2U);
+        REQUIRE(titles[1] == "changed");
+
+        int nVisited = 0;
+        prj.getStorage().forEach([&nVisited](Item &) {
+            ++nVisited;
+            return false;
+        });
+        REQUIRE(nVisited == 1);
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+TEST_CASE("Index of values is maintained if enabled", "[storage][index]")
+{
+    using values_t = std::vector<std::pair<std::string, std::string>>;
+    const values_t open { { "status", "open" } };
+    const values_t closed { { "status", "closed" } };
+
+    auto ids = [](const std::vector<std::reference_wrapper<Item>> &items) {
+        std::set<std::string> ids;
+        for (const Item &item : items) {
+            ids.insert(item.getId());
+        }
+        return ids;
+    };
+
+    std::string first, second;
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+
+            Item &a = storage.create();
+            a.setValue("status", "open");
+            a.setValue("title", "a");
+            first = a.getId();
+
+            Item &b = storage.create();
+            b.setValue("status", "open");
+            second = b.getId();
+
+            prj.save();
+
+            std::vector<std::reference_wrapper<Item>> found;
+            REQUIRE(!storage.find(open, { }, found));
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getConfig(false).set("index.values", "yes");
+            prj.save();
+        }
+
+        REQUIRE(fs::is_directory("tests/data/dit/projects/tmp/index"));
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+
+            std::vector<std::reference_wrapper<Item>> found;
+            REQUIRE(storage.find(open, { }, found));
+            REQUIRE(ids(found) == std::set<std::string>({ first, second }));
+            REQUIRE(storage.find(values_t{ { "status", "open" },
+                                           { "title", "a" } }, { }, found));
+            REQUIRE(ids(found) == std::set<std::string>({ first }));
+
+            storage.get(first).setValue("status", "closed");
+            prj.save();
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+
+            std::vector<std::reference_wrapper<Item>> found;
+            REQUIRE(storage.find(open, { }, found));
+            REQUIRE(ids(found) == std::set<std::string>({ second }));
+            REQUIRE(storage.find(closed, { }, found));
+            REQUIRE(ids(found) == std::set<std::string>({ first }));
+
+            prj.getConfig(false).set("index.values", "no");
+            prj.save();
+        }
+
+        REQUIRE(!fs::exists("tests/data/dit/projects/tmp/index"));
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+TEST_CASE("Index of trigrams is maintained if enabled", "[storage][index]")
+{
+    auto ids = [](const std::vector<std::reference_wrapper<Item>> &items) {
+        std::set<std::string> ids;
+        for (const Item &item : items) {
+            ids.insert(item.getId());
+        }
+        return ids;
+    };
+
+    std::string first, second;
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getConfig(false).set("index.trigrams", "yes");
+
+            Item &a = prj.getStorage().create();
+            a.setValue("title", "Crash on start");
+            first = a.getId();
+
+            Item &b = prj.getStorage().create();
+            b.setValue("comment", "no crash here");
+            second = b.getId();
+
+            prj.save();
+        }
+
+        REQUIRE(fs::is_regular_file("tests/data/dit/projects/tmp/trigrams"));
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+
+            std::vector<std::reference_wrapper<Item>> found;
+            REQUIRE(storage.find({ }, { "CRASH" }, found));
+            REQUIRE(ids(found) == std::set<std::string>({ first, second }));
+            REQUIRE(storage.find({ }, { "start" }, found));
+            REQUIRE(ids(found) == std::set<std::string>({ first }));
+            REQUIRE(!storage.find({ }, { "on" }, found));
+
+            storage.get(first).setValue("title", "Hang on start");
+            prj.save();
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+
+            std::vector<std::reference_wrapper<Item>> found;
+            REQUIRE(storage.find({ }, { "crash" }, found));
+            REQUIRE(ids(found) == std::set<std::string>({ second }));
+
+            prj.getConfig(false).set("index.trigrams", "no");
+            prj.save();
+        }
+
+        REQUIRE(!fs::exists("tests/data/dit/projects/tmp/trigrams"));
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+}
+
+/**
+ * @brief Reads whole file into a string.
+ *
+ * @param path Path to the file.
+ *
+ * @returns Contents of the file.
+ */
+static std::string
+readFile(const std::string &path)
+{
+    std::ifstream file(path);
+    return { std::istreambuf_iterator<char>(file),
+             std::istreambuf_iterator<char>() };
+}
@@ -37,6 +37,12 @@ Tests::disableDecorations()
     decor::disableDecorations({});
 }
 
+void
+Tests::enableDecorations()
+{
+    decor::enableDecorations({});
+}
+
 void
 Tests::setStreams(std::ostream &out, std::ostream &err)
 {
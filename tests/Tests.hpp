@@ -81,6 +81,48 @@ private:
     std::streambuf *rdbuf;
 };
 
+/**
+ * @brief Temporarily makes specified stream read from a string.
+ */
+class StreamFeed
+{
+public:
+    /**
+     * @brief Constructs instance that redirects @p is.
+     *
+     * @param is Stream to redirect.
+     * @param input Data to be read from the stream.
+     */
+    StreamFeed(std::istream &is, const std::string &input)
+        : is(is), iss(input)
+    {
+        rdbuf = is.rdbuf();
+        is.rdbuf(iss.rdbuf());
+    }
+
+    /**
+     * @brief Restores original state of the stream.
+     */
+    ~StreamFeed()
+    {
+        is.rdbuf(rdbuf);
+    }
+
+private:
+    /**
+     * @brief Stream that is being redirected.
+     */
+    std::istream &is;
+    /**
+     * @brief Temporary input buffer of the stream.
+     */
+    std::istringstream iss;
+    /**
+     * @brief Original input buffer of the stream.
+     */
+    std::streambuf *rdbuf;
+};
+
 /**
  * @brief Attorney for accessing testing interface of the application classes.
  *
@@ -95,6 +137,10 @@ public:
      * @brief Disables adding escape sequences to output.
      */
     static void disableDecorations();
+    /**
+     * @brief Enables adding escape sequences to output.
+     */
+    static void enableDecorations();
 
     /**
      * @brief Set custom streams for command output.
@@ -0,0 +1,180 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Catch/catch.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "TrigramIndex.hpp"
+
+namespace fs = boost::filesystem;
+
+TEST_CASE("Short substrings can't be looked up", "[trigram-index]")
+{
+    REQUIRE(!TrigramIndex::canFind(""));
+    REQUIRE(!TrigramIndex::canFind("ab"));
+    REQUIRE(TrigramIndex::canFind("abc"));
+}
+
+TEST_CASE("Trigram index is updated, stored and loaded", "[trigram-index]")
+{
+    const std::string path = "tests/data/dit/projects/trigrams";
+
+    try {
+
+        {
+            TrigramIndex index(path);
+            REQUIRE(!index.exists());
+
+            index.add("a", { { "title", "Multi\nLine=Value" } });
+            index.add("b", { { "title", "value" }, { "status", "open" } });
+            index.save();
+            REQUIRE(index.exists());
+        }
+
+        {
+            TrigramIndex index(path);
+            REQUIRE(index.find("VALUE") ==
+                    std::vector<std::string>({ "a", "b" }));
+            REQUIRE(index.find("i\nl") == std::vector<std::string>({ "a" }));
+            REQUIRE(index.find("pen") == std::vector<std::string>({ "b" }));
+            REQUIRE(index.find("xyz").empty());
+
+            index.remove("b");
+            index.save();
+        }
+
+        {
+            TrigramIndex index(path);
+            REQUIRE(index.find("value") == std::vector<std::string>({ "a" }));
+            REQUIRE(index.find("open").empty());
+
+            index.clear();
+            REQUIRE(!index.exists());
+        }
+
+    } catch (...) {
+        fs::remove_all(path);
+        throw;
+    }
+
+    fs::remove_all(path);
+}
+
+TEST_CASE("Trigram index appends records of changed items", "[trigram-index]")
+{
+    const std::string path = "tests/data/dit/projects/trigrams";
+
+    auto readFile = [&path]() {
+        std::ifstream file(path);
+        return std::string(std::istreambuf_iterator<char>(file),
+                           std::istreambuf_iterator<char>());
+    };
+
+    try {
+
+        {
+            TrigramIndex index(path);
+            index.add("a", { { "title", "value" } });
+            index.add("b", { { "title", "value" } });
+            index.save();
+        }
+        const std::string initial = readFile();
+
+        {
+            TrigramIndex index(path);
+            REQUIRE(index.find("val") == std::vector<std::string>({ "a", "b" }));
+            index.save();
+        }
+        REQUIRE(readFile() == initial);
+
+        {
+            TrigramIndex index(path);
+            index.remove("a");
+            index.add("a", { { "title", "other" } });
+            index.save();
+        }
+        const std::string appended = readFile();
+        REQUIRE(appended.size() > initial.size());
+        REQUIRE(appended.compare(0U, initial.size(), initial) == 0);
+
+        {
+            TrigramIndex index(path);
+            REQUIRE(index.find("value") == std::vector<std::string>({ "b" }));
+            REQUIRE(index.find("other") == std::vector<std::string>({ "a" }));
+
+            for (int i = 0; i < 100; ++i) {
+                index.remove("b");
+                index.add("b", { { "title", "value" + std::to_string(i) } });
+                index.save();
+            }
+        }
+        const std::string compacted = readFile();
+        REQUIRE(std::count(compacted.cbegin(), compacted.cend(), '\n') < 70);
+
+        {
+            TrigramIndex index(path);
+            REQUIRE(index.find("value99") ==
+                    std::vector<std::string>({ "b" }));
+            REQUIRE(index.find("other") == std::vector<std::string>({ "a" }));
+        }
+
+    } catch (...) {
+        fs::remove_all(path);
+        throw;
+    }
+
+    fs::remove_all(path);
+}
+
+TEST_CASE("Trigram index is queried without loading it", "[trigram-index]")
+{
+    const std::string path = "tests/data/dit/projects/trigrams";
+
+    try {
+
+        {
+            std::ofstream file(path);
+            file << "a=aaabbbccc\n"
+                 << "b=aaabbb\n"
+                 << "c=aaabbbccc\n"
+                 << "b=aaabbbccc\n"
+                 << "c=\n"
+                 << "d=aaabbbccc";
+        }
+
+        TrigramIndex index(path);
+        REQUIRE(index.find("aaaa") == std::vector<std::string>({ "a", "b" }));
+        REQUIRE(index.find("cccc") == std::vector<std::string>({ "a", "b" }));
+        REQUIRE(index.find("abb").empty());
+
+        index.add("c", { { "title", "Aaaa" } });
+        REQUIRE(index.find("aaaa") ==
+                std::vector<std::string>({ "a", "b", "c" }));
+
+    } catch (...) {
+        fs::remove_all(path);
+        throw;
+    }
+
+    fs::remove_all(path);
+}
@@ -0,0 +1,77 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Catch/catch.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <string>
+#include <vector>
+
+#include "ValueIndex.hpp"
+
+namespace fs = boost::filesystem;
+
+TEST_CASE("Value index is updated, stored and loaded", "[value-index]")
+{
+    const std::string path = "tests/data/dit/projects/index";
+
+    try {
+
+        {
+            ValueIndex index(path);
+            REQUIRE(!index.exists());
+
+            index.add("a", { { "status", "open" }, { "title", "x=y\nz" } });
+            index.add("b", { { "status", "open" } });
+            index.add("c", { { "status", "closed" } });
+            index.save();
+            REQUIRE(index.exists());
+        }
+
+        {
+            ValueIndex index(path);
+            REQUIRE(index.find("status", "open") ==
+                    std::vector<std::string>({ "a", "b" }));
+            REQUIRE(index.find("title", "x=y\nz") ==
+                    std::vector<std::string>({ "a" }));
+            REQUIRE(index.find("status", "new").empty());
+            REQUIRE(index.find("nokey", "open").empty());
+
+            index.remove("a", { "status", "title" });
+            index.add("a", { { "status", "closed" } });
+            index.save();
+        }
+
+        {
+            ValueIndex index(path);
+            REQUIRE(index.find("status", "open") ==
+                    std::vector<std::string>({ "b" }));
+            REQUIRE(index.find("status", "closed") ==
+                    std::vector<std::string>({ "a", "c" }));
+            REQUIRE(index.find("title", "x=y\nz").empty());
+
+            index.clear();
+            REQUIRE(!index.exists());
+        }
+
+    } catch (...) {
+        fs::remove_all(path);
+        throw;
+    }
+
+    fs::remove_all(path);
+}
@@ -0,0 +1,307 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "Catch/catch.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <cstdlib>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "Command.hpp"
+#include "Commands.hpp"
+#include "Config.hpp"
+#include "Dit.hpp"
+#include "Item.hpp"
+#include "Project.hpp"
+#include "Storage.hpp"
+
+#include "Tests.hpp"
+
+namespace fs = boost::filesystem;
+
+static void setupEnv();
+
+TEST_CASE("Batch fails on wrong invocation", "[cmds][batch][invocation]")
+{
+    Command *const cmd = Commands::get("batch");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    setupEnv();
+    Dit dit({ "app", "batch" });
+
+    boost::optional<int> exitCode = cmd->run(dit, { "arg" });
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_FAILURE);
+
+    REQUIRE(out.str() == std::string());
+    REQUIRE(err.str() != std::string());
+}
+
+TEST_CASE("Batch executes commands", "[cmds][batch]")
+{
+    Command *const cmd = Commands::get("batch");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    setupEnv();
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        std::string id1, id2;
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            id1 = prj.getStorage().create().getId();
+            id2 = prj.getStorage().create().getId();
+            prj.save();
+        }
+
+        Dit dit({ "app", ".tmp", "batch" });
+
+        const std::string lines = "set " + id1 + " title='first item'"
+                                + std::string(2U, '\0')
+                                + "set " + id2 + " title=second"
+                                + std::string(1U, '\0');
+        StreamFeed input(std::cin, lines);
+
+        boost::optional<int> exitCode = cmd->run(dit, { "--null" });
+        REQUIRE(exitCode);
+        REQUIRE(*exitCode == EXIT_SUCCESS);
+
+        Project prj("tests/data/dit/projects/tmp");
+        Storage &storage = prj.getStorage();
+        REQUIRE(storage.get(id1).getValue("title") == "first item");
+        REQUIRE(storage.get(id2).getValue("title") == "second");
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+
+    REQUIRE(err.str() == std::string());
+}
+
+TEST_CASE("Batch runs global commands", "[cmds][batch]")
+{
+    Command *const cmd = Commands::get("batch");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    setupEnv();
+    Dit dit({ "app", "batch" });
+
+    // The last command fails, so global configuration isn't saved.
+    StreamFeed input(std::cin, "help batch\n"
+                               "config -g batch.key=value\n"
+                               "import\n");
+
+    boost::optional<int> exitCode = cmd->run(dit, {});
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_FAILURE);
+
+    REQUIRE(dit.getConfig().get("batch.key", std::string()) == "value");
+    REQUIRE(out.str().substr(0U, 9U) == "batch -- ");
+    REQUIRE(err.str() ==
+            "batch: Command can't be executed in a batch: import\n");
+}
+
+TEST_CASE("Batch expands aliases and compositions", "[cmds][batch]")
+{
+    Command *const cmd = Commands::get("batch");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    setupEnv();
+    Dit dit({ "app", "batch" });
+
+    Config &config = dit.getConfig();
+    config.set("alias.cfg", "config -g");
+    config.set("alias.g", "-g");
+    config.set("alias.new", "add");
+
+    // The last command fails, so global configuration isn't saved.
+    StreamFeed input(std::cin, "cfg batch.alias=yes\n"
+                               "config.g batch.composition=yes\n"
+                               "new title=-\n");
+
+    boost::optional<int> exitCode = cmd->run(dit, {});
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_FAILURE);
+
+    REQUIRE(config.get("batch.alias", std::string()) == "yes");
+    REQUIRE(config.get("batch.composition", std::string()) == "yes");
+    REQUIRE(err.str() == "batch: Editor can't be used in a batch: "
+                         "new title=-\n");
+}
+
+TEST_CASE("Batch rejects spawning editor", "[cmds][batch]")
+{
+    Command *const cmd = Commands::get("batch");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    setupEnv();
+
+    for (const std::string line : { "add title: -", "set id title+=-",
+                                    "config -g key=-" }) {
+        Dit dit({ "app", "batch" });
+        StreamFeed input(std::cin, line);
+
+        boost::optional<int> exitCode = cmd->run(dit, {});
+        REQUIRE(exitCode);
+        REQUIRE(*exitCode == EXIT_FAILURE);
+    }
+
+    REQUIRE(err.str() ==
+            "batch: Editor can't be used in a batch: add title: -\n"
+            "batch: Editor can't be used in a batch: set id title+=-\n"
+            "batch: Editor can't be used in a batch: config -g key=-\n");
+}
+
+TEST_CASE("Batch stops on first failure", "[cmds][batch]")
+{
+    Command *const cmd = Commands::get("batch");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    setupEnv();
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Dit dit({ "app", ".tmp", "batch" });
+            StreamFeed input(std::cin, "add title=saved\n"
+                                       "add title=saved\n"
+                                       "add title=unsaved\n"
+                                       "no-such-command\n"
+                                       "add title=skipped\n");
+
+            boost::optional<int> exitCode = cmd->run(dit, { "-n", "2" });
+            REQUIRE(exitCode);
+            REQUIRE(*exitCode == EXIT_FAILURE);
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            for (Item &item : prj.getStorage().list()) {
+                REQUIRE(item.getValue("title") == "saved");
+            }
+            REQUIRE(prj.getStorage().list().size() == 2U);
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+
+    REQUIRE(err.str() == "batch: Unknown command name: no-such-command\n");
+}
+
+TEST_CASE("Batch sees its unsaved changes via indexes", "[cmds][batch]")
+{
+    Tests::disableDecorations();
+
+    Command *const cmd = Commands::get("batch");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    setupEnv();
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        std::string id;
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Config &config = prj.getConfig(false);
+            config.set("index.values", "yes");
+            config.set("index.trigrams", "yes");
+            config.set("ui.ls.fmt", "title");
+            config.set("ui.ls.sort", "title");
+            config.set("ui.ls.color", "inv !heading");
+
+            Item &item = prj.getStorage().create();
+            item.setValue("title", "first");
+            id = item.getId();
+            prj.save();
+        }
+
+        Dit dit({ "app", ".tmp", "batch" });
+        StreamFeed input(std::cin, "set " + id + " status=open\n"
+                                   "ls status==open\n"
+                                   "add title=third status=open\n"
+                                   "ls status==open\n"
+                                   "ls title/thi\n");
+
+        boost::optional<int> exitCode = cmd->run(dit, {});
+        REQUIRE(exitCode);
+        REQUIRE(*exitCode == EXIT_SUCCESS);
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+
+    const std::string before = "TITLE\n"
+                               "first\n"
+                               "Created item: ";
+    const std::string after = "TITLE\n"
+                              "first\n"
+                              "third\n"
+                              "TITLE\n"
+                              "third\n";
+    const std::string output = out.str();
+    REQUIRE(output.substr(0U, before.size()) == before);
+    REQUIRE(output.size() > before.size() + after.size());
+    REQUIRE(output.substr(output.size() - after.size()) == after);
+    REQUIRE(err.str() == std::string());
+}
+
+/**
+ * @brief Points application to test data.
+ */
+static void
+setupEnv()
+{
+    static char xdg_env[] = "XDG_CONFIG_HOME=tests/data";
+    static char home_env[] = "HOME=.";
+
+    putenv(xdg_env);
+    putenv(home_env);
+}
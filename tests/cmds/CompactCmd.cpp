@@ -0,0 +1,147 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Catch/catch.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <cstdlib>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "Command.hpp"
+#include "Commands.hpp"
+#include "Item.hpp"
+#include "Project.hpp"
+#include "Storage.hpp"
+
+#include "Tests.hpp"
+
+namespace fs = boost::filesystem;
+
+TEST_CASE("Compact fails on wrong invocation", "[cmds][compact][invocation]")
+{
+    std::unique_ptr<Project> prj = Tests::makeProject();
+    Command *const cmd = Commands::get("compact");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    boost::optional<int> exitCode = cmd->run(*prj, { "arg" });
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_FAILURE);
+
+    REQUIRE(out.str() == std::string());
+    REQUIRE(err.str() != std::string());
+}
+
+TEST_CASE("Compact compresses large items", "[cmds][compact]")
+{
+    Command *const cmd = Commands::get("compact");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    std::string id;
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getConfig(false).set("storage.compress.size", "100");
+            Item &item = prj.getStorage().create();
+            item.setValue("title", std::string(100, 't'));
+            id = item.getId();
+            prj.getStorage().create().setValue("title", "title");
+            prj.save();
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            boost::optional<int> exitCode = cmd->run(prj, {});
+            REQUIRE(exitCode);
+            REQUIRE(*exitCode == EXIT_SUCCESS);
+            prj.save();
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            REQUIRE(prj.getStorage().get(id).getValue("title") ==
+                    std::string(100, 't'));
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+
+    REQUIRE(out.str() == "Compressed items: 1\n");
+    REQUIRE(err.str() == std::string());
+}
+
+TEST_CASE("Compact doesn't grow packed storage", "[cmds][compact]")
+{
+    Command *const cmd = Commands::get("compact");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    const std::string packPath = "tests/data/dit/projects/tmp/items.pack";
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            prj.getStorage().convert("packed");
+            prj.getStorage().create().setValue("title", "first");
+            prj.getStorage().create().setValue("title", "second");
+            prj.save();
+        }
+
+        const std::uintmax_t size = fs::file_size(packPath);
+
+        for (int i = 0; i < 3; ++i) {
+            Project prj("tests/data/dit/projects/tmp");
+            boost::optional<int> exitCode = cmd->run(prj, {});
+            REQUIRE(exitCode);
+            REQUIRE(*exitCode == EXIT_SUCCESS);
+            prj.save();
+
+            REQUIRE(fs::file_size(packPath) == size);
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            REQUIRE(prj.getStorage().list().size() == 2U);
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+
+    REQUIRE(err.str() == std::string());
+}
@@ -16,11 +16,16 @@
 
 #include "Catch/catch.hpp"
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <cstdlib>
 
 #include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <utility>
 
 #include "Change.hpp"
 #include "Command.hpp"
@@ -45,6 +50,16 @@ TEST_CASE("Export fails on wrong invocation", "[cmds][export][invocation]")
         exitCode = cmd->run(*prj, {});
     }
 
+    SECTION("No jobs")
+    {
+        exitCode = cmd->run(*prj, { "-j", "0", "cmd" });
+    }
+
+    SECTION("No items per command")
+    {
+        exitCode = cmd->run(*prj, { "--max-items", "0", "cmd" });
+    }
+
     REQUIRE(exitCode);
     REQUIRE(*exitCode == EXIT_FAILURE);
 
@@ -150,3 +165,86 @@ TEST_CASE("Stdout destination", "[cmds][export]")
                                      std::end(expectedOut)));
     REQUIRE(err.str() == std::string());
 }
+
+TEST_CASE("Parallel export", "[cmds][export]")
+{
+    std::unique_ptr<Project> prj = Tests::makeProject();
+    Storage &storage = prj->getStorage();
+
+    for (const char *id : { "a", "b", "c" }) {
+        Item item = Tests::makeItem(id);
+        item.setValue("title", std::string("multi\nline ") + id);
+        Tests::storeItem(storage, std::move(item));
+    }
+
+    Command *const cmd = Commands::get("export");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    SECTION("Output is ordered")
+    {
+        // The first item is exported last.
+        const std::string exporter = "[ $1 != _id=a ] || sleep 1; echo";
+        boost::optional<int> exitCode = cmd->run(*prj, { "-j", "3", exporter });
+        REQUIRE(exitCode);
+        REQUIRE(*exitCode == EXIT_SUCCESS);
+
+        REQUIRE(out.str() == "_id=a title=multi line a\n"
+                             "_id=b title=multi line b\n"
+                             "_id=c title=multi line c\n");
+    }
+
+    SECTION("Several items per command")
+    {
+        boost::optional<int> exitCode =
+            cmd->run(*prj, { "-j", "2", "-n", "2", "echo" });
+        REQUIRE(exitCode);
+        REQUIRE(*exitCode == EXIT_SUCCESS);
+
+        REQUIRE(out.str() == "_id=a title=multi line a "
+                             "_id=b title=multi line b\n"
+                             "_id=c title=multi line c\n");
+    }
+
+    SECTION("Output stops at first failure")
+    {
+        const std::string exporter = "f() { echo $1; [ $1 != _id=b ]; }; f";
+        REQUIRE_THROWS_AS(cmd->run(*prj, { "-j", "3", exporter }),
+                          const std::runtime_error &);
+
+        REQUIRE(out.str() == "_id=a\n"
+                             "_id=b\n");
+    }
+
+    REQUIRE(err.str() == std::string());
+}
+
+TEST_CASE("Export waits only for its exporters", "[cmds][export]")
+{
+    std::unique_ptr<Project> prj = Tests::makeProject();
+    Tests::storeItem(prj->getStorage(), Tests::makeItem("id"));
+
+    Command *const cmd = Commands::get("export");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    const pid_t child = fork();
+    REQUIRE(child != -1);
+    if (child == 0) {
+        _Exit(3);
+    }
+
+    // Exporter interrupts us the way terminal does.
+    boost::optional<int> exitCode =
+        cmd->run(*prj, { "-j", "2", "sleep 1; kill -INT $PPID; echo" });
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_SUCCESS);
+    REQUIRE(out.str() == "_id=id\n");
+
+    int status;
+    REQUIRE(waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 3);
+}
@@ -73,7 +73,9 @@ TEST_CASE("Help lists all commands", "[cmds][help]")
 
     const std::string expectedOut =
         "add -- add new item\n"
+        "batch -- execute commands read from standard input\n"
         "check -- verify project state\n"
+        "compact -- compress histories of cold items\n"
         "complete -- perform command-line completion\n";
     REQUIRE(out.str().substr(0, expectedOut.length()) == expectedOut);
     REQUIRE(err.str() == std::string());
@@ -130,7 +132,9 @@ TEST_CASE("Help is completed", "[cmds][help][completion]")
 
         const std::string expectedOut =
             "add\n"
+            "batch\n"
             "check\n"
+            "compact\n"
             "complete\n";
         REQUIRE(out.str().substr(0, expectedOut.length()) == expectedOut);
         REQUIRE(err.str() == std::string());
@@ -0,0 +1,150 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "Catch/catch.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <cstdlib>
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Command.hpp"
+#include "Commands.hpp"
+#include "Item.hpp"
+#include "Project.hpp"
+#include "Storage.hpp"
+
+#include "Tests.hpp"
+
+namespace fs = boost::filesystem;
+
+TEST_CASE("Import fails on wrong invocation", "[cmds][import][invocation]")
+{
+    std::unique_ptr<Project> prj = Tests::makeProject();
+    Command *const cmd = Commands::get("import");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    boost::optional<int> exitCode = cmd->run(*prj, { "arg" });
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_FAILURE);
+
+    REQUIRE(out.str() == std::string());
+    REQUIRE(err.str() != std::string());
+}
+
+TEST_CASE("Import adds items", "[cmds][import]")
+{
+    Command *const cmd = Commands::get("import");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+
+            const char items[] = "_id=abc\0status=open\0title=first\0\0"
+                                 "_id=abd\0\0"
+                                 "title=multi\nline\0\0";
+            StreamFeed input(std::cin, std::string(items, sizeof(items) - 1U));
+
+            boost::optional<int> exitCode = cmd->run(prj, {});
+            REQUIRE(exitCode);
+            REQUIRE(*exitCode == EXIT_SUCCESS);
+
+            prj.save();
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Storage &storage = prj.getStorage();
+            REQUIRE(storage.getIdGenerator().size() == 2);
+
+            std::vector<std::reference_wrapper<Item>> items = storage.list();
+            REQUIRE(items.size() == 2U);
+            if (items[0].get().getValue("title") != "first") {
+                std::swap(items[0], items[1]);
+            }
+            REQUIRE(items[0].get().getValue("title") == "first");
+            REQUIRE(items[0].get().getValue("status") == "open");
+            REQUIRE(items[1].get().getValue("title") == "multi\nline");
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+
+    REQUIRE(out.str().substr(0U, 18U) == "Imported items: 2 ");
+    REQUIRE(err.str() == std::string());
+}
+
+TEST_CASE("Import of broken input adds nothing", "[cmds][import]")
+{
+    std::unique_ptr<Project> prj = Tests::makeProject();
+    Command *const cmd = Commands::get("import");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    SECTION("Broken field")
+    {
+        const char items[] = "title=ok\0\0field\0\0";
+        StreamFeed input(std::cin, std::string(items, sizeof(items) - 1U));
+
+        boost::optional<int> exitCode = cmd->run(*prj, {});
+        REQUIRE(exitCode);
+        REQUIRE(*exitCode == EXIT_FAILURE);
+    }
+
+    SECTION("Wrong key name")
+    {
+        const char items[] = "title=ok\0\0ti tle=x\0\0";
+        StreamFeed input(std::cin, std::string(items, sizeof(items) - 1U));
+
+        boost::optional<int> exitCode = cmd->run(*prj, {});
+        REQUIRE(exitCode);
+        REQUIRE(*exitCode == EXIT_FAILURE);
+    }
+
+    SECTION("Unterminated item")
+    {
+        StreamFeed input(std::cin, std::string("title=ok\0", 9U));
+
+        boost::optional<int> exitCode = cmd->run(*prj, {});
+        REQUIRE(exitCode);
+        REQUIRE(*exitCode == EXIT_FAILURE);
+    }
+
+    REQUIRE(prj->getStorage().list().empty());
+    REQUIRE(out.str() == std::string());
+    REQUIRE(err.str().find("item #") != std::string::npos);
+}
@@ -18,8 +18,14 @@
 
 #include <cstdlib>
 
+#include <functional>
+#include <ostream>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
 
 #include "Change.hpp"
 #include "Command.hpp"
@@ -58,6 +64,150 @@ TEST_CASE("Ls lists items", "[cmds][ls]")
     REQUIRE(err.str() == std::string());
 }
 
+TEST_CASE("Ls limits number of items", "[cmds][ls]")
+{
+    Tests::disableDecorations();
+
+    std::unique_ptr<Project> prj = Tests::makeProject();
+    Storage &storage = prj->getStorage();
+
+    for (const std::string id : { "id3", "id1", "id2" }) {
+        Item item = Tests::makeItem(id);
+        item.setValue("title", "title");
+        Tests::storeItem(storage, std::move(item));
+    }
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    prj->getConfig().set("ui.ls.fmt", "_id");
+    prj->getConfig().set("ui.ls.sort", "_id");
+    prj->getConfig().set("ui.ls.color", "inv !heading");
+
+    Command *const cmd = Commands::get("ls");
+    boost::optional<int> exitCode = cmd->run(*prj, { "--limit", "2",
+                                                     "title==title" });
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_SUCCESS);
+
+    REQUIRE(out.str() == "ID \nid1\nid2\n");
+    REQUIRE(err.str() == std::string());
+}
+
+TEST_CASE("Ls prints delimited items when piped", "[cmds][ls]")
+{
+    std::unique_ptr<Project> prj = Tests::makeProject();
+    Storage &storage = prj->getStorage();
+
+    for (const std::string id : { "id2", "id1" }) {
+        Item item = Tests::makeItem(id);
+        item.setValue("title", "title " + id);
+        Tests::storeItem(storage, std::move(item));
+    }
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    prj->getConfig().set("ui.ls.fmt", "_id,title");
+    prj->getConfig().set("ui.ls.sort", "-_id");
+    prj->getConfig().set("ui.ls.color", "inv !heading");
+    prj->getConfig().set("ui.ls.pipe", "tsv");
+
+    Command *const cmd = Commands::get("ls");
+    boost::optional<int> exitCode = cmd->run(*prj, { });
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_SUCCESS);
+
+    REQUIRE(out.str() == "id2\ttitle id2\nid1\ttitle id1\n");
+    REQUIRE(err.str() == std::string());
+
+    prj->getConfig().set("ui.ls.pipe", "wrong");
+    exitCode = cmd->run(*prj, { });
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_FAILURE);
+    REQUIRE(err.str() != std::string());
+}
+
+TEST_CASE("Ls prints unsorted rows before reading all items", "[cmds][ls]")
+{
+    // Reports output once it has the first row.
+    class Buf : public std::stringbuf
+    {
+    public:
+        explicit Buf(std::function<void(const std::string &)> onRow)
+            : onRow(std::move(onRow))
+        {
+        }
+
+    protected:
+        virtual std::streamsize xsputn(const char *s,
+                                       std::streamsize n) override
+        {
+            const std::streamsize written = std::stringbuf::xsputn(s, n);
+            if (onRow && str().find('\n') != std::string::npos) {
+                onRow(str());
+                onRow = {};
+            }
+            return written;
+        }
+
+    private:
+        std::function<void(const std::string &)> onRow;
+    };
+
+    const std::string path = "tests/data/dit/projects/tmp";
+
+    try {
+
+        Project::init(path);
+
+        std::vector<std::string> ids;
+        {
+            Project prj(path);
+            for (int i = 0; i < 2; ++i) {
+                Item &item = prj.getStorage().create();
+                item.setValue("title", "title");
+                ids.push_back(item.getId());
+            }
+            prj.save();
+        }
+
+        std::string expected;
+        Buf buf([&](const std::string &output) {
+            const std::string row = output.substr(0, output.find('\n') + 1U);
+            const bool first = (row.compare(0, ids[0].size(), ids[0]) == 0);
+            const std::string &other = (first ? ids[1] : ids[0]);
+            expected = row + other + "\tchanged\n";
+
+            Project changer(path);
+            changer.getStorage().get(other).setValue("title", "changed");
+            changer.save();
+        });
+        std::ostream out(&buf);
+        std::ostringstream err;
+        Tests::setStreams(out, err);
+
+        Project prj(path);
+        prj.getConfig().set("ui.ls.fmt", "_id,title");
+        prj.getConfig().set("ui.ls.color", "inv !heading");
+        prj.getConfig().set("ui.ls.pipe", "tsv");
+
+        Command *const cmd = Commands::get("ls");
+        boost::optional<int> exitCode = cmd->run(prj, { "--unsorted" });
+        REQUIRE(exitCode);
+        REQUIRE(*exitCode == EXIT_SUCCESS);
+
+        REQUIRE(buf.str() == expected);
+        REQUIRE(err.str() == std::string());
+
+    } catch (...) {
+        boost::filesystem::remove_all(path);
+        throw;
+    }
+
+    boost::filesystem::remove_all(path);
+}
+
 TEST_CASE("Ls completes fields", "[cmds][ls][completion]")
 {
     std::unique_ptr<Project> prj = Tests::makeProject();
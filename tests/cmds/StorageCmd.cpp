@@ -0,0 +1,211 @@
+// Copyright (C) 2018 xaizek <xaizek@posteo.net>
+//
+// This file is part of dit.
+//
+// dit is free software: you can redistribute it and/or modify
+// it under the terms of version 3 of the GNU Affero General Public
+// License as published by the Free Software Foundation.
+//
+// dit is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dit.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Catch/catch.hpp"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <cstdlib>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "Command.hpp"
+#include "Commands.hpp"
+#include "Item.hpp"
+#include "Project.hpp"
+#include "Storage.hpp"
+
+#include "Tests.hpp"
+
+namespace fs = boost::filesystem;
+
+TEST_CASE("Storage fails on wrong invocation", "[cmds][storage][invocation]")
+{
+    std::unique_ptr<Project> prj = Tests::makeProject();
+    Command *const cmd = Commands::get("storage");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    boost::optional<int> exitCode;
+
+    SECTION("Too many arguments")
+    {
+        exitCode = cmd->run(*prj, { "dir", "packed" });
+    }
+
+    SECTION("Unknown backend")
+    {
+        exitCode = cmd->run(*prj, { "no-such-backend" });
+    }
+
+    SECTION("Same backend")
+    {
+        exitCode = cmd->run(*prj, { "dir" });
+    }
+
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_FAILURE);
+
+    REQUIRE(out.str() == std::string());
+    REQUIRE(err.str() != std::string());
+}
+
+TEST_CASE("Storage converts items", "[cmds][storage]")
+{
+    Command *const cmd = Commands::get("storage");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    std::string id;
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Item &item = prj.getStorage().create();
+            item.setValue("title", "title");
+            id = item.getId();
+            prj.save();
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            boost::optional<int> exitCode = cmd->run(prj, { "packed" });
+            REQUIRE(exitCode);
+            REQUIRE(*exitCode == EXIT_SUCCESS);
+            prj.save();
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            boost::optional<int> exitCode = cmd->run(prj, {});
+            REQUIRE(exitCode);
+            REQUIRE(*exitCode == EXIT_SUCCESS);
+            REQUIRE(prj.getStorage().get(id).getValue("title") == "title");
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+
+    REQUIRE(out.str() == "packed\n");
+    REQUIRE(err.str() == std::string());
+}
+
+TEST_CASE("Storage converts format of items", "[cmds][storage]")
+{
+    Command *const cmd = Commands::get("storage");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    std::string id;
+
+    try {
+
+        Project::init("tests/data/dit/projects/tmp");
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            Item &item = prj.getStorage().create();
+            item.setValue("title", "title");
+            id = item.getId();
+            prj.save();
+        }
+
+        for (const std::string backend : { "dir", "packed" }) {
+            {
+                Project prj("tests/data/dit/projects/tmp");
+                if (backend != "dir") {
+                    REQUIRE(cmd->run(prj, { backend }));
+                }
+                boost::optional<int> exitCode = cmd->run(prj, { "binary" });
+                REQUIRE(exitCode);
+                REQUIRE(*exitCode == EXIT_SUCCESS);
+                prj.save();
+            }
+
+            {
+                Project prj("tests/data/dit/projects/tmp");
+                Item &item = prj.getStorage().get(id);
+                REQUIRE(item.getValue("title") == "title");
+                item.setValue("status", backend);
+                prj.save();
+            }
+
+            {
+                Project prj("tests/data/dit/projects/tmp");
+                REQUIRE(prj.getStorage().get(id).getValue("status") == backend);
+                boost::optional<int> exitCode = cmd->run(prj, { "text" });
+                REQUIRE(exitCode);
+                REQUIRE(*exitCode == EXIT_SUCCESS);
+                prj.save();
+            }
+
+            {
+                Project prj("tests/data/dit/projects/tmp");
+                Item &item = prj.getStorage().get(id);
+                REQUIRE(item.getValue("title") == "title");
+                REQUIRE(item.getValue("status") == backend);
+            }
+        }
+
+        {
+            Project prj("tests/data/dit/projects/tmp");
+            REQUIRE(cmd->run(prj, { "binary" }));
+            boost::optional<int> exitCode = cmd->run(prj, { "binary" });
+            REQUIRE(exitCode);
+            REQUIRE(*exitCode == EXIT_FAILURE);
+            exitCode = cmd->run(prj, {});
+            REQUIRE(exitCode);
+            REQUIRE(*exitCode == EXIT_SUCCESS);
+        }
+
+    } catch (...) {
+        fs::remove_all("tests/data/dit/projects/tmp");
+        throw;
+    }
+
+    fs::remove_all("tests/data/dit/projects/tmp");
+
+    REQUIRE(out.str() == "packed binary\n");
+    REQUIRE(err.str() != std::string());
+}
+
+TEST_CASE("Storage completes backend names", "[cmds][storage][completion]")
+{
+    std::unique_ptr<Project> prj = Tests::makeProject();
+    Command *const cmd = Commands::get("storage");
+
+    std::ostringstream out, err;
+    Tests::setStreams(out, err);
+
+    boost::optional<int> exitCode = cmd->complete(*prj, { "" });
+    REQUIRE(exitCode);
+    REQUIRE(*exitCode == EXIT_SUCCESS);
+
+    REQUIRE(out.str() == "dir\npacked\ntext\nbinary\n");
+    REQUIRE(err.str() == std::string());
+}
@@ -16,9 +16,16 @@
 
 #include "Catch/catch.hpp"
 
+#include <boost/filesystem/operations.hpp>
+
+#include <ctime>
+#include <fstream>
+#include <set>
 #include <sstream>
+#include <string>
 
 #include "Change.hpp"
+#include "CompletionCache.hpp"
 #include "Item.hpp"
 #include "Project.hpp"
 #include "Storage.hpp"
@@ -46,3 +53,170 @@ TEST_CASE("Present key names are absent from completion", "[completion]")
     const std::string expectedOut = "bug_number:\n";
     REQUIRE(oss.str() == expectedOut);
 }
+
+TEST_CASE("Completion doesn't read items once cache is built", "[completion]")
+{
+    namespace fs = boost::filesystem;
+
+    const std::string root = "tests/data/dit/projects/tmp";
+
+    std::string id;
+
+    try {
+
+        Project::init(root);
+
+        {
+            Project prj(root);
+            Item &item = prj.getStorage().create();
+            item.setValue("title", "first\nline");
+            item.setValue("status", "open");
+            id = item.getId();
+
+            Storage &storage = prj.getStorage();
+            REQUIRE(storage.getCompletionCache() == nullptr);
+            prj.save();
+            REQUIRE(storage.getCompletionCache() != nullptr);
+
+            // Unsaved changes make cache outdated.
+            item.setValue("status", "closed");
+            REQUIRE(storage.getCompletionCache() == nullptr);
+        }
+
+        REQUIRE(fs::exists(root + "/completion"));
+
+        Project prj(root);
+        fs::remove_all(prj.getDataDir());
+
+        Storage &storage = prj.getStorage();
+
+        std::ostringstream ids;
+        REQUIRE(completeIds(storage, ids) == EXIT_SUCCESS);
+        REQUIRE(ids.str() == id + "\n");
+
+        std::ostringstream keys;
+        REQUIRE(completeKeys(storage, keys, { "title:" }) == EXIT_SUCCESS);
+        REQUIRE(keys.str() == "status:\n");
+
+        std::ostringstream values;
+        REQUIRE(completeValues(storage, values, "title") == EXIT_SUCCESS);
+        REQUIRE(values.str() == "first\nline\n");
+
+    } catch (...) {
+        fs::remove_all(root);
+        throw;
+    }
+
+    fs::remove_all(root);
+}
+
+TEST_CASE("Completion cache is updated incrementally", "[completion]")
+{
+    namespace fs = boost::filesystem;
+
+    std::time_t t = std::time(nullptr);
+    MockTimeSource timeMock([&t](){ return t; });
+
+    const std::string root = "tests/data/dit/projects/tmp";
+
+    auto getValues = [&root](const std::string &key) {
+        Project prj(root);
+        CompletionCache *cache = prj.getStorage().getCompletionCache();
+        REQUIRE(cache != nullptr);
+        return cache->getValues(key);
+    };
+
+    try {
+
+        Project::init(root);
+
+        std::string id1, id2;
+        {
+            Project prj(root);
+            prj.save();
+        }
+        REQUIRE(!fs::exists(root + "/completion"));
+
+        {
+            Project prj(root);
+            Item &item1 = prj.getStorage().create();
+            item1.setValue("status", "open");
+            id1 = item1.getId();
+            Item &item2 = prj.getStorage().create();
+            item2.setValue("status", "open");
+            id2 = item2.getId();
+            prj.save();
+        }
+
+        ++t;
+        {
+            Project prj(root);
+            prj.getStorage().get(id1).setValue("status", "closed");
+            prj.save();
+        }
+        std::set<std::string> expected = { "closed", "open" };
+        REQUIRE(getValues("status") == expected);
+
+        {
+            Project prj(root);
+            Item &item = prj.getStorage().get(id2);
+            item.setValue("status", "closed");
+            prj.save();
+
+            // Update of a change of the same second rewrites the item.
+            item.setValue("status", "done");
+            prj.save();
+        }
+        expected = { "closed", "done" };
+        REQUIRE(getValues("status") == expected);
+
+    } catch (...) {
+        fs::remove_all(root);
+        throw;
+    }
+
+    fs::remove_all(root);
+}
+
+TEST_CASE("Broken completion cache is rebuilt", "[completion]")
+{
+    namespace fs = boost::filesystem;
+
+    const std::string root = "tests/data/dit/projects/tmp";
+
+    try {
+
+        Project::init(root);
+
+        std::string id;
+        {
+            Project prj(root);
+            Item &item = prj.getStorage().create();
+            item.setValue("status", "open");
+            id = item.getId();
+            prj.save();
+        }
+
+        // Format that lacks numbers of items.
+        std::ofstream(root + "/completion") << id << "\nstatus=open\n";
+
+        {
+            Project prj(root);
+            REQUIRE(prj.getStorage().getCompletionCache() == nullptr);
+            prj.getStorage().get(id).setValue("status", "closed");
+            prj.save();
+        }
+
+        Project prj(root);
+        CompletionCache *cache = prj.getStorage().getCompletionCache();
+        REQUIRE(cache != nullptr);
+        const std::set<std::string> expected = { "closed" };
+        REQUIRE(cache->getValues("status") == expected);
+
+    } catch (...) {
+        fs::remove_all(root);
+        throw;
+    }
+
+    fs::remove_all(root);
+}
@@ -16,13 +16,22 @@
 
 #include "Catch/catch.hpp"
 
+#include <boost/filesystem/operations.hpp>
+
+#include <chrono>
+#include <functional>
+#include <map>
 #include <sstream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 #include "Change.hpp"
+#include "KeyTable.hpp"
 #include "file_format.hpp"
 
+namespace fs = boost::filesystem;
+
 static inline bool operator==(const Change &lhs, const Change &rhs);
 
 TEST_CASE("Serialization of empty changeset.", "[file-format]")
@@ -74,6 +83,287 @@ TEST_CASE("Deserialization throws on empty string", "[file-format]")
     REQUIRE_THROWS_AS(ss >> d, const std::runtime_error &);
 }
 
+TEST_CASE("Appended changes continue previous ones", "[file-format]")
+{
+    std::vector<Change> o {
+        { 123, "key1", "value1" },
+        { 123, "key2", "value2" },
+        { 124, "key3", "value3" },
+    };
+
+    SECTION("Timestamp is omitted if it's the same")
+    {
+        std::ostringstream oss;
+        writeChanges(oss, o, 1U);
+        REQUIRE(oss.str() == "key2=value2\n124\nkey3=value3\n");
+    }
+
+    SECTION("Nothing is written past the end")
+    {
+        std::ostringstream oss;
+        writeChanges(oss, o, 3U);
+        REQUIRE(oss.str() == std::string());
+    }
+
+    SECTION("Concatenation is parsed as a whole")
+    {
+        std::stringstream ss;
+        writeChanges(ss, { o.cbegin(), o.cbegin() + 1 }, 0U);
+        writeChanges(ss, o, 1U);
+
+        std::vector<Change> d;
+        ss >> d;
+        REQUIRE(d == o);
+    }
+}
+
+TEST_CASE("Values records are read back", "[file-format]")
+{
+    std::map<std::string, std::map<std::string, std::string>> values;
+    std::map<std::string, std::string> stamps;
+
+    std::stringstream ss;
+    writeValues(ss, "abc", "1:2", { { "title", "a\nb" } });
+    writeValues(ss, "xyz", "", { });
+    writeValues(ss, "abc", "3:4", { { "status", "open" } });
+
+    SECTION("Later records replace earlier ones")
+    {
+        REQUIRE(readValues(ss, values, stamps) == 3U);
+        REQUIRE(values.size() == 2U);
+        REQUIRE(values["abc"].size() == 1U);
+        REQUIRE(values["abc"]["status"] == "open");
+        REQUIRE(values["xyz"].empty());
+        REQUIRE(stamps.size() == 1U);
+        REQUIRE(stamps["abc"] == "3:4");
+    }
+
+    SECTION("Record without a stamp drops previous one")
+    {
+        ss << "@abc\n\n";
+        REQUIRE(readValues(ss, values, stamps) == 4U);
+        REQUIRE(values["abc"].empty());
+        REQUIRE(stamps.count("abc") == 0U);
+    }
+
+    SECTION("Unterminated record is ignored")
+    {
+        ss << "@abc 5:6\ntitle=x\n";
+        REQUIRE(readValues(ss, values, stamps) == 3U);
+        REQUIRE(values["abc"].count("title") == 0U);
+        REQUIRE(stamps["abc"] == "3:4");
+    }
+
+    SECTION("Value outside of record causes an error")
+    {
+        std::istringstream iss("title=x\n\n");
+        REQUIRE_THROWS_AS(readValues(iss, values, stamps),
+                          const std::runtime_error &);
+    }
+}
+
+TEST_CASE("Change parsers produce results of original parser", "[file-format]")
+{
+    // Expected values are what the original stream parser produced for the
+    // same input.
+    auto check = [](const std::string &data, std::vector<Change> expected) {
+        std::vector<Change> fromStream;
+        std::istringstream iss(data);
+        iss >> fromStream;
+        REQUIRE(fromStream == expected);
+
+        std::vector<Change> fromMemory;
+        parseChanges(data.data(), data.size(), fromMemory);
+        REQUIRE(fromMemory == expected);
+    };
+
+    SECTION("Several timestamps")
+    {
+        check("1464475061\ntitle=Title\nstatus=created\n"
+              "1464475091\nstatus=done\ntitle=\n",
+              { { 1464475061, "title", "Title" },
+                { 1464475061, "status", "created" },
+                { 1464475091, "status", "done" },
+                { 1464475091, "title", "" } });
+    }
+
+    SECTION("Only first equal sign separates key")
+    {
+        check("5\nkey=a=b\n", { { 5, "key", "a=b" } });
+    }
+
+    SECTION("Escape sequences")
+    {
+        check(R"(1
+nl=line1\nline2
+bs=a\\b
+nlbs=\\\n
+other=\t
+trailing=x\
+)",
+              { { 1, "nl", "line1\nline2" },
+                { 1, "bs", R"(a\b)" },
+                { 1, "nlbs", "\\\n" },
+                { 1, "other", R"(\t)" },
+                { 1, "trailing", R"(x\)" } });
+    }
+
+    SECTION("Escaped backslash followed by n")
+    {
+        // The original parser decoded this as backslash and line feed, which
+        // didn't match what serialization produces for backslash and `n`.
+        check("1\nkey=\\\\n\n", { { 1, "key", R"(\n)" } });
+
+        std::ostringstream oss;
+        const std::vector<Change> o { { 1, "key", R"(\n)" } };
+        oss << o;
+        REQUIRE(oss.str() == "1\nkey=\\\\n\n");
+    }
+
+    SECTION("Unterminated last line is ignored")
+    {
+        check("123\nkey=value\nkey2=val", { { 123, "key", "value" } });
+    }
+
+    SECTION("Empty input")
+    {
+        check("", { });
+    }
+
+    SECTION("Errors are reported")
+    {
+        for (const std::string data : { "key=value\n", "1\n\n", "1\nkey\n",
+                                        "1a\n" }) {
+            std::vector<Change> d;
+            REQUIRE_THROWS_AS(parseChanges(data.data(), data.size(), d),
+                              const std::runtime_error &);
+
+            std::istringstream iss(data);
+            REQUIRE_THROWS_AS(iss >> d, const std::runtime_error &);
+        }
+    }
+}
+
+TEST_CASE("Binary changes are read back", "[file-format][binary]")
+{
+    const std::string keysPath = "tests/data/dit/projects/keys";
+
+    try {
+        KeyTable keys(keysPath);
+
+        const std::vector<Change> o {
+            { 123, "key1", "line1\nline2" },
+            { 124, "key2", std::string("\0=\\", 3) },
+            { 124, "key1", std::string(300, 'x') },
+            { 100, "key3", "" },
+        };
+
+        std::ostringstream oss;
+        writeBinaryChanges(oss, o, 0U, keys);
+        const std::string data = oss.str();
+        REQUIRE(isBinaryChanges(data.data(), data.size()));
+
+        std::vector<Change> d;
+        parseBinaryChanges(data.data(), data.size(), keys, d);
+        REQUIRE(d == o);
+
+        SECTION("Appended changes continue previous ones")
+        {
+            std::vector<Change> more = o;
+            more.emplace_back(200, "key4", "value");
+
+            std::ostringstream tail;
+            writeBinaryChanges(tail, more, o.size(), keys);
+            const std::string all = data + tail.str();
+
+            std::vector<Change> d;
+            parseBinaryChanges(all.data(), all.size(), KeyTable(keysPath), d);
+            REQUIRE(d == more);
+        }
+
+        SECTION("Incomplete last entry is ignored")
+        {
+            std::vector<Change> d;
+            parseBinaryChanges(data.data(), data.size() - 1U, keys, d);
+            REQUIRE(d.size() == o.size() - 1U);
+        }
+
+        SECTION("Errors are reported")
+        {
+            std::vector<Change> d;
+            const std::string text = "1\nkey=value\n";
+            REQUIRE(!isBinaryChanges(text.data(), text.size()));
+            REQUIRE_THROWS_AS(parseBinaryChanges(text.data(), text.size(),
+                                                 keys, d),
+                              const std::runtime_error &);
+
+            std::string unknownKey = data.substr(0U, 5U);
+            unknownKey += std::string("\x00\x7f\x00", 3);
+            REQUIRE_THROWS_AS(parseBinaryChanges(unknownKey.data(),
+                                                 unknownKey.size(), keys, d),
+                              const std::runtime_error &);
+        }
+    } catch (...) {
+        fs::remove(keysPath);
+        throw;
+    }
+
+    fs::remove(keysPath);
+}
+
+TEST_CASE("Parsing of 1M changes", "[.benchmark][file-format]")
+{
+    const std::string keysPath = "tests/data/dit/projects/keys";
+
+    std::vector<Change> o;
+    o.reserve(1000000);
+    for (int i = 0; i < 1000000; ++i) {
+        o.emplace_back(1500000000 + i/4, "key" + std::to_string(i%4),
+                       "Value number " + std::to_string(i) + "\nof change");
+    }
+
+    try {
+        KeyTable keys(keysPath);
+
+        std::ostringstream text, binary;
+        text << o;
+        writeBinaryChanges(binary, o, 0U, keys);
+
+        auto measure = [&o](const char name[], const std::function<void()> &f) {
+            const auto start = std::chrono::steady_clock::now();
+            f();
+            const auto end = std::chrono::steady_clock::now();
+            WARN(name << " parsed in " <<
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                     end - start
+                 ).count() << " ms");
+        };
+
+        const std::string textData = text.str();
+        std::vector<Change> fromText;
+        measure("Text", [&]() {
+            parseChanges(textData.data(), textData.size(), fromText);
+        });
+        REQUIRE(fromText == o);
+
+        const std::string binaryData = binary.str();
+        std::vector<Change> fromBinary;
+        measure("Binary", [&]() {
+            parseBinaryChanges(binaryData.data(), binaryData.size(), keys,
+                               fromBinary);
+        });
+        REQUIRE(fromBinary == o);
+
+        WARN("Text: " << textData.size() << " bytes, binary: " <<
+             binaryData.size() << " bytes");
+    } catch (...) {
+        fs::remove(keysPath);
+        throw;
+    }
+
+    fs::remove(keysPath);
+}
+
 static inline bool
 operator==(const Change &lhs, const Change &rhs)
 {
@@ -16,8 +16,15 @@
 
 #include "Catch/catch.hpp"
 
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <csignal>
 #include <cstdlib>
 
+#include <iostream>
+#include <string>
+
 #include "integration.hpp"
 
 TEST_CASE("On failure curent value is returned.", "[integration]")
@@ -28,3 +35,94 @@ TEST_CASE("On failure curent value is returned.", "[integration]")
     boost::optional<std::string> val = editValue("key", "current");
     REQUIRE_FALSE(val);
 }
+
+TEST_CASE("Closed pipe doesn't kill buffered output.", "[integration]")
+{
+    int pipePair[2];
+    REQUIRE(pipe(pipePair) == 0);
+
+    std::cout.flush();
+
+    const pid_t pid = fork();
+    REQUIRE(pid != -1);
+    if (pid == 0) {
+        close(pipePair[0]);
+        if (dup2(pipePair[1], STDOUT_FILENO) == -1) {
+            _Exit(EXIT_FAILURE);
+        }
+        close(pipePair[1]);
+
+        bool gone = false;
+        {
+            RedirectToPager redirectToPager("less");
+            for (int i = 0; i < 1024 && !RedirectToPager::isConsumerGone();
+                 ++i) {
+                std::cout << std::string(1024, 'x') << '\n';
+            }
+            gone = RedirectToPager::isConsumerGone();
+        }
+
+        // Processes we start must not inherit changed handling of SIGPIPE.
+        struct sigaction sa;
+        sigset_t mask;
+        if (sigaction(SIGPIPE, nullptr, &sa) != 0 ||
+            sa.sa_handler != SIG_DFL ||
+            sigprocmask(SIG_BLOCK, nullptr, &mask) != 0 ||
+            sigismember(&mask, SIGPIPE)) {
+            _Exit(EXIT_FAILURE);
+        }
+
+        _Exit(gone ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(pipePair[1]);
+    close(pipePair[0]);
+
+    int status;
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == EXIT_SUCCESS);
+}
+
+TEST_CASE("Buffered output precedes errors.", "[integration]")
+{
+    int pipePair[2];
+    REQUIRE(pipe(pipePair) == 0);
+
+    std::cout.flush();
+
+    const pid_t pid = fork();
+    REQUIRE(pid != -1);
+    if (pid == 0) {
+        close(pipePair[0]);
+        if (dup2(pipePair[1], STDOUT_FILENO) == -1 ||
+            dup2(pipePair[1], STDERR_FILENO) == -1) {
+            _Exit(EXIT_FAILURE);
+        }
+        close(pipePair[1]);
+
+        {
+            RedirectToPager redirectToPager("less");
+            std::cout << "out1\n";
+            std::cerr << "err\n";
+            std::cout << "out2\n";
+        }
+        _Exit(EXIT_SUCCESS);
+    }
+
+    close(pipePair[1]);
+
+    std::string output;
+    char buf[64];
+    ssize_t n;
+    while ((n = read(pipePair[0], buf, sizeof(buf))) > 0) {
+        output.append(buf, n);
+    }
+    close(pipePair[0]);
+
+    int status;
+    REQUIRE(waitpid(pid, &status, 0) == pid);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == EXIT_SUCCESS);
+    REQUIRE(output == "out1\nerr\nout2\n");
+}